@@ -0,0 +1,150 @@
+/**
+ * @file  aqi.c
+ * @brief US-EPA Air Quality Index from PMS readings, in integer math
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aqi.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+ * A breakpoint segment; the slope is worked out by the compiler, in
+ * 1/AQI_SLOPE_ONE index points per concentration unit, so that evaluating a
+ * segment takes one multiplication and no division.
+ */
+typedef struct aqi_bp_type {
+	uint16_t c_lo, c_hi;
+	uint16_t i_lo, i_hi;
+	uint32_t slope;
+} aqi_bp_t;
+
+#define AQI_SLOPE_SHIFT	20
+#define AQI_SLOPE_ONE	(1ul << AQI_SLOPE_SHIFT)
+
+#define AQI_BP(c_lo, c_hi, i_lo, i_hi) \
+	{ (c_lo), (c_hi), (i_lo), (i_hi), \
+	  (uint32_t)((((uint32_t)(i_hi) - (i_lo)) * AQI_SLOPE_ONE + ((c_hi) - (c_lo)) / 2) / \
+		     ((c_hi) - (c_lo))) }
+
+/// PM2.5, in 0.1 ug/m3 (2024 revision)
+static const aqi_bp_t bp_pm2_5[] = {
+	AQI_BP(   0,   90,   0,  50),
+	AQI_BP(  91,  354,  51, 100),
+	AQI_BP( 355,  554, 101, 150),
+	AQI_BP( 555, 1254, 151, 200),
+	AQI_BP(1255, 2254, 201, 300),
+	AQI_BP(2255, 3254, 301, 500),
+};
+
+/// PM10, in ug/m3
+static const aqi_bp_t bp_pm10[] = {
+	AQI_BP(  0,  54,   0,  50),
+	AQI_BP( 55, 154,  51, 100),
+	AQI_BP(155, 254, 101, 150),
+	AQI_BP(255, 354, 151, 200),
+	AQI_BP(355, 424, 201, 300),
+	AQI_BP(425, 604, 301, 500),
+};
+
+/// Lowest AQI of each category above the first
+static const uint16_t cat_lo[AQI_NR_CATS - 1] = { 51, 101, 151, 201, 301 };
+
+// Evaluate a breakpoint table, rounding to the nearest index point
+static uint16_t aqi_eval(const aqi_bp_t *bp, unsigned int nr_bp, uint32_t c)
+{
+	unsigned int x;
+
+	for (x = 0; x < nr_bp; ++x) {
+		if (c <= bp[x].c_hi) {
+			uint32_t d = c - bp[x].c_lo;
+
+			return (uint16_t)(bp[x].i_lo +
+				((d * bp[x].slope + (AQI_SLOPE_ONE / 2)) >> AQI_SLOPE_SHIFT));
+		}
+	}
+	return AQI_MAX;
+}
+
+uint16_t aqi_pm2_5(uint32_t c)
+{
+	return aqi_eval(bp_pm2_5, sizeof(bp_pm2_5) / sizeof(bp_pm2_5[0]), c);
+}
+
+uint16_t aqi_pm10(uint32_t c)
+{
+	return aqi_eval(bp_pm10, sizeof(bp_pm10) / sizeof(bp_pm10[0]), c);
+}
+
+uint8_t aqi_category(uint16_t aqi)
+{
+	uint8_t x;
+
+	for (x = 0; x < AQI_NR_CATS - 1 && aqi >= cat_lo[x]; ++x)
+		;
+	return x;
+}
+
+void aqi_from_frame(aqi_t *aqi, const pms_frame_t *frame)
+{
+	uint16_t a25 = aqi_pm2_5((uint32_t)frame->pm_atm[PMS_PM2_5] * 10);
+	uint16_t a10 = aqi_pm10(frame->pm_atm[PMS_PM10]);
+
+	aqi->aqi      = (a25 >= a10) ? a25 : a10;
+	aqi->dominant = (a25 >= a10) ? PMS_PM2_5 : PMS_PM10;
+	aqi->category = aqi_category(aqi->aqi);
+	aqi->flags    = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Sum all bytes preceding the checksum field
+static uint16_t aqi_record_checksum(const uint8_t *raw)
+{
+	uint16_t sum = 0;
+	unsigned int x;
+
+	for (x = 0; x < (AQI_RECORD_LEN - 2); ++x)
+		sum += raw[x];
+	return sum;
+}
+
+void aqi_record_encode(uint8_t *raw, const aqi_t *aqi)
+{
+	uint16_t sum;
+
+	raw[0] = AQI_RECORD_START_1;
+	raw[1] = AQI_RECORD_START_2;
+	raw[2] = (uint8_t)(aqi->aqi >> 8);
+	raw[3] = (uint8_t)aqi->aqi;
+	raw[4] = aqi->category;
+	raw[5] = (uint8_t)(aqi->dominant | (aqi->flags & AQI_FLAG_MASK));
+	sum = aqi_record_checksum(raw);
+	raw[6] = (uint8_t)(sum >> 8);
+	raw[7] = (uint8_t)sum;
+}
+
+bool aqi_record_decode(aqi_t *aqi, const uint8_t *raw)
+{
+	uint16_t v = (uint16_t)((raw[2] << 8) | raw[3]);
+	uint8_t dominant = (uint8_t)(raw[5] & ~AQI_FLAG_MASK);
+
+	if (raw[0] != AQI_RECORD_START_1 || raw[1] != AQI_RECORD_START_2)
+		return false;
+	else if ((uint16_t)((raw[6] << 8) | raw[7]) != aqi_record_checksum(raw))
+		return false;
+	else if (v > AQI_MAX || raw[4] != aqi_category(v) ||
+		 (dominant != PMS_PM2_5 && dominant != PMS_PM10))
+		return false;
+
+	aqi->aqi      = v;
+	aqi->category = raw[4];
+	aqi->dominant = dominant;
+	aqi->flags    = (uint8_t)(raw[5] & AQI_FLAG_MASK);
+	return true;
+}
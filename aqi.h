@@ -0,0 +1,127 @@
+/**
+ * @file  aqi.h
+ * @brief US-EPA Air Quality Index from PMS readings, in integer math
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       computation can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * The AQI of a pollutant is piecewise linear in its concentration, between
+ * the breakpoints of the US-EPA tables (PM2.5 as revised in 2024, PM10
+ * unchanged), with the concentration truncated to 0.1 ug/m3 for PM2.5 and
+ * 1 ug/m3 for PM10; the overall AQI is the larger of both. Concentrations
+ * beyond the last breakpoint are reported as 500.
+ *
+ * NOTE: The EPA defines the AQI over 24-hour averages (or the NowCast);
+ *       this is computed from each frame as-is, which is what a local
+ *       indicator wants, and left to the host to average if need be.
+ *
+ * The index is also sent alongside reported frames, as a record of its own:
+ *
+ *   Offset  Size  Contents
+ *   ------  ----  -----------------------------------------------------
+ *        0     2  Start characters, 0x42 0x41 ("BA")
+ *        2     2  AQI, 0..500
+ *        4     1  Category (AQI_CAT_*)
+ *        5     1  Dominant pollutant (PMS_PM2_5 or PMS_PM10), ORed with
+ *                 flags about the frame (AQI_FLAG_*)
+ *        6     2  Checksum (sum of bytes 0..5)
+ *
+ * Multi-byte fields are big-endian, as in PMS frames; consumers that only
+ * know PMS frames skip it like any other noise.
+ */
+
+#if !defined(EEE192_AQI_H_)
+#define EEE192_AQI_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pms.h"
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// AQI categories
+enum aqi_category_type {
+	AQI_CAT_GOOD = 0,
+	AQI_CAT_MODERATE,
+	AQI_CAT_USG,		///< Unhealthy for sensitive groups
+	AQI_CAT_UNHEALTHY,
+	AQI_CAT_VERY_UNHEALTHY,
+	AQI_CAT_HAZARDOUS,
+	AQI_NR_CATS
+};
+
+/// Largest AQI reported
+#define AQI_MAX			500
+
+/// Total number of bytes in one AQI record
+#define AQI_RECORD_LEN		8
+
+/// First start character of an AQI record
+#define AQI_RECORD_START_1	0x42
+
+/// Second start character of an AQI record
+#define AQI_RECORD_START_2	0x41
+
+/// The frame had readings clamped as spikes (see hampel.h)
+#define AQI_FLAG_CLAMPED	0x80
+
+/// All flags defined so far
+#define AQI_FLAG_MASK		0x80
+
+/// An AQI reading
+typedef struct aqi_type {
+	/// Overall index, 0..AQI_MAX
+	uint16_t aqi;
+
+	/// Category of @c aqi (@code AQI_CAT_* @endcode)
+	uint8_t category;
+
+	/// Pollutant yielding @c aqi (@c PMS_PM2_5 or @c PMS_PM10)
+	uint8_t dominant;
+
+	/// Flags about the frame the index was computed from (@code AQI_FLAG_* @endcode)
+	uint8_t flags;
+} aqi_t;
+
+/**
+ * AQI of a PM2.5 concentration
+ *
+ * @param[in]	c	Concentration, in 0.1 ug/m3
+ */
+uint16_t aqi_pm2_5(uint32_t c);
+
+/**
+ * AQI of a PM10 concentration
+ *
+ * @param[in]	c	Concentration, in ug/m3
+ */
+uint16_t aqi_pm10(uint32_t c);
+
+/// Category of an AQI
+uint8_t aqi_category(uint16_t aqi);
+
+/// Compute the AQI of a frame, from its atmospheric readings; flags are cleared
+void aqi_from_frame(aqi_t *aqi, const pms_frame_t *frame);
+
+/// Build an AQI record, @c AQI_RECORD_LEN bytes
+void aqi_record_encode(uint8_t *raw, const aqi_t *aqi);
+
+/**
+ * Validate and decode an AQI record
+ *
+ * @return	@c true if the start characters, checksum and fields are all
+ *		valid, @c false otherwise (@c aqi is left untouched)
+ */
+bool aqi_record_decode(aqi_t *aqi, const uint8_t *raw);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_AQI_H_)
@@ -21,7 +21,10 @@ while True:
     hex_content = binascii.hexlify(content)
     starting_bits = b'424d'
     
-    last_line_b = hex_content.split(starting_bits)[::-1][0]
+    # The newest frame may still be incomplete; fall back to the latest one
+    # that is whole (28 bytes after the start characters).
+    frames = hex_content.split(starting_bits)
+    last_line_b = next((l for l in reversed(frames) if len(l) >= 2*28), frames[-1])
     last_line_str = byte_to_string(last_line_b)
     # !The last line does not include 0x424d
     # We choose the particles under atmospheric conditions per the datasheet.
@@ -37,9 +40,8 @@ while True:
             # print("-"*10, "No decimal", "-"*10)
             print(f"PM1.0: {int(data_1, 16)} | PM 2.5: {int(data_2, 16)} | PM 10: {int(data_3, 16)} || Unit: ug/m3")
             print(f"PM1.0: {int(data_1, 16)} | PM 2.5: {int(data_2, 16)} | PM 10: {int(data_3, 16)} || Unit: ug/m3", file=f)
-        except:
+        except ValueError:
             print("Error! Bits are short... looping again...")
             print("Error! Bits are short... looping again...", file=f)
-            #time.sleep(TIME_DELAY)
-            continue
+    # Always wait for the next frame, so that a bad link never spins a core.
     time.sleep(TIME_DELAY)
\ No newline at end of file
@@ -0,0 +1,92 @@
+/**
+ * @file  dash.c
+ * @brief Incremental rendering of fixed-layout fields on an ANSI terminal
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dash.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Append a number, without padding; return its length
+static uint16_t dash_put_u8(char *out, uint8_t v)
+{
+	uint16_t n = 0;
+
+	if (v >= 100)
+		out[n++] = (char)('0' + v / 100);
+	if (v >= 10)
+		out[n++] = (char)('0' + (v / 10) % 10);
+	out[n++] = (char)('0' + v % 10);
+	return n;
+}
+
+void dash_invalidate(dash_t *d)
+{
+	d->valid = 0;
+	d->row = 0;
+	d->col = 0;
+}
+
+void dash_begin(dash_t *d)
+{
+	d->row = 0;
+	d->col = 0;
+}
+
+uint16_t dash_field(dash_t *d, const dash_field_t *f, uint8_t id, const char *text,
+		    char *out, uint16_t max)
+{
+	char cur[DASH_MAX_WIDTH];
+	uint8_t w = (f->width < DASH_MAX_WIDTH) ? f->width : DASH_MAX_WIDTH;
+	uint8_t len = 0, first, last, col;
+	uint16_t n = 0;
+
+	// Lay the text out as it should appear.
+	while (len < w && text[len] != '\0')
+		++len;
+	memset(cur, ' ', w);
+	memcpy(&cur[(f->align == DASH_ALIGN_RIGHT) ? (w - len) : 0], text, len);
+
+	// Find the run that differs from the shadow.
+	if ((d->valid & (1ul << id)) != 0) {
+		for (first = 0; first < w && cur[first] == d->shadow[id][first]; ++first)
+			;
+		if (first == w)
+			return 0;
+		for (last = (uint8_t)(w - 1); cur[last] == d->shadow[id][last]; --last)
+			;
+	} else {
+		first = 0;
+		last  = (uint8_t)(w - 1);
+	}
+	col = (uint8_t)(f->col + first);
+
+	// ESC [ rrr ; ccc H, then the run
+	if (max < 10 + (last - first + 1)) {
+		d->valid &= ~(1ul << id);
+		return 0;
+	}
+	if (d->row != f->row || d->col != col) {
+		out[n++] = '\033';
+		out[n++] = '[';
+		n += dash_put_u8(&out[n], f->row);
+		out[n++] = ';';
+		n += dash_put_u8(&out[n], col);
+		out[n++] = 'H';
+	}
+	memcpy(&out[n], &cur[first], last - first + 1);
+	n += last - first + 1;
+
+	memcpy(d->shadow[id], cur, w);
+	d->valid |= (1ul << id);
+	d->row = f->row;
+	d->col = (uint8_t)(f->col + last + 1);
+	return n;
+}
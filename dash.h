@@ -0,0 +1,91 @@
+/**
+ * @file  dash.h
+ * @brief Incremental rendering of fixed-layout fields on an ANSI terminal
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       renderer can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * A dashboard is a set of fields, each at a fixed row and column with a
+ * fixed width. The text last rendered into each field is kept as a shadow;
+ * rendering a field again emits only the run of characters that differ from
+ * it, preceded by a cursor move (ESC [ row ; col H) unless the cursor is
+ * already there from the previous run. A reading that goes from 123 to 124
+ * thus costs one cursor move and one digit.
+ *
+ * The cursor position is only trusted within a render pass (between
+ * dash_begin() and the last dash_field()), as anything else sent to the
+ * terminal in between may move it.
+ */
+
+#if !defined(EEE192_DASH_H_)
+#define EEE192_DASH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Largest number of fields
+#define DASH_MAX_FIELDS		24
+
+/// Largest width of a field
+#define DASH_MAX_WIDTH		24
+
+/// Field alignments
+#define DASH_ALIGN_LEFT		0
+#define DASH_ALIGN_RIGHT	1
+
+/// Placement of a field; rows and columns start at 1
+typedef struct dash_field_type {
+	uint8_t row;
+	uint8_t col;
+	uint8_t width;
+	uint8_t align;
+} dash_field_t;
+
+/// Renderer state
+typedef struct dash_type {
+	/// Text last rendered into each field, padded to its width
+	char shadow[DASH_MAX_FIELDS][DASH_MAX_WIDTH];
+
+	/// Whether each shadow matches the screen
+	uint32_t valid;
+
+	/// Cursor position (0: unknown)
+	uint8_t row;
+	uint8_t col;
+} dash_t;
+
+/// Forget all shadows, so that the next pass repaints every field
+void dash_invalidate(dash_t *d);
+
+/// Start a render pass
+void dash_begin(dash_t *d);
+
+/**
+ * Render a field
+ *
+ * @param[in,out]	d	State
+ * @param[in]		f	Placement; its index is @c id
+ * @param[in]		id	Field index, below @c DASH_MAX_FIELDS
+ * @param[in]		text	Text; truncated to the field width, and padded
+ *				with spaces as aligned
+ * @param[out]		out	Where to append the output
+ * @param[in]		max	Room left in @c out
+ *
+ * @return	Number of bytes appended; zero if nothing changed, or if it
+ *		did not fit (the field is then rendered in full next time)
+ */
+uint16_t dash_field(dash_t *d, const dash_field_t *f, uint8_t id, const char *text,
+		    char *out, uint16_t max);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_DASH_H_)
@@ -0,0 +1,125 @@
+/**
+ * @file  fmt.c
+ * @brief Allocation-free formatting of integers and fixed-point numbers
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fmt.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Largest number of decimal digits in a uint32_t
+#define FMT_U32_DIGITS	10
+
+// Write the decimal digits of v backwards, ending at end; return the first
+static char *fmt_digits(char *end, uint32_t v)
+{
+	do {
+		*--end = (char)('0' + (v % 10));
+		v /= 10;
+	} while (v != 0);
+	return end;
+}
+
+void fmt_init(fmt_t *f, char *buf, uint16_t size)
+{
+	f->buf      = buf;
+	f->size     = size;
+	f->len      = 0;
+	f->overflow = false;
+	buf[0] = '\0';
+}
+
+void fmt_mem(fmt_t *f, const char *s, uint16_t len)
+{
+	uint16_t room = (uint16_t)(f->size - 1 - f->len);
+
+	if (len > room) {
+		len = room;
+		f->overflow = true;
+	}
+	memcpy(&f->buf[f->len], s, len);
+	f->len = (uint16_t)(f->len + len);
+	f->buf[f->len] = '\0';
+}
+
+void fmt_str(fmt_t *f, const char *s)
+{
+	fmt_mem(f, s, (uint16_t)strlen(s));
+}
+
+void fmt_char(fmt_t *f, char c)
+{
+	fmt_mem(f, &c, 1);
+}
+
+void fmt_u32(fmt_t *f, uint32_t v)
+{
+	char tmp[FMT_U32_DIGITS];
+	char *p = fmt_digits(&tmp[sizeof(tmp)], v);
+
+	fmt_mem(f, p, (uint16_t)(&tmp[sizeof(tmp)] - p));
+}
+
+void fmt_i32(fmt_t *f, int32_t v)
+{
+	if (v < 0) {
+		fmt_char(f, '-');
+		fmt_u32(f, 0u - (uint32_t)v);
+	} else {
+		fmt_u32(f, (uint32_t)v);
+	}
+}
+
+void fmt_u32_pad(fmt_t *f, uint32_t v, uint8_t width, char pad)
+{
+	char tmp[FMT_U32_DIGITS];
+	char *p = fmt_digits(&tmp[sizeof(tmp)], v);
+	uint16_t len = (uint16_t)(&tmp[sizeof(tmp)] - p);
+
+	for (; width > len; --width)
+		fmt_char(f, pad);
+	fmt_mem(f, p, len);
+}
+
+void fmt_fixed(fmt_t *f, int32_t v, uint8_t frac)
+{
+	char tmp[FMT_U32_DIGITS + 2];
+	char *end = &tmp[sizeof(tmp)], *p = end;
+	uint32_t u = (v < 0) ? (0u - (uint32_t)v) : (uint32_t)v;
+	uint8_t x;
+
+	if (frac > 9)
+		frac = 9;
+	for (x = 0; x < frac; ++x) {
+		*--p = (char)('0' + (u % 10));
+		u /= 10;
+	}
+	if (frac > 0)
+		*--p = '.';
+	p = fmt_digits(p, u);
+	if (v < 0)
+		*--p = '-';
+	fmt_mem(f, p, (uint16_t)(end - p));
+}
+
+void fmt_hex(fmt_t *f, uint32_t v, uint8_t digits)
+{
+	static const char hex[16] = "0123456789ABCDEF";
+	char tmp[8];
+	char *end = &tmp[sizeof(tmp)], *p = end;
+
+	if (digits > sizeof(tmp))
+		digits = sizeof(tmp);
+	do {
+		*--p = hex[v & 0x0F];
+		v >>= 4;
+	} while (v != 0 || (end - p) < digits);
+	fmt_mem(f, p, (uint16_t)(end - p));
+}
@@ -0,0 +1,101 @@
+/**
+ * @file  fmt.h
+ * @brief Allocation-free formatting of integers and fixed-point numbers
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       formatter can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * Text is appended to a caller-provided buffer through one function per
+ * type, so that every argument is checked by the compiler against its
+ * prototype, and nothing is parsed at run time; literals go through
+ * fmt_lit(), which only accepts string literals and takes their length at
+ * compile time. Output that does not fit is cut short and remembered in
+ * fmt_t::overflow; the buffer is always NUL-terminated.
+ *
+ * This stands in for snprintf(), which pulls most of the C library's stdio
+ * (and its run time depends on the format string) into the firmware.
+ */
+
+#if !defined(EEE192_FMT_H_)
+#define EEE192_FMT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Output buffer
+typedef struct fmt_type {
+	char *buf;
+
+	/// Size of @c buf, including room for the terminating NUL
+	uint16_t size;
+
+	/// Number of characters written so far
+	uint16_t len;
+
+	/// Whether anything had to be left out
+	bool overflow;
+} fmt_t;
+
+/// Start writing into a buffer of @c size bytes (at least 1)
+void fmt_init(fmt_t *f, char *buf, uint16_t size);
+
+/// Append @c len bytes
+void fmt_mem(fmt_t *f, const char *s, uint16_t len);
+
+/// Append a NUL-terminated string
+void fmt_str(fmt_t *f, const char *s);
+
+/// Append a string literal, whose length is known at compile time
+#define fmt_lit(f, s)	fmt_mem((f), "" s "", (uint16_t)(sizeof(s) - 1))
+
+/// Append a single character
+void fmt_char(fmt_t *f, char c);
+
+/// Append an unsigned decimal number
+void fmt_u32(fmt_t *f, uint32_t v);
+
+/// Append a signed decimal number
+void fmt_i32(fmt_t *f, int32_t v);
+
+/**
+ * Append an unsigned decimal number, right-aligned in a field
+ *
+ * @param[in,out]	f	Output
+ * @param[in]		v	Value
+ * @param[in]		width	Smallest number of characters
+ * @param[in]		pad	Padding character, e.g. ' ' or '0'
+ */
+void fmt_u32_pad(fmt_t *f, uint32_t v, uint8_t width, char pad);
+
+/**
+ * Append a fixed-point number
+ *
+ * @param[in,out]	f	Output
+ * @param[in]		v	Value, in units of 10^-@c frac
+ * @param[in]		frac	Number of digits after the decimal point (0..9)
+ *
+ * E.g. @code fmt_fixed(f, -1234, 2) @endcode appends "-12.34".
+ */
+void fmt_fixed(fmt_t *f, int32_t v, uint8_t frac);
+
+/**
+ * Append a hexadecimal number, in upper case, without prefix
+ *
+ * @param[in,out]	f	Output
+ * @param[in]		v	Value
+ * @param[in]		digits	Smallest number of digits (zero-padded)
+ */
+void fmt_hex(fmt_t *f, uint32_t v, uint8_t digits);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_FMT_H_)
@@ -0,0 +1,119 @@
+/**
+ * @file  hampel.c
+ * @brief Spike rejection (sliding Hampel filter) for PMS mass concentrations
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hampel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+#if (HAMPEL_WINDOW % 2) == 0
+#error "HAMPEL_WINDOW must be odd"
+#endif
+
+// Replace the oldest reading of a full window (or append) with v
+static void hampel_push(hampel_window_t *w, uint16_t v)
+{
+	unsigned int x = w->nr;
+
+	if (w->nr == HAMPEL_WINDOW) {
+		// Take the oldest reading out of the sorted window.
+		uint16_t old = w->ring[w->head];
+
+		for (x = 0; w->sorted[x] != old; ++x)
+			;
+		for (; x + 1 < HAMPEL_WINDOW; ++x)
+			w->sorted[x] = w->sorted[x + 1];
+		w->ring[w->head] = v;
+		w->head = (uint8_t)((w->head + 1) % HAMPEL_WINDOW);
+	} else {
+		w->ring[w->nr++] = v;
+	}
+
+	// Shift the new one in from the top.
+	for (; x > 0 && w->sorted[x - 1] > v; --x)
+		w->sorted[x] = w->sorted[x - 1];
+	w->sorted[x] = v;
+}
+
+/*
+ * Median absolute deviation of a window around its median sorted[m]
+ *
+ * Below the median, deviations grow downwards; above it, upwards. Merging
+ * both runs from the middle, the (m)th deviation after the median's own zero
+ * is the MAD.
+ */
+static uint16_t hampel_mad(const hampel_window_t *w, unsigned int m)
+{
+	uint16_t med = w->sorted[m], d = 0;
+	unsigned int lo = m, hi = m + 1, x;
+
+	for (x = 0; x < m; ++x) {
+		uint16_t dl = (lo > 0) ? (uint16_t)(med - w->sorted[lo - 1]) : UINT16_MAX;
+		uint16_t dh = (hi < w->nr) ? (uint16_t)(w->sorted[hi] - med) : UINT16_MAX;
+
+		if (dl <= dh) {
+			d = dl;
+			--lo;
+		} else {
+			d = dh;
+			++hi;
+		}
+	}
+	return d;
+}
+
+// Filter one reading; return whether it was clamped
+static bool hampel_channel(hampel_window_t *w, const hampel_cfg_t *cfg, uint16_t *v)
+{
+	unsigned int m;
+	uint32_t band, b;
+	uint16_t med, delta;
+
+	hampel_push(w, *v);
+	if (w->nr <= HAMPEL_WINDOW / 2)
+		return false;
+
+	m = w->nr / 2;
+	med = w->sorted[m];
+	band = (uint32_t)(((uint64_t)hampel_mad(w, m) * HAMPEL_MAD_SCALE * cfg->k) /
+		(HAMPEL_K_ONE * HAMPEL_K_ONE));
+	if (band < cfg->abs_band)
+		band = cfg->abs_band;
+	b = ((uint32_t)med * cfg->rel_band) / HAMPEL_REL_ONE;
+	if (band < b)
+		band = b;
+
+	delta = (*v > med) ? (uint16_t)(*v - med) : (uint16_t)(med - *v);
+	if (delta <= band)
+		return false;
+	*v = med;
+	return true;
+}
+
+void hampel_init(hampel_state_t *st)
+{
+	memset(st, 0, sizeof(*st));
+}
+
+bool hampel_apply(hampel_state_t *st, const hampel_cfg_t *cfg, pms_frame_t *frame)
+{
+	bool clamped = false;
+	unsigned int x;
+
+	for (x = 0; x < PMS_NR_PM; ++x) {
+		clamped |= hampel_channel(&st->win[x], cfg, &frame->pm_cf1[x]);
+		clamped |= hampel_channel(&st->win[PMS_NR_PM + x], cfg, &frame->pm_atm[x]);
+	}
+	++st->nr_frames;
+	if (clamped)
+		++st->nr_clamped;
+	return clamped;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file  hampel.h
+ * @brief Spike rejection (sliding Hampel filter) for PMS mass concentrations
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       filter can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * Each PM channel (CF=1 and atmospheric) keeps the last HAMPEL_WINDOW
+ * readings, both in arrival order and sorted. A reading is an outlier if it
+ * is further from the window median than the band, in which case it is
+ * replaced by the median (clamped). The band is the largest of:
+ *
+ * - k times the median absolute deviation (MAD) of the window, scaled to a
+ *   standard deviation (x 1.4826), with k in 1/HAMPEL_K_ONE;
+ * - an absolute amount, so that a window of identical readings (MAD = 0)
+ *   does not clamp every small change;
+ * - a fraction of the median, which scales with the reading.
+ *
+ * Particle counts pass through untouched.
+ *
+ * Updating a channel takes O(HAMPEL_WINDOW) steps, with no division: the
+ * oldest reading is taken out of the sorted window and the new one shifted
+ * in, and as the deviations from the median grow outwards from the middle
+ * of the sorted window, the MAD is found by merging both sides.
+ *
+ * NOTE: The window is causal; a genuine step is clamped for the first
+ *       HAMPEL_WINDOW/2 frames, until it holds the median. Readings that were
+ *       clamped still enter the window as received.
+ */
+
+#if !defined(EEE192_HAMPEL_H_)
+#define EEE192_HAMPEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pms.h"
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Number of readings per window; must be odd
+#define HAMPEL_WINDOW		7
+
+/// Number of channels filtered: PM (CF=1), then PM (atmospheric)
+#define HAMPEL_NR_CHANNELS	(2 * PMS_NR_PM)
+
+/// Denominator of @c k
+#define HAMPEL_K_ONE		256
+
+/// Denominator of relative bands
+#define HAMPEL_REL_ONE		1024
+
+/// MAD-to-standard-deviation factor (1.4826), in 1/HAMPEL_K_ONE
+#define HAMPEL_MAD_SCALE	380
+
+/// Filter configuration
+typedef struct hampel_cfg_type {
+	/// Band, in standard deviations (1/@c HAMPEL_K_ONE)
+	uint16_t k;
+
+	/// Smallest band, in ug/m3
+	uint16_t abs_band;
+
+	/// Smallest band relative to the median, in 1/@c HAMPEL_REL_ONE
+	uint16_t rel_band;
+} hampel_cfg_t;
+
+/// Window of one channel
+typedef struct hampel_window_type {
+	/// Readings in arrival order (ring), and sorted
+	uint16_t ring[HAMPEL_WINDOW];
+	uint16_t sorted[HAMPEL_WINDOW];
+
+	/// Number of readings held, and index of the oldest
+	uint8_t nr;
+	uint8_t head;
+} hampel_window_t;
+
+/// Filter state
+typedef struct hampel_state_type {
+	hampel_window_t win[HAMPEL_NR_CHANNELS];
+
+	/// Number of frames filtered
+	uint32_t nr_frames;
+
+	/// Number of frames with at least one channel clamped
+	uint32_t nr_clamped;
+} hampel_state_t;
+
+/// Reset the filter, including its counters
+void hampel_init(hampel_state_t *st);
+
+/**
+ * Filter a frame
+ *
+ * @param[in,out]	st	State
+ * @param[in]		cfg	Configuration
+ * @param[in,out]	frame	Decoded frame; outlying PM readings are
+ *				replaced by their window median
+ *
+ * @return	@c true if any reading was clamped, @c false otherwise
+ *
+ * @note
+ * Nothing is clamped until a window holds more than half of
+ * @c HAMPEL_WINDOW readings.
+ */
+bool hampel_apply(hampel_state_t *st, const hampel_cfg_t *cfg, pms_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_HAMPEL_H_)
@@ -0,0 +1,184 @@
+/**
+ * @file  host/aggregate.cpp
+ * @brief Parallel time-range aggregation over PM archives
+ */
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "aggregate.h"
+#include "pool.h"
+
+namespace pms {
+
+/// Number of chunks scanned per thread between two merges
+constexpr size_t AGG_WINDOW_PER_THREAD = 16;
+
+namespace {
+
+struct chunk_task {
+	const sample *records;
+	const archive_chunk *chunk;
+};
+
+// Whether any sample of a chunk may match, judging from its index entry
+bool chunk_may_match(const agg_query &q, const archive_chunk &c)
+{
+	if (c.nr_records == 0 || c.ts_last < q.from || c.ts_first >= q.until)
+		return false;
+	if (!q.devices.empty()) {
+		auto it = std::lower_bound(q.devices.begin(), q.devices.end(), c.device_min);
+
+		if (it == q.devices.end() || *it > c.device_max)
+			return false;
+	}
+	for (const agg_filter &f : q.filters) {
+		if (c.pm_max[f.ch] < f.lo || c.pm_min[f.ch] > f.hi)
+			return false;
+	}
+	return true;
+}
+
+// Aggregate the matching samples of one chunk; return how many matched
+uint64_t scan_chunk(const agg_query &q, const chunk_task &t, std::vector<rollup_row> *out)
+{
+	const sample *s = t.records + t.chunk->first_record;
+	const int64_t whole = (q.from == INT64_MIN) ? 0 : q.from;
+	int64_t cur = 0;
+	uint64_t nr_matched = 0;
+	bool have = false;
+
+	// Rows of the current bucket, by device, and the last one used
+	std::unordered_map<uint32_t, size_t> rows;
+	size_t last = 0;
+
+	for (uint32_t x = 0; x < t.chunk->nr_records; ++x) {
+		const sample &r = s[x];
+		bool keep = r.ts_ms >= q.from && r.ts_ms < q.until;
+
+		for (size_t y = 0; keep && y < q.filters.size(); ++y) {
+			const agg_filter &f = q.filters[y];
+
+			keep = r.pm_atm[f.ch] >= f.lo && r.pm_atm[f.ch] <= f.hi;
+		}
+		if (keep && !q.devices.empty())
+			keep = std::binary_search(q.devices.begin(), q.devices.end(), r.device);
+		if (!keep)
+			continue;
+		++nr_matched;
+
+		// Samples are in time order, so rows of earlier buckets are done.
+		const int64_t b = (q.bucket_ms > 0) ? rollup_bucket_start(r.ts_ms, q.bucket_ms) : whole;
+		const uint32_t dev = q.by_device ? r.device : AGG_ALL_DEVICES;
+
+		if (!have || b != cur) {
+			cur = b;
+			rows.clear();
+			last = out->size();
+			have = true;
+		}
+		if (last == out->size() || (*out)[last].device != dev) {
+			auto it = rows.emplace(dev, out->size());
+
+			if (it.second) {
+				rollup_row row{};
+
+				row.ts_ms  = b;
+				row.device = dev;
+				out->push_back(row);
+			}
+			last = it.first->second;
+		}
+
+		rollup_row &row = (*out)[last];
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+			const uint16_t v = r.pm_atm[ch];
+
+			row.sum[ch]    += v;
+			row.sum_sq[ch] += (uint64_t)v * v;
+			row.min[ch]     = (row.count == 0) ? v : std::min(row.min[ch], v);
+			row.max[ch]     = (row.count == 0) ? v : std::max(row.max[ch], v);
+		}
+		++row.count;
+	}
+	return nr_matched;
+}
+
+}	// namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+void aggregate(const std::vector<const archive_reader *> &archives, const agg_query &q,
+	       unsigned int nr_threads, const std::function<void(const rollup_row &)> &emit,
+	       agg_stats *stats)
+{
+	typedef std::pair<int64_t, uint32_t> key_t;	// (bucket start, device)
+	std::vector<chunk_task> tasks;
+	std::map<key_t, rollup_row> pending;
+	agg_stats st;
+
+	for (const archive_reader *ar : archives) {
+		const archive_header &h = ar->header();
+
+		st.nr_chunks += h.nr_chunks;
+		for (uint32_t x = 0; x < h.nr_chunks; ++x) {
+			if (chunk_may_match(q, ar->chunks()[x]))
+				tasks.push_back(chunk_task{ ar->records(), &ar->chunks()[x] });
+		}
+	}
+	st.nr_pruned = st.nr_chunks - tasks.size();
+	std::stable_sort(tasks.begin(), tasks.end(), [](const chunk_task &a, const chunk_task &b) {
+		return a.chunk->ts_first < b.chunk->ts_first;
+	});
+
+	work_pool pool(nr_threads);
+	const size_t window = (size_t)pool.nr_workers() * AGG_WINDOW_PER_THREAD;
+	std::vector<std::vector<rollup_row>> parts(window);
+	std::vector<uint64_t> matched(window);
+
+	// Hand out every pending row whose bucket ends at or before frontier.
+	auto flush = [&](int64_t frontier, bool all) {
+		auto it = pending.begin();
+
+		for (; it != pending.end(); ++it) {
+			if (!all && (q.bucket_ms == 0 || it->first.first + q.bucket_ms > frontier))
+				break;
+			emit(it->second);
+			++st.nr_rows;
+		}
+		pending.erase(pending.begin(), it);
+	};
+
+	for (size_t base = 0; base < tasks.size(); base += window) {
+		const size_t n = std::min(window, tasks.size() - base);
+
+		pool.run(n, [&](unsigned int, size_t x) {
+			parts[x].clear();
+			matched[x] = scan_chunk(q, tasks[base + x], &parts[x]);
+		});
+
+		for (size_t x = 0; x < n; ++x) {
+			st.nr_scanned += tasks[base + x].chunk->nr_records;
+			st.nr_matched += matched[x];
+			for (const rollup_row &r : parts[x]) {
+				auto it = pending.emplace(key_t(r.ts_ms, r.device), r);
+
+				if (!it.second)
+					it.first->second.merge(r);
+			}
+		}
+
+		// Chunks left to scan all start at or after the next one.
+		if (base + n < tasks.size())
+			flush(tasks[base + n].chunk->ts_first, false);
+	}
+	flush(INT64_MAX, true);
+
+	st.nr_steals = pool.nr_steals();
+	if (stats != nullptr)
+		*stats = st;
+}
+
+}	// namespace pms
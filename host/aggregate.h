@@ -0,0 +1,91 @@
+/**
+ * @file  host/aggregate.h
+ * @brief Parallel time-range aggregation over PM archives
+ */
+
+/*
+ * A query selects samples by time range, device and per-channel PM bounds,
+ * then groups them by time bucket (and optionally by device) into
+ * count/sum/min/max/sum-of-squares rows, i.e. the same mergeable aggregates
+ * as the rollups (see rollup.h).
+ *
+ * The chunk index of every archive is checked first: chunks whose time span,
+ * device span or PM extremes cannot match are never touched. The remaining
+ * chunks are sorted by start time and scanned in windows on a work pool (see
+ * pool.h), each chunk into its own small set of partial rows. After each
+ * window the partial rows are merged, and every bucket that ends before the
+ * next unscanned chunk begins is final, so it is handed out right away; a
+ * multi-year query thus streams its rows in time order with bounded memory.
+ */
+
+#if !defined(EEE192_HOST_AGGREGATE_H_)
+#define EEE192_HOST_AGGREGATE_H_
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "archive.h"
+#include "rollup.h"
+#include "sample.h"
+
+namespace pms {
+
+/// Device identifier of rows not grouped by device
+constexpr uint32_t AGG_ALL_DEVICES = UINT32_MAX;
+
+/// Keep only samples whose @c pm_atm[ch] lies within [lo, hi]
+struct agg_filter {
+	unsigned int ch;
+	uint16_t lo;
+	uint16_t hi;
+};
+
+/// Query description
+struct agg_query {
+	/// Time range [from, until), in milliseconds since the Unix epoch
+	int64_t from  = INT64_MIN;
+	int64_t until = INT64_MAX;
+
+	/// Devices to keep, sorted (empty: all)
+	std::vector<uint32_t> devices;
+
+	/// PM bounds, all of which must hold
+	std::vector<agg_filter> filters;
+
+	/// Bucket width, in milliseconds (0: one bucket, starting at @c from)
+	int64_t bucket_ms = 0;
+
+	/// Whether rows are kept per device, or merged across devices
+	bool by_device = true;
+};
+
+/// Counters of one query
+struct agg_stats {
+	uint64_t nr_chunks = 0;
+	uint64_t nr_pruned = 0;
+	uint64_t nr_scanned = 0;
+	uint64_t nr_matched = 0;
+	uint64_t nr_rows = 0;
+	uint64_t nr_steals = 0;
+};
+
+/**
+ * Run a query over a set of archives
+ *
+ * @param[in]	archives	Open archives
+ * @param[in]	q		Query
+ * @param[in]	nr_threads	Number of threads to scan with
+ * @param[in]	emit		Called once per final row, in (ts_ms, device)
+ *				order, from the calling thread
+ * @param[out]	stats		Counters (optional)
+ */
+void aggregate(const std::vector<const archive_reader *> &archives, const agg_query &q,
+	       unsigned int nr_threads, const std::function<void(const rollup_row &)> &emit,
+	       agg_stats *stats = nullptr);
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_AGGREGATE_H_)
@@ -0,0 +1,219 @@
+/**
+ * @file  host/archive.cpp
+ * @brief Sorted, chunk-indexed on-disk store of PM samples
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archive.h"
+
+namespace pms {
+
+/////////////////////////////////////////////////////////////////////////////
+
+archive_writer::~archive_writer()
+{
+	if (fp_ != nullptr)
+		close();
+}
+
+bool archive_writer::open(const char *path, uint32_t chunk_records)
+{
+	if (fp_ != nullptr || chunk_records == 0) {
+		errno = EINVAL;
+		return false;
+	}
+
+	fp_ = std::fopen(path, "wb");
+	if (fp_ == nullptr)
+		return false;
+
+	std::memset(&hdr_, 0, sizeof(hdr_));
+	std::memcpy(hdr_.magic, ARCHIVE_MAGIC, sizeof(hdr_.magic));
+	hdr_.version       = ARCHIVE_VERSION;
+	hdr_.record_size   = sizeof(sample);
+	hdr_.chunk_records = chunk_records;
+
+	pending_.clear();
+	pending_.reserve(chunk_records);
+	index_.clear();
+	failed_ = false;
+
+	// The header is rewritten with the final counts on close().
+	if (std::fwrite(&hdr_, sizeof(hdr_), 1, fp_) != 1)
+		failed_ = true;
+	return !failed_;
+}
+
+bool archive_writer::append(const sample &s)
+{
+	if (fp_ == nullptr || failed_)
+		return false;
+
+	// Enforce (ts_ms, device) order, which the chunk index relies upon.
+	if (hdr_.nr_records > 0 &&
+	    (s.ts_ms < last_.ts_ms ||
+	     (s.ts_ms == last_.ts_ms && s.device < last_.device)))
+		return false;
+	last_ = s;
+
+	pending_.push_back(s);
+	++hdr_.nr_records;
+	if (pending_.size() >= hdr_.chunk_records)
+		return flush_chunk();
+	return true;
+}
+
+bool archive_writer::flush_chunk()
+{
+	archive_chunk c;
+
+	if (pending_.empty())
+		return true;
+
+	std::memset(&c, 0, sizeof(c));
+	c.ts_first     = pending_.front().ts_ms;
+	c.ts_last      = pending_.back().ts_ms;
+	c.first_record = hdr_.nr_records - pending_.size();
+	c.nr_records   = (uint32_t)pending_.size();
+	c.device_min   = UINT32_MAX;
+	for (unsigned int x = 0; x < PMS_NR_PM; ++x)
+		c.pm_min[x] = UINT16_MAX;
+
+	for (const sample &s : pending_) {
+		c.device_min = std::min(c.device_min, s.device);
+		c.device_max = std::max(c.device_max, s.device);
+		for (unsigned int x = 0; x < PMS_NR_PM; ++x) {
+			c.pm_min[x] = std::min(c.pm_min[x], s.pm_atm[x]);
+			c.pm_max[x] = std::max(c.pm_max[x], s.pm_atm[x]);
+		}
+	}
+
+	if (std::fwrite(pending_.data(), sizeof(sample), pending_.size(), fp_) != pending_.size()) {
+		failed_ = true;
+		return false;
+	}
+	index_.push_back(c);
+	pending_.clear();
+	return true;
+}
+
+bool archive_writer::close()
+{
+	bool ok = !failed_;
+
+	if (fp_ == nullptr)
+		return false;
+
+	if (ok)
+		ok = flush_chunk();
+	if (ok) {
+		hdr_.index_offset = sizeof(hdr_) + hdr_.nr_records * sizeof(sample);
+		hdr_.nr_chunks    = (uint32_t)index_.size();
+		if (!index_.empty()) {
+			hdr_.ts_first = index_.front().ts_first;
+			hdr_.ts_last  = index_.back().ts_last;
+		}
+		ok = std::fwrite(index_.data(), sizeof(archive_chunk), index_.size(), fp_) == index_.size();
+	}
+	if (ok)
+		ok = std::fseek(fp_, 0, SEEK_SET) == 0 &&
+		     std::fwrite(&hdr_, sizeof(hdr_), 1, fp_) == 1;
+
+	if (std::fclose(fp_) != 0)
+		ok = false;
+	fp_ = nullptr;
+	index_.clear();
+	return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+archive_reader::~archive_reader()
+{
+	close();
+}
+
+bool archive_reader::open(const char *path)
+{
+	struct stat st;
+	int fd;
+
+	close();
+	fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(archive_header)) {
+		::close(fd);
+		errno = EINVAL;
+		return false;
+	}
+
+	map_len_ = (size_t)st.st_size;
+	map_ = mmap(nullptr, map_len_, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map_ == MAP_FAILED) {
+		map_ = nullptr;
+		return false;
+	}
+
+	// Validate before handing out any pointers.
+	hdr_ = static_cast<const archive_header *>(map_);
+	if (std::memcmp(hdr_->magic, ARCHIVE_MAGIC, sizeof(hdr_->magic)) != 0 ||
+	    hdr_->version != ARCHIVE_VERSION ||
+	    hdr_->record_size != sizeof(sample) ||
+	    hdr_->nr_records > (map_len_ - sizeof(archive_header)) / sizeof(sample) ||
+	    hdr_->index_offset != sizeof(archive_header) + hdr_->nr_records * sizeof(sample) ||
+	    hdr_->index_offset + (uint64_t)hdr_->nr_chunks * sizeof(archive_chunk) > map_len_) {
+		close();
+		errno = EINVAL;
+		return false;
+	}
+
+	records_ = reinterpret_cast<const sample *>(static_cast<const char *>(map_) + sizeof(archive_header));
+	chunks_  = reinterpret_cast<const archive_chunk *>(static_cast<const char *>(map_) + hdr_->index_offset);
+	if (!valid_index()) {
+		close();
+		errno = EINVAL;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Readers index samples through the chunks alone, so the chunks must cover
+ * the samples exactly: in order, back to back, and ending at nr_records.
+ */
+bool archive_reader::valid_index() const
+{
+	uint64_t next = 0;
+
+	for (uint32_t x = 0; x < hdr_->nr_chunks; ++x) {
+		const archive_chunk &c = chunks_[x];
+
+		if (c.first_record != next || c.nr_records > hdr_->nr_records - next)
+			return false;
+		next += c.nr_records;
+	}
+	return next == hdr_->nr_records;
+}
+
+void archive_reader::close()
+{
+	if (map_ != nullptr)
+		munmap(map_, map_len_);
+	map_ = nullptr;
+	map_len_ = 0;
+	hdr_ = nullptr;
+	records_ = nullptr;
+	chunks_ = nullptr;
+}
+
+}	// namespace pms
@@ -0,0 +1,193 @@
+/**
+ * @file  host/archive.h
+ * @brief Sorted, chunk-indexed on-disk store of PM samples
+ */
+
+/*
+ * File layout (native byte order; archives are not meant to be moved across
+ * architectures):
+ *
+ *   +----------------------+  offset 0
+ *   | archive_header       |
+ *   +----------------------+  offset sizeof(archive_header)
+ *   | sample[nr_records]   |  sorted by (ts_ms, device)
+ *   +----------------------+  offset index_offset
+ *   | archive_chunk[...]   |  one entry per ARCHIVE_CHUNK_RECORDS samples
+ *   +----------------------+
+ *
+ * The chunk index carries enough metadata (time span, device span, PM
+ * extremes) for readers to skip whole chunks without touching the samples.
+ */
+
+#if !defined(EEE192_HOST_ARCHIVE_H_)
+#define EEE192_HOST_ARCHIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Magic string at the start of every archive
+#define ARCHIVE_MAGIC		"PMSARC\r\n"
+
+/// Current archive format revision
+constexpr uint32_t ARCHIVE_VERSION		= 1;
+
+/// Default number of samples per index chunk
+constexpr uint32_t ARCHIVE_CHUNK_RECORDS	= 4096;
+
+/// Archive file header
+struct archive_header {
+	/// @c ARCHIVE_MAGIC, without the terminating NUL
+	char     magic[8];
+
+	/// @c ARCHIVE_VERSION at the time of writing
+	uint32_t version;
+
+	/// Must be equal to @code sizeof(sample) @endcode
+	uint32_t record_size;
+
+	/// Number of samples stored
+	uint64_t nr_records;
+
+	/// File offset of the chunk index
+	uint64_t index_offset;
+
+	/// Number of entries in the chunk index
+	uint32_t nr_chunks;
+
+	/// Number of samples per chunk (the last one may be shorter)
+	uint32_t chunk_records;
+
+	/// Timestamp of the earliest sample
+	int64_t  ts_first;
+
+	/// Timestamp of the latest sample
+	int64_t  ts_last;
+
+	/// Reserved; always zero
+	uint8_t  reserved[8];
+};
+static_assert(sizeof(archive_header) == 64, "archive_header is part of the archive format");
+
+/// Index entry describing a run of consecutive samples
+struct archive_chunk {
+	/// Timestamp of the earliest sample in the chunk
+	int64_t  ts_first;
+
+	/// Timestamp of the latest sample in the chunk
+	int64_t  ts_last;
+
+	/// Index of the first sample of this chunk
+	uint64_t first_record;
+
+	/// Number of samples in this chunk
+	uint32_t nr_records;
+
+	/// Smallest device identifier in this chunk
+	uint32_t device_min;
+
+	/// Largest device identifier in this chunk
+	uint32_t device_max;
+
+	/// Per-channel minimum of @c sample::pm_atm
+	uint16_t pm_min[PMS_NR_PM];
+
+	/// Per-channel maximum of @c sample::pm_atm
+	uint16_t pm_max[PMS_NR_PM];
+};
+static_assert(sizeof(archive_chunk) == 48, "archive_chunk is part of the archive format");
+
+/**
+ * Streaming archive writer
+ *
+ * @note
+ * Samples must be appended in (ts_ms, device) order; the writer only keeps
+ * the chunk being filled and the index in memory.
+ */
+class archive_writer {
+public:
+	archive_writer() = default;
+	~archive_writer();
+
+	archive_writer(const archive_writer &) = delete;
+	archive_writer &operator=(const archive_writer &) = delete;
+
+	/**
+	 * Create (or truncate) an archive
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno)
+	 */
+	bool open(const char *path, uint32_t chunk_records = ARCHIVE_CHUNK_RECORDS);
+
+	/**
+	 * Append one sample
+	 *
+	 * @return	@c true on success, @c false on an I/O error or if the
+	 *		sample is out of order
+	 */
+	bool append(const sample &s);
+
+	/// Flush the last chunk, write the index and close the file
+	bool close();
+
+	/// Number of samples appended so far
+	uint64_t nr_records() const { return hdr_.nr_records; }
+
+private:
+	bool flush_chunk();
+
+	std::FILE *fp_ = nullptr;
+	archive_header hdr_ = {};
+	std::vector<sample> pending_;
+	std::vector<archive_chunk> index_;
+	sample last_ = {};
+	bool failed_ = false;
+};
+
+/**
+ * Memory-mapped, read-only view of an archive
+ *
+ * @note
+ * The mapping stays valid for the lifetime of the reader.
+ */
+class archive_reader {
+public:
+	archive_reader() = default;
+	~archive_reader();
+
+	archive_reader(const archive_reader &) = delete;
+	archive_reader &operator=(const archive_reader &) = delete;
+
+	/**
+	 * Map and validate an archive, including its chunk index
+	 *
+	 * @return	@c true on success, @c false otherwise (@c EINVAL: not an
+	 *		archive, or corrupt or truncated)
+	 */
+	bool open(const char *path);
+
+	/// Unmap the archive, if any
+	void close();
+
+	const archive_header &header() const { return *hdr_; }
+	const sample *records() const { return records_; }
+	const archive_chunk *chunks() const { return chunks_; }
+
+private:
+	bool valid_index() const;
+
+	void *map_ = nullptr;
+	size_t map_len_ = 0;
+	const archive_header *hdr_ = nullptr;
+	const sample *records_ = nullptr;
+	const archive_chunk *chunks_ = nullptr;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_ARCHIVE_H_)
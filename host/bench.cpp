@@ -0,0 +1,861 @@
+/**
+ * @file  host/bench.cpp
+ * @brief pms-bench: decoder throughput and resynchronization benchmarks
+ */
+
+/*
+ * Usage: pms-bench [-n frames] [-s seed] [-f rounds] [-o json]
+ *        pms-bench -p lines
+ *        pms-bench -r consumers
+ *        pms-bench [-s seed] -c rounds
+ *
+ * Synthetic streams (see framegen.h) are pushed through each decoding path:
+ *
+ *   firmware	pms_parser_push(), one byte at a time, as on the board
+ *   stream	stream_decoder, one call per read, as a tailing ingester would
+ *   batch	decode_batch() over 64 KiB blocks, as pms-import does
+ *   model	model_stream<pms5003> (see model.h), one call per read, as
+ *		pms-ingest does
+ *
+ * under several link conditions, and over the firmware's own output, where
+ * each frame is followed by its AQI and timestamp records (the board's
+ * parser never sees those, so the firmware path is left out). For each run, throughput (MB/s, frames/s),
+ * per-call latency (P50/P99/max over reads, or over blocks for the batch
+ * path) and the cost of resynchronization are reported:
+ *
+ *   lost		intact frames that were not decoded, i.e. collateral
+ *			damage of impairments on neighbouring frames
+ *   false	decoded frames that were damaged on the way, yet passed the
+ *		checksum; such a false lock may cost the next frame as well
+ *   skip/event	bytes thrown away per impairment event
+ *   relock	worst distance, in bytes and in milliseconds at 9600 baud,
+ *		from the end of an impairment to the start of the next
+ *		decoded frame
+ *
+ * A table is printed on stdout; with -o, the same results are also written
+ * as JSON so that runs can be compared over time. Streams without
+ * impairments must decode without a single skipped byte or resync, or the
+ * exit status is 1.
+ *
+ * With -f, the given number of randomized rounds (impairment rates, read
+ * sizes) are run instead, checking that every decoder regains lock within
+ * one frame length of each impairment, i.e. never loses an intact frame.
+ * Rounds with false locks are not judged, since the 16-bit checksum cannot
+ * catch every error. The exit status is 1 if any round breaks that bound.
+ *
+ * With -p, the firmware's formatter (../fmt.h) is compared against
+ * snprintf() instead, over the given number of status lines like those the
+ * board sends; both must produce the same text. Time per line is reported in
+ * nanoseconds and, on x86, in TSC cycles. The flash cost on the board is
+ * measured by "make fmt-size" instead, which needs an Arm toolchain.
+ *
+ * With -r, the sample ring (ring.h) is exercised instead: one thread pushes
+ * RING_BENCH_SAMPLES numbered samples into a ring of RING_BENCH_SLOTS, read
+ * in place by the given number of consumer threads, plus one that sleeps
+ * after every batch and so keeps being lapped. The cost per push and each
+ * consumer's counts are reported; every sample a consumer was told is intact
+ * must be the one expected at its place, and every sample must be either
+ * read or lost, or the exit status is 1.
+ *
+ * With -c, the mapping of boards' clocks to wall-clock time (clocksync.h)
+ * is checked instead, over the given number of randomized rounds of
+ * CLOCK_BENCH_SECS frames, one a second: each with its own drift (up to
+ * CLOCK_BENCH_MAX_PPM), link latency, delay jitter with an exponential tail
+ * and rare spikes of over a second, a board reset one third of the way and
+ * a wall-clock step of several seconds, either way, two thirds of the way.
+ * Once CLOCK_BENCH_SETTLE_US of device time has passed since the start or
+ * since either event, every frame must map within CLOCK_BENCH_TOL_US plus a
+ * tenth of the round's jitter of when it began plus the latency, and each
+ * event must start the mapping over exactly once, or the exit status is 1.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../fmt.h"
+#include "clocksync.h"
+#include "decode.h"
+#include "framegen.h"
+#include "model.h"
+#include "ring.h"
+
+using namespace pms;
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+/// Block size for the batch path
+constexpr size_t BATCH_BLOCK = 64 * 1024;
+
+/// How far ahead of the last match a decoded sequence number is looked for
+constexpr size_t MATCH_WINDOW = 256;
+
+/// Time on the wire for one byte at 9600 baud 8N1, in milliseconds
+constexpr double BYTE_TIME_MS = 10.0 / 9600.0 * 1000.0;
+
+/// Number of frames in each fuzzing round
+constexpr size_t FUZZ_FRAMES = 2000;
+
+/// Number of decoding paths
+constexpr int NR_PATHS = 4;
+
+/// Number of samples pushed through the ring, and its size
+constexpr size_t RING_BENCH_SAMPLES = 20 * 1000 * 1000;
+constexpr size_t RING_BENCH_SLOTS = 4096;
+
+/// Largest batch a ring consumer takes at once
+constexpr size_t RING_BENCH_BATCH = 256;
+
+/// Frames in each clock mapping round, one a second
+constexpr int64_t CLOCK_BENCH_SECS = 3 * 3600;
+
+/// Largest drift of a simulated board's clock, in parts per million
+constexpr double CLOCK_BENCH_MAX_PPM = 200.0;
+
+/// Device time after a start or start-over before the mapping is judged
+constexpr int64_t CLOCK_BENCH_SETTLE_US = CLOCK_MIN_SPAN_US + 5 * 60 * 1000000LL;
+
+/// Error allowed on top of a tenth of the round's jitter
+constexpr int64_t CLOCK_BENCH_TOL_US = 2000;
+
+const char *const path_names[NR_PATHS] = { "firmware", "stream", "batch", "model" };
+
+struct scenario {
+	const char *name;
+	double p_bit_error;
+	double p_drop;
+	double p_insert;
+	double p_truncate;
+	size_t read_min;
+	size_t read_max;
+	bool side_records;
+};
+
+const scenario scenarios[] = {
+	{ "clean",     0.0,  0.0,  0.0,  0.0,   4096, 4096, false },
+	{ "split",     0.0,  0.0,  0.0,  0.0,      1,   64, false },
+	{ "fw-output", 0.0,  0.0,  0.0,  0.0,      1,   64, true  },
+	{ "bit-error", 1e-3, 0.0,  0.0,  0.0,     64,  512, false },
+	{ "drop",      0.0,  1e-3, 0.0,  0.0,     64,  512, false },
+	{ "insert",    0.0,  0.0,  1e-3, 0.0,     64,  512, false },
+	{ "truncate",  0.0,  0.0,  0.0,  1e-2,    64,  512, false },
+	{ "noisy",     1e-2, 1e-2, 1e-2, 1e-2,     1,   64, false },
+};
+
+struct result {
+	const char *scenario;
+	const char *path;
+	uint64_t nr_bytes;
+	uint64_t nr_frames;
+	uint64_t nr_events;
+	uint64_t nr_lost;
+	uint64_t nr_false;
+	uint64_t nr_skipped;
+	uint64_t nr_resyncs;
+	uint64_t max_relock;
+	double secs;
+	uint64_t lat_p50_ns;
+	uint64_t lat_p99_ns;
+	uint64_t lat_max_ns;
+};
+
+// Matches decoded frames (which come out in order) against the ground truth
+class matcher {
+public:
+	explicit matcher(const std::vector<framegen_truth> &truth)
+		: truth_(truth), seen_(truth.size(), false)
+	{
+	}
+
+	void operator()(const pms_frame_t &f) { match(f.nr_particles[PMS_NR_BINS - 1]); }
+	void operator()(const sample &s) { match(s.nr_particles[PMS_NR_BINS - 1]); }
+
+	uint64_t nr_lost() const
+	{
+		uint64_t n = 0;
+
+		for (size_t x = 0; x < truth_.size(); ++x) {
+			if (truth_[x].intact && !seen_[x])
+				++n;
+		}
+		return n;
+	}
+
+	uint64_t nr_false() const
+	{
+		uint64_t n = nr_bad_;
+
+		for (size_t x = 0; x < truth_.size(); ++x) {
+			if (!truth_[x].intact && seen_[x])
+				++n;
+		}
+		return n;
+	}
+
+	/*
+	 * Worst distance from the end of an impairment to the next decoded
+	 * frame; this is below PMS_FRAME_LEN as long as the first intact frame
+	 * after each impairment is decoded.
+	 */
+	uint64_t max_relock() const
+	{
+		uint64_t worst = 0;
+		size_t damage_end = 0;
+		bool pending = false;
+
+		for (size_t x = 0; x < truth_.size(); ++x) {
+			const framegen_truth &t = truth_[x];
+
+			if (!t.intact || t.damage_end != 0) {
+				damage_end = std::max(damage_end, t.damage_end);
+				pending = true;
+			}
+			if (pending && seen_[x] && t.offset >= damage_end) {
+				worst = std::max<uint64_t>(worst, t.offset - damage_end);
+				pending = false;
+			}
+		}
+		return worst;
+	}
+
+private:
+	void match(uint16_t seq)
+	{
+		const size_t end = std::min(truth_.size(), next_ + MATCH_WINDOW);
+
+		for (size_t x = next_; x < end; ++x) {
+			if (truth_[x].seq == seq) {
+				seen_[x] = true;
+				next_ = x + 1;
+				return;
+			}
+		}
+		++nr_bad_;
+	}
+
+	const std::vector<framegen_truth> &truth_;
+	std::vector<bool> seen_;
+	size_t next_ = 0;
+	uint64_t nr_bad_ = 0;
+};
+
+uint64_t ns_since(bench_clock::time_point t0)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		bench_clock::now() - t0).count();
+}
+
+void fill_latency(result *r, std::vector<uint64_t> &lat)
+{
+	if (lat.empty())
+		return;
+	std::sort(lat.begin(), lat.end());
+	r->lat_p50_ns = lat[lat.size() / 2];
+	r->lat_p99_ns = lat[std::min(lat.size() - 1, lat.size() * 99 / 100)];
+	r->lat_max_ns = lat.back();
+}
+
+void run_firmware(result *r, const std::vector<uint8_t> &buf,
+		  const std::vector<size_t> &reads, matcher &m)
+{
+	std::vector<uint64_t> lat;
+	pms_parser_t p;
+	pms_frame_t f;
+	size_t pos = 0;
+
+	lat.reserve(reads.size());
+	pms_parser_init(&p);
+	const bench_clock::time_point t0 = bench_clock::now();
+	for (size_t len : reads) {
+		const bench_clock::time_point t1 = bench_clock::now();
+
+		for (size_t x = pos; x < pos + len; ++x) {
+			if (pms_parser_push(&p, buf[x], &f))
+				m(f);
+		}
+		pos += len;
+		lat.push_back(ns_since(t1));
+	}
+	r->secs = (double)ns_since(t0) * 1e-9;
+	r->nr_frames  = p.nr_frames;
+	r->nr_skipped = p.nr_skipped + p.idx;
+	r->nr_resyncs = p.nr_resyncs;
+	fill_latency(r, lat);
+}
+
+template <typename Decoder>
+void run_stream(result *r, const std::vector<uint8_t> &buf,
+		const std::vector<size_t> &reads, matcher &m)
+{
+	typedef typename Decoder::frame_type frame_type;
+	std::vector<uint64_t> lat;
+	Decoder d;
+	size_t pos = 0;
+
+	lat.reserve(reads.size());
+	const bench_clock::time_point t0 = bench_clock::now();
+	for (size_t len : reads) {
+		const bench_clock::time_point t1 = bench_clock::now();
+
+		d.feed(buf.data() + pos, len, [&](const frame_type &f) { m(f); });
+		pos += len;
+		lat.push_back(ns_since(t1));
+	}
+	r->secs = (double)ns_since(t0) * 1e-9;
+	r->nr_frames  = d.stats().nr_frames;
+	r->nr_skipped = d.stats().nr_skipped + d.pending();
+	r->nr_resyncs = d.stats().nr_resyncs;
+	fill_latency(r, lat);
+}
+
+void run_batch(result *r, const std::vector<uint8_t> &buf, matcher &m)
+{
+	std::vector<uint64_t> lat;
+	decode_stats st;
+	size_t pos = 0;
+
+	const bench_clock::time_point t0 = bench_clock::now();
+	while (pos < buf.size()) {
+		const bench_clock::time_point t1 = bench_clock::now();
+		const size_t limit = std::min(BATCH_BLOCK, buf.size() - pos);
+		size_t stop;
+
+		stop = decode_batch(buf.data() + pos, buf.size() - pos, limit, &st,
+			[&](const pms_frame_t &f, size_t) { m(f); });
+		// Frames may run past the block; carry on from where scanning stopped.
+		pos += std::max(stop, limit);
+		lat.push_back(ns_since(t1));
+	}
+	r->secs = (double)ns_since(t0) * 1e-9;
+	r->nr_frames  = st.nr_frames;
+	r->nr_skipped = st.nr_skipped;
+	r->nr_resyncs = st.nr_resyncs;
+	fill_latency(r, lat);
+}
+
+// Generate one stream, then decode it through every path
+void run_scenario(const char *name, const framegen_config &cfg, size_t nr_frames,
+		  std::vector<result> *res)
+{
+	frame_generator gen(cfg);
+	std::vector<uint8_t> buf;
+	std::vector<framegen_truth> truth;
+	std::vector<size_t> reads;
+	uint64_t nr_events;
+
+	nr_events = gen.generate(&buf, nr_frames, &truth);
+	for (size_t pos = 0; pos < buf.size(); ) {
+		size_t len = std::min(gen.next_read_len(), buf.size() - pos);
+
+		reads.push_back(len);
+		pos += len;
+	}
+
+	for (int path = cfg.side_records ? 1 : 0; path < NR_PATHS; ++path) {
+		result r;
+		matcher m(truth);
+
+		std::memset(&r, 0, sizeof(r));
+		r.scenario  = name;
+		r.path      = path_names[path];
+		r.nr_bytes  = buf.size();
+		r.nr_events = nr_events;
+		switch (path) {
+		case 0: run_firmware(&r, buf, reads, m); break;
+		case 1: run_stream<stream_decoder>(&r, buf, reads, m); break;
+		case 2: run_batch(&r, buf, m); break;
+		case 3: run_stream<model::model_stream<model::pms5003>>(&r, buf, reads, m); break;
+		}
+		r.nr_lost    = m.nr_lost();
+		r.nr_false   = m.nr_false();
+		r.max_relock = m.max_relock();
+		res->push_back(r);
+	}
+}
+
+// Randomized rounds; returns the number of results breaking the relock bound
+size_t fuzz(size_t nr_rounds, uint64_t seed, std::vector<result> *res)
+{
+	framegen_config meta;
+	size_t nr_bad_rounds = 0;
+
+	meta.seed = seed;
+	frame_generator rng(meta);
+	for (size_t n = 0; n < nr_rounds; ++n) {
+		framegen_config cfg;
+		const size_t first = res->size();
+
+		// Rates spread log-uniformly over 1e-4 .. 3e-2 per byte (or frame)
+		cfg.seed        = rng.next_u64();
+		cfg.p_bit_error = std::pow(10.0, -4.0 + 2.5 * rng.uniform());
+		cfg.p_drop      = std::pow(10.0, -4.0 + 2.5 * rng.uniform());
+		cfg.p_insert    = std::pow(10.0, -4.0 + 2.5 * rng.uniform());
+		cfg.p_truncate  = std::pow(10.0, -4.0 + 2.5 * rng.uniform());
+		cfg.read_min    = 1;
+		cfg.read_max    = 1 + (size_t)(rng.next_u64() % 1024);
+		run_scenario("fuzz", cfg, FUZZ_FRAMES, res);
+
+		for (size_t x = first; x < res->size(); ++x) {
+			const result &r = (*res)[x];
+
+			if (r.nr_false == 0 && (r.nr_lost > 0 || r.max_relock >= PMS_FRAME_LEN)) {
+				std::fprintf(stderr, "pms-bench: round %zu (seed %llu), %s: "
+					     "%llu intact frames lost, relock after %llu bytes\n",
+					     n, (unsigned long long)cfg.seed, r.path,
+					     (unsigned long long)r.nr_lost,
+					     (unsigned long long)r.max_relock);
+				++nr_bad_rounds;
+			}
+		}
+	}
+	return nr_bad_rounds;
+}
+
+void print_table(const std::vector<result> &res)
+{
+	std::printf("%-10s %-9s %8s %10s %8s %8s %8s %6s %5s %10s %7s %9s\n",
+		    "scenario", "path", "MB/s", "frames/s", "p50(ns)", "p99(ns)",
+		    "max(ns)", "lost", "false", "skip/event", "resyncs", "relock");
+	for (const result &r : res) {
+		std::printf("%-10s %-9s %8.1f %10.0f %8llu %8llu %8llu %6llu %5llu ",
+			    r.scenario, r.path, (double)r.nr_bytes / r.secs * 1e-6,
+			    (double)r.nr_frames / r.secs,
+			    (unsigned long long)r.lat_p50_ns, (unsigned long long)r.lat_p99_ns,
+			    (unsigned long long)r.lat_max_ns,
+			    (unsigned long long)r.nr_lost, (unsigned long long)r.nr_false);
+		if (r.nr_events > 0)
+			std::printf("%10.1f %7llu %3llu/%4.1fms\n",
+				    (double)r.nr_skipped / (double)r.nr_events,
+				    (unsigned long long)r.nr_resyncs,
+				    (unsigned long long)r.max_relock,
+				    (double)r.max_relock * BYTE_TIME_MS);
+		else
+			std::printf("%10s %7llu %9s\n", "-", (unsigned long long)r.nr_resyncs, "-");
+	}
+}
+
+// Worst case of each path over a set of (fuzzing) results
+void print_summary(const std::vector<result> &res)
+{
+	for (int path = 0; path < NR_PATHS; ++path) {
+		uint64_t lost = 0, nr_false = 0, relock = 0, events = 0;
+
+		for (const result &r : res) {
+			if (std::strcmp(r.path, path_names[path]) != 0)
+				continue;
+			lost     += r.nr_lost;
+			nr_false += r.nr_false;
+			events   += r.nr_events;
+			if (r.nr_false == 0)
+				relock = std::max(relock, r.max_relock);
+		}
+		std::printf("%-9s events %llu, intact frames lost %llu, false frames %llu, "
+			    "worst relock %llu bytes (%.1f ms at 9600 baud)\n",
+			    path_names[path], (unsigned long long)events,
+			    (unsigned long long)lost, (unsigned long long)nr_false,
+			    (unsigned long long)relock, (double)relock * BYTE_TIME_MS);
+	}
+}
+
+bool write_json(const char *path, const std::vector<result> &res, size_t nr_frames, uint64_t seed)
+{
+	std::FILE *fp = std::fopen(path, "w");
+	bool ok;
+
+	if (fp == nullptr)
+		return false;
+	std::fprintf(fp, "{\n  \"frames\": %zu,\n  \"seed\": %llu,\n  \"results\": [\n",
+		     nr_frames, (unsigned long long)seed);
+	for (size_t x = 0; x < res.size(); ++x) {
+		const result &r = res[x];
+
+		std::fprintf(fp,
+			"    {\"scenario\": \"%s\", \"path\": \"%s\", \"bytes\": %llu, "
+			"\"frames\": %llu, \"seconds\": %.6f, \"mb_per_s\": %.3f, "
+			"\"frames_per_s\": %.1f, \"latency_p50_ns\": %llu, "
+			"\"latency_p99_ns\": %llu, \"latency_max_ns\": %llu, "
+			"\"events\": %llu, \"lost_intact\": %llu, \"false\": %llu, "
+			"\"skipped_bytes\": %llu, \"resyncs\": %llu, "
+			"\"relock_max_bytes\": %llu, \"relock_max_ms\": %.2f}%s\n",
+			r.scenario, r.path, (unsigned long long)r.nr_bytes,
+			(unsigned long long)r.nr_frames, r.secs,
+			(double)r.nr_bytes / r.secs * 1e-6, (double)r.nr_frames / r.secs,
+			(unsigned long long)r.lat_p50_ns, (unsigned long long)r.lat_p99_ns,
+			(unsigned long long)r.lat_max_ns, (unsigned long long)r.nr_events,
+			(unsigned long long)r.nr_lost, (unsigned long long)r.nr_false,
+			(unsigned long long)r.nr_skipped, (unsigned long long)r.nr_resyncs,
+			(unsigned long long)r.max_relock, (double)r.max_relock * BYTE_TIME_MS,
+			x + 1 < res.size() ? "," : "");
+	}
+	std::fprintf(fp, "  ]\n}\n");
+	ok = !std::ferror(fp);
+	if (std::fclose(fp) != 0)
+		ok = false;
+	return ok;
+}
+
+// Free-running cycle counter, if any
+inline uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/// Inputs of one status line, as in the board's reports
+struct fmt_input {
+	uint32_t frames, bad, clamped, uptime;
+	int32_t temp_centi;
+	uint8_t rcause;
+};
+
+size_t line_snprintf(char *buf, size_t size, const fmt_input &in)
+{
+	const uint32_t t = (uint32_t)(in.temp_centi < 0 ? -in.temp_centi : in.temp_centi);
+	const int n = std::snprintf(buf, size,
+		"\r\nframes %lu, bad %lu, clamped %lu, up %06lu s, t %s%lu.%02lu, cause 0x%02X\r\n",
+		(unsigned long)in.frames, (unsigned long)in.bad, (unsigned long)in.clamped,
+		(unsigned long)in.uptime, in.temp_centi < 0 ? "-" : "",
+		(unsigned long)(t / 100), (unsigned long)(t % 100), in.rcause);
+
+	return n < (int)size ? (size_t)n : size - 1;
+}
+
+size_t line_fmt(char *buf, size_t size, const fmt_input &in)
+{
+	fmt_t f;
+
+	fmt_init(&f, buf, (uint16_t)size);
+	fmt_lit(&f, "\r\nframes ");
+	fmt_u32(&f, in.frames);
+	fmt_lit(&f, ", bad ");
+	fmt_u32(&f, in.bad);
+	fmt_lit(&f, ", clamped ");
+	fmt_u32(&f, in.clamped);
+	fmt_lit(&f, ", up ");
+	fmt_u32_pad(&f, in.uptime, 6, '0');
+	fmt_lit(&f, " s, t ");
+	fmt_fixed(&f, in.temp_centi, 2);
+	fmt_lit(&f, ", cause 0x");
+	fmt_hex(&f, in.rcause, 2);
+	fmt_lit(&f, "\r\n");
+	return f.len;
+}
+
+// Compare both formatters; return whether they agreed on every line
+bool bench_fmt(size_t nr_lines, uint64_t seed)
+{
+	std::vector<fmt_input> in(4096);
+	uint64_t rng = seed | 1;
+	char a[128], b[128];
+	size_t mismatches = 0, bytes = 0;
+
+	for (fmt_input &i : in) {
+		auto next = [&rng]() {
+			rng ^= rng << 13;
+			rng ^= rng >> 7;
+			rng ^= rng << 17;
+			return (uint32_t)(rng >> 16);
+		};
+		i.frames      = next();
+		i.bad         = next() % 1000;
+		i.clamped     = next() % 100000;
+		i.uptime      = next() % 10000000;
+		i.temp_centi  = (int32_t)(next() % 10000) - 4000;
+		i.rcause      = (uint8_t)next();
+	}
+	for (const fmt_input &i : in) {
+		const size_t na = line_snprintf(a, sizeof(a), i), nb = line_fmt(b, sizeof(b), i);
+
+		if (na != nb || std::memcmp(a, b, na) != 0)
+			++mismatches;
+	}
+
+	struct {
+		const char *name;
+		size_t (*fn)(char *, size_t, const fmt_input &);
+	} const paths[] = {
+		{ "snprintf", line_snprintf },
+		{ "fmt",      line_fmt },
+	};
+
+	std::printf("%-9s %10s %10s %8s\n", "path", "ns/line", "cyc/line", "MB/s");
+	for (const auto &p : paths) {
+		const auto t0 = bench_clock::now();
+		const uint64_t c0 = cycles();
+
+		bytes = 0;
+		for (size_t x = 0; x < nr_lines; ++x)
+			bytes += p.fn(a, sizeof(a), in[x % in.size()]);
+		const uint64_t c1 = cycles();
+		const double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+
+		std::printf("%-9s %10.1f %10.1f %8.1f\n", p.name, secs * 1e9 / (double)nr_lines,
+			    (double)(c1 - c0) / (double)nr_lines, (double)bytes / secs * 1e-6);
+	}
+	if (mismatches != 0)
+		std::fprintf(stderr, "pms-bench: %zu of %zu lines differ\n", mismatches, in.size());
+	return mismatches == 0;
+}
+
+/// Counts of one ring consumer
+struct ring_counts {
+	uint64_t read = 0, lost = 0, bad = 0;
+};
+
+/*
+ * Read a ring until told to stop and it is drained, checking in place that
+ * sample n has ts_ms == n, then dropping the verdicts on torn samples.
+ */
+void ring_consume(const sample_ring &ring, const std::atomic<bool> &done, bool slow,
+		  ring_counts *out)
+{
+	ring_reader r(ring, true);
+	bool wrong[RING_BENCH_BATCH];
+	size_t n, torn, x;
+
+	for (;;) {
+		const sample *p = r.peek(&n, RING_BENCH_BATCH);
+		const uint64_t first = r.nr_read() + r.nr_lost();
+
+		if (n == 0) {
+			if (done.load(std::memory_order_acquire) && r.backlog() == 0)
+				break;
+			std::this_thread::yield();
+			continue;
+		}
+		for (x = 0; x < n; ++x)
+			wrong[x] = ((uint64_t)p[x].ts_ms != first + x);
+		torn = r.consume(n);
+		for (x = torn; x < n; ++x)
+			out->bad += wrong[x];
+		if (slow)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	out->read = r.nr_read();
+	out->lost = r.nr_lost();
+}
+
+bool bench_ring(unsigned int nr_consumers)
+{
+	sample_ring ring;
+	std::atomic<bool> done{ false };
+	std::vector<ring_counts> counts(nr_consumers + 1);
+	std::vector<std::thread> threads;
+	sample s = {};
+	bool ok = true;
+
+	if (!ring.create(RING_BENCH_SLOTS)) {
+		std::fprintf(stderr, "pms-bench: ring: %s\n", std::strerror(errno));
+		return false;
+	}
+	for (unsigned int c = 0; c <= nr_consumers; ++c)
+		threads.emplace_back(ring_consume, std::cref(ring), std::cref(done),
+				     c == nr_consumers, &counts[c]);
+
+	const auto t0 = bench_clock::now();
+
+	for (size_t x = 0; x < RING_BENCH_SAMPLES; ++x) {
+		s.ts_ms = (int64_t)x;
+		ring.push(s);
+	}
+	const double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+
+	done.store(true, std::memory_order_release);
+	for (std::thread &t : threads)
+		t.join();
+
+	std::printf("push: %.1f ns/sample, %.1f M samples/s, %zu slots\n",
+		    secs * 1e9 / (double)RING_BENCH_SAMPLES, (double)RING_BENCH_SAMPLES / secs * 1e-6,
+		    ring.capacity());
+	std::printf("%-9s %12s %12s %8s\n", "consumer", "read", "lost", "bad");
+	for (unsigned int c = 0; c <= nr_consumers; ++c) {
+		const ring_counts &k = counts[c];
+
+		if (c < nr_consumers)
+			std::printf("%-9u", c);
+		else
+			std::printf("%-9s", "slow");
+		std::printf(" %12llu %12llu %8llu\n", (unsigned long long)k.read,
+			    (unsigned long long)k.lost, (unsigned long long)k.bad);
+		if (k.bad != 0 || k.read + k.lost != RING_BENCH_SAMPLES)
+			ok = false;
+	}
+	if (!ok)
+		std::fprintf(stderr, "pms-bench: ring consumers got wrong samples\n");
+	return ok;
+}
+
+// Randomized clock mapping rounds; returns the number breaking the bounds
+size_t bench_clock_sync(size_t nr_rounds, uint64_t seed)
+{
+	const int64_t wall0 = 1750000000LL * 1000000;
+	framegen_config meta;
+	size_t nr_bad_rounds = 0;
+	double worst_ms = 0.0;
+
+	meta.seed = seed;
+	frame_generator rng(meta);
+	std::printf("%-6s %9s %9s %9s %9s %9s %6s\n", "round", "drift", "latency",
+		    "jitter", "step", "worst", "resets");
+	for (size_t n = 0; n < nr_rounds; ++n) {
+		const double drift = CLOCK_BENCH_MAX_PPM * 1e-6 * (2.0 * rng.uniform() - 1.0);
+		const int64_t latency_us = (int64_t)(20000.0 * rng.uniform());
+		const double jitter_us = std::pow(10.0, 3.0 + 2.7 * rng.uniform());
+		const int64_t step_us = (int64_t)((rng.uniform() < 0.5) ? -1 : 1) *
+					(int64_t)((5.0 + 25.0 * rng.uniform()) * 1e6);
+		const int64_t reset_at = CLOCK_BENCH_SECS / 3, step_at = 2 * reset_at;
+		const int64_t tol_us = CLOCK_BENCH_TOL_US + (int64_t)(jitter_us / 10.0);
+		uint64_t boot_us = 3 * 1000000;		// device time at the first frame
+		int64_t start_us = wall0, offset_us = 0, since = 0;
+		int64_t worst_us = 0;
+		clock_sync cs;
+
+		for (int64_t t = 0; t < CLOCK_BENCH_SECS; ++t) {
+			if (t == reset_at) {
+				boot_us = 2 * 1000000;
+				start_us = wall0 + t * 1000000;
+				since = t;
+			} else if (t == step_at) {
+				offset_us = step_us;
+				since = t;
+			}
+
+			// True wall-clock time of when the frame began, and its arrival
+			const int64_t elapsed_us = (int64_t)(t - (t >= reset_at ? reset_at : 0)) * 1000000;
+			const uint64_t dev_us = boot_us + (uint64_t)elapsed_us;
+			const int64_t began_us = start_us + offset_us + elapsed_us +
+						 std::llround(drift * (double)elapsed_us);
+			double delay_us = jitter_us * rng.uniform() - 300.0 * std::log(1.0 - rng.uniform());
+
+			if (rng.uniform() < 1e-3)
+				delay_us += 1e6 * (1.0 + 0.5 * rng.uniform());
+			cs.add(dev_us, began_us + latency_us + (int64_t)delay_us);
+
+			if ((t - since) * 1000000 < CLOCK_BENCH_SETTLE_US)
+				continue;
+			worst_us = std::max(worst_us, std::abs(cs.map(dev_us) - (began_us + latency_us)));
+		}
+
+		const bool bad = worst_us > tol_us || cs.nr_resets() != 2;
+
+		std::printf("%-6zu %+7.1fppm %7.1fms %7.1fms %+8.1fs %7.2fms %6llu\n", n,
+			    drift * 1e6, (double)latency_us / 1000.0, jitter_us / 1000.0,
+			    (double)step_us / 1e6, (double)worst_us / 1000.0,
+			    (unsigned long long)cs.nr_resets());
+		if (bad)
+			std::fprintf(stderr, "pms-bench: clock round %zu: worst error %.2f ms "
+				     "(bound %.2f ms), %llu start-overs\n", n,
+				     (double)worst_us / 1000.0, (double)tol_us / 1000.0,
+				     (unsigned long long)cs.nr_resets());
+		worst_ms = std::max(worst_ms, (double)worst_us / 1000.0);
+		nr_bad_rounds += bad;
+	}
+	std::printf("%zu rounds, %zu out of bounds, worst error %.2f ms\n",
+		    nr_rounds, nr_bad_rounds, worst_ms);
+	return nr_bad_rounds;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr, "usage: pms-bench [-n frames] [-s seed] [-f rounds] [-o json]\n"
+			     "       pms-bench -p lines\n"
+			     "       pms-bench -r consumers\n"
+			     "       pms-bench [-s seed] -c rounds\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	size_t nr_frames = 200000;
+	size_t nr_rounds = 0;
+	size_t nr_lines = 0;
+	unsigned int nr_consumers = 0;
+	size_t nr_clock_rounds = 0;
+	uint64_t seed = 1;
+	const char *json_path = nullptr;
+	std::vector<result> res;
+	size_t nr_failed = 0;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'n': nr_frames = (size_t)std::strtoul(argv[++x], nullptr, 0); break;
+		case 's': seed = std::strtoull(argv[++x], nullptr, 0); break;
+		case 'f': nr_rounds = (size_t)std::strtoul(argv[++x], nullptr, 0); break;
+		case 'o': json_path = argv[++x]; break;
+		case 'p': nr_lines = (size_t)std::strtoul(argv[++x], nullptr, 0); break;
+		case 'r': nr_consumers = (unsigned int)std::strtoul(argv[++x], nullptr, 0); break;
+		case 'c': nr_clock_rounds = (size_t)std::strtoul(argv[++x], nullptr, 0); break;
+		default:
+			usage();
+		}
+	}
+	if (x != argc || nr_frames == 0)
+		usage();
+	if (nr_lines > 0)
+		return bench_fmt(nr_lines, seed) ? 0 : 1;
+	if (nr_consumers > 0)
+		return bench_ring(nr_consumers) ? 0 : 1;
+	if (nr_clock_rounds > 0)
+		return bench_clock_sync(nr_clock_rounds, seed) > 0 ? 1 : 0;
+
+	if (nr_rounds > 0) {
+		nr_failed = fuzz(nr_rounds, seed, &res);
+		print_summary(res);
+		nr_frames = FUZZ_FRAMES;
+	} else {
+		for (const scenario &sc : scenarios) {
+			framegen_config cfg;
+
+			cfg.seed        = seed;
+			cfg.p_bit_error = sc.p_bit_error;
+			cfg.p_drop      = sc.p_drop;
+			cfg.p_insert    = sc.p_insert;
+			cfg.p_truncate  = sc.p_truncate;
+			cfg.read_min    = sc.read_min;
+			cfg.read_max    = sc.read_max;
+			cfg.side_records = sc.side_records;
+			const size_t first = res.size();
+
+			run_scenario(sc.name, cfg, nr_frames, &res);
+			for (size_t k = first; k < res.size(); ++k) {
+				const result &r = res[k];
+
+				if (r.nr_events == 0 && (r.nr_skipped > 0 || r.nr_resyncs > 0)) {
+					std::fprintf(stderr, "pms-bench: %s, %s: %llu bytes skipped, "
+						     "%llu resyncs on a clean stream\n", r.scenario, r.path,
+						     (unsigned long long)r.nr_skipped,
+						     (unsigned long long)r.nr_resyncs);
+					++nr_failed;
+				}
+			}
+		}
+		print_table(res);
+	}
+
+	if (json_path != nullptr && !write_json(json_path, res, nr_frames, seed)) {
+		std::fprintf(stderr, "pms-bench: %s: %s\n", json_path, std::strerror(errno));
+		return 1;
+	}
+	return nr_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file  host/calibrate.cpp
+ * @brief pms-calibrate: apply calibration curves to a whole archive
+ */
+
+/*
+ * Usage: pms-calibrate -c coeffs [-H humidity] -o archive archive
+ *
+ * Every sample of the input archive is corrected with the curves in the
+ * coefficient file (see calibration.h for its format) and written to the
+ * output archive, in the same order; corrected samples are flagged with
+ * SAMPLE_FLAG_CALIBRATED. Raw archives are left alone, so a revised set of
+ * coefficients only needs another run.
+ *
+ * With -H, relative humidity is read from a file of "time rh" lines (Unix
+ * seconds, %; '#' starts a comment), sorted by time, e.g. as exported from
+ * a weather station; it is interpolated linearly between readings less
+ * than an hour apart. Samples outside such a span get no humidity terms.
+ *
+ * The time spent in the correction itself is reported on stderr.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "archive.h"
+#include "calibration.h"
+
+using namespace pms;
+
+namespace {
+
+/// Longest gap between humidity readings that is interpolated over
+constexpr int64_t RH_MAX_GAP_MS = 60 * 60 * 1000;
+
+struct rh_reading {
+	int64_t ts_ms;
+	float rh;
+};
+
+// Read "time rh" lines
+bool read_humidity(const char *path, std::vector<rh_reading> *out)
+{
+	std::FILE *fp = std::fopen(path, "r");
+	char line[256];
+
+	if (fp == nullptr)
+		return false;
+	while (std::fgets(line, sizeof(line), fp) != nullptr) {
+		double t, rh;
+
+		line[std::strcspn(line, "#\r\n")] = '\0';
+		if (std::sscanf(line, "%lf %lf", &t, &rh) != 2)
+			continue;
+		if (!out->empty() && (int64_t)(t * 1000.0) <= out->back().ts_ms) {
+			std::fclose(fp);
+			errno = EINVAL;
+			return false;
+		}
+		out->push_back({ (int64_t)(t * 1000.0), (float)rh });
+	}
+	std::fclose(fp);
+	return true;
+}
+
+// Humidity at each sample of a time-ordered run; the cursor carries over
+void fill_humidity(const std::vector<rh_reading> &rh, const sample *s, size_t n,
+		   size_t *cursor, float *out)
+{
+	size_t c = *cursor;
+
+	for (size_t x = 0; x < n; ++x) {
+		const int64_t t = s[x].ts_ms;
+
+		while (c < rh.size() && rh[c].ts_ms <= t)
+			++c;
+		// Here rh[c - 1] <= t < rh[c].
+		if (c > 0 && rh[c - 1].ts_ms == t) {
+			out[x] = rh[c - 1].rh;
+		} else if (c > 0 && c < rh.size() && rh[c].ts_ms - rh[c - 1].ts_ms <= RH_MAX_GAP_MS) {
+			const rh_reading &a = rh[c - 1], &b = rh[c];
+
+			out[x] = a.rh + (b.rh - a.rh) * (float)(t - a.ts_ms) / (float)(b.ts_ms - a.ts_ms);
+		} else {
+			out[x] = NAN;
+		}
+	}
+	*cursor = c;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr, "usage: pms-calibrate -c coeffs [-H humidity] -o archive archive\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	const char *coeff_path = nullptr;
+	const char *rh_path = nullptr;
+	const char *out_path = nullptr;
+	std::vector<rh_reading> rh;
+	std::vector<sample> batch;
+	std::vector<float> batch_rh;
+	calibration cal;
+	archive_reader ar;
+	archive_writer aw;
+	size_t bad_line, cursor = 0;
+	double secs = 0.0;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'c': coeff_path = argv[++x]; break;
+		case 'H': rh_path = argv[++x]; break;
+		case 'o': out_path = argv[++x]; break;
+		default:
+			usage();
+		}
+	}
+	if (coeff_path == nullptr || out_path == nullptr || x + 1 != argc)
+		usage();
+
+	if (!cal.load(coeff_path, &bad_line)) {
+		if (bad_line != 0)
+			std::fprintf(stderr, "pms-calibrate: %s:%zu: malformed curve\n",
+				     coeff_path, bad_line);
+		else
+			std::fprintf(stderr, "pms-calibrate: %s: %s\n", coeff_path, std::strerror(errno));
+		return 1;
+	}
+	if (rh_path != nullptr && !read_humidity(rh_path, &rh)) {
+		std::fprintf(stderr, "pms-calibrate: %s: %s\n", rh_path,
+			     errno == EINVAL ? "not sorted by time" : std::strerror(errno));
+		return 1;
+	}
+	if (!ar.open(argv[x])) {
+		std::fprintf(stderr, "pms-calibrate: %s: %s\n", argv[x], std::strerror(errno));
+		return 1;
+	}
+	if (!aw.open(out_path, ar.header().chunk_records)) {
+		std::fprintf(stderr, "pms-calibrate: %s: %s\n", out_path, std::strerror(errno));
+		return 1;
+	}
+
+	batch.resize(calibration::BATCH);
+	batch_rh.resize(calibration::BATCH);
+	for (uint64_t pos = 0; pos < ar.header().nr_records; ) {
+		const size_t n = (size_t)std::min<uint64_t>(calibration::BATCH,
+							     ar.header().nr_records - pos);
+
+		std::memcpy(batch.data(), ar.records() + pos, n * sizeof(sample));
+		if (!rh.empty())
+			fill_humidity(rh, batch.data(), n, &cursor, batch_rh.data());
+
+		const auto t0 = std::chrono::steady_clock::now();
+		cal.apply(batch.data(), n, rh.empty() ? nullptr : batch_rh.data());
+		secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+		for (size_t y = 0; y < n; ++y) {
+			if (!aw.append(batch[y])) {
+				std::fprintf(stderr, "pms-calibrate: %s: %s\n", out_path,
+					     std::strerror(errno));
+				return 1;
+			}
+		}
+		pos += n;
+	}
+	if (!aw.close()) {
+		std::fprintf(stderr, "pms-calibrate: %s: %s\n", out_path, std::strerror(errno));
+		return 1;
+	}
+
+	std::fprintf(stderr, "pms-calibrate: %llu samples, %zu curves, %.1f ms (%.1f M samples/s)\n",
+		     (unsigned long long)ar.header().nr_records, cal.nr_curves(), secs * 1e3,
+		     secs > 0.0 ? (double)ar.header().nr_records / secs * 1e-6 : 0.0);
+	return 0;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file  host/calibration.cpp
+ * @brief Per-sensor calibration and humidity correction of PM readings
+ */
+
+/*
+ * Samples are processed in batches: they are grouped by device with a
+ * counting sort, then each curve runs over the gathered values of its
+ * device as one tight loop over vectors of CAL_LANES floats (GCC/Clang
+ * vector extensions, lowered to whatever SIMD the target has). Curve
+ * parameters are uniform over such a loop, and piecewise-linear curves are
+ * evaluated as a sum of clamped segments, so there is no per-value branch.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include "calibration.h"
+
+namespace pms {
+
+namespace {
+
+/// Number of floats processed at once (128-bit vectors: SSE2, NEON)
+constexpr size_t CAL_LANES = 4;
+
+typedef float vfloat __attribute__((vector_size(CAL_LANES * sizeof(float))));
+
+/// Highest humidity used, to keep the growth factor finite
+constexpr float RH_MAX = 99.0f;
+
+const char *const kind_names[2] = { "atm", "cf1" };
+const char *const pm_names[PMS_NR_PM] = { "pm1_0", "pm2_5", "pm10" };
+
+inline vfloat vload(const float *p)
+{
+	vfloat v;
+
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline void vstore(float *p, vfloat v)
+{
+	std::memcpy(p, &v, sizeof(v));
+}
+
+// Apply one curve to n values (a multiple of CAL_LANES) in place
+void eval_curve(const cal_curve &c, float *x, const float *rh, size_t n)
+{
+	const vfloat zero = {};
+
+	for (size_t i = 0; i < n; i += CAL_LANES) {
+		const vfloat v = vload(x + i);
+		vfloat y, d;
+
+		if (c.nr_knots == 0) {
+			y = ((c.c[3] * v + c.c[2]) * v + c.c[1]) * v + c.c[0];
+		} else {
+			const size_t last = c.nr_knots - 2;
+
+			// Below the first knot, the first slope carries on...
+			d = v - c.knot_x[0];
+			y = c.y0 + c.slope[0] * (d < zero ? d : zero);
+			for (size_t k = 0; k < last; ++k) {
+				const float w = c.knot_x[k + 1] - c.knot_x[k];
+
+				d = v - c.knot_x[k];
+				d = d < zero ? zero : d;
+				y += c.slope[k] * (d > w ? zero + w : d);
+			}
+			// ... as does the last one past the last knot.
+			d = v - c.knot_x[last];
+			y += c.slope[last] * (d > zero ? d : zero);
+		}
+		if (rh != nullptr) {
+			const vfloat h = vload(rh + i);
+
+			y += c.rh * h;
+			y /= 1.0f + (c.kappa / 1.65f) * h / (100.0f - h);
+		}
+		vstore(x + i, y);
+	}
+}
+
+inline uint16_t *channel(sample *s, unsigned int slot)
+{
+	return slot < PMS_NR_PM ? &s->pm_atm[slot] : &s->pm_cf1[slot - PMS_NR_PM];
+}
+
+// Parse the rest of a line into a curve
+bool parse_curve(char *save, cal_curve *c)
+{
+	const char *tok = strtok_r(nullptr, " \t", &save);
+	float v[2 * CAL_MAX_KNOTS];
+	size_t n = 0;
+	bool pwl;
+
+	if (tok == nullptr)
+		return false;
+	if (std::strcmp(tok, "poly") == 0)
+		pwl = false;
+	else if (std::strcmp(tok, "pwl") == 0)
+		pwl = true;
+	else
+		return false;
+
+	for (tok = strtok_r(nullptr, " \t", &save); tok != nullptr;
+	     tok = strtok_r(nullptr, " \t", &save)) {
+		float *dst;
+		char *end;
+
+		if (std::strcmp(tok, "rh") == 0 || std::strcmp(tok, "kappa") == 0) {
+			dst = tok[0] == 'r' ? &c->rh : &c->kappa;
+			tok = strtok_r(nullptr, " \t", &save);
+			if (tok == nullptr)
+				return false;
+		} else if (n < sizeof(v) / sizeof(v[0]) && (pwl || n < 4)) {
+			dst = &v[n++];
+		} else {
+			return false;
+		}
+		*dst = std::strtof(tok, &end);
+		if (end == tok || *end != '\0' || !std::isfinite(*dst))
+			return false;
+	}
+
+	if (!pwl) {
+		if (n == 0)
+			return false;
+		for (size_t x = 0; x < 4; ++x)
+			c->c[x] = x < n ? v[x] : 0.0f;
+		return true;
+	}
+
+	if (n < 4 || n % 2 != 0)
+		return false;
+	c->nr_knots = (uint32_t)(n / 2);
+	c->y0 = v[1];
+	for (size_t k = 0; k < c->nr_knots; ++k) {
+		c->knot_x[k] = v[2*k];
+		if (k > 0) {
+			if (v[2*k] <= v[2*k - 2])
+				return false;
+			c->slope[k - 1] = (v[2*k + 1] - v[2*k - 1]) / (v[2*k] - v[2*k - 2]);
+		}
+	}
+	return true;
+}
+
+struct cal_entry {
+	bool any;
+	uint32_t device;
+	unsigned int slot;
+	cal_curve curve;
+};
+
+// Parse one non-empty line
+bool parse_line(char *line, cal_entry *e)
+{
+	char *save, *end;
+	const char *tok;
+	unsigned int kind, ch;
+
+	tok = strtok_r(line, " \t", &save);
+	e->any = std::strcmp(tok, "*") == 0;
+	if (!e->any) {
+		unsigned long dev = std::strtoul(tok, &end, 0);
+
+		if (end == tok || *end != '\0' || dev > UINT32_MAX)
+			return false;
+		e->device = (uint32_t)dev;
+	}
+
+	tok = strtok_r(nullptr, " \t", &save);
+	for (kind = 0; kind < 2 && tok != nullptr && std::strcmp(tok, kind_names[kind]) != 0; ++kind)
+		;
+	tok = strtok_r(nullptr, " \t", &save);
+	for (ch = 0; ch < PMS_NR_PM && tok != nullptr && std::strcmp(tok, pm_names[ch]) != 0; ++ch)
+		;
+	if (kind == 2 || ch == PMS_NR_PM)
+		return false;
+	e->slot = kind * PMS_NR_PM + ch;
+	return parse_curve(save, &e->curve);
+}
+
+}	// namespace
+
+bool calibration::load(const char *path, size_t *bad_line)
+{
+	std::FILE *fp = std::fopen(path, "r");
+	std::vector<cal_entry> entries;
+	char line[1024];
+	size_t nr_line = 0;
+
+	*bad_line = 0;
+	if (fp == nullptr)
+		return false;
+	while (std::fgets(line, sizeof(line), fp) != nullptr) {
+		cal_entry e;
+		char *p = line;
+
+		++nr_line;
+		line[std::strcspn(line, "#\r\n")] = '\0';
+		while (*p == ' ' || *p == '\t')
+			++p;
+		if (*p == '\0')
+			continue;
+		if (!parse_line(p, &e)) {
+			std::fclose(fp);
+			*bad_line = nr_line;
+			errno = EINVAL;
+			return false;
+		}
+		entries.push_back(e);
+	}
+	if (std::ferror(fp)) {
+		std::fclose(fp);
+		errno = EIO;
+		return false;
+	}
+	std::fclose(fp);
+
+	// Defaults first, so that a device's set starts out as a copy of them.
+	sets_.assign(1, cal_set());
+	by_device_.clear();
+	for (const cal_entry &e : entries) {
+		if (e.any) {
+			sets_[0].curves[e.slot] = e.curve;
+			sets_[0].mask |= 1u << e.slot;
+		}
+	}
+	for (const cal_entry &e : entries) {
+		if (e.any)
+			continue;
+		auto it = by_device_.emplace(e.device, (uint32_t)sets_.size()).first;
+		if (it->second == sets_.size())
+			sets_.push_back(sets_[0]);
+		sets_[it->second].curves[e.slot] = e.curve;
+		sets_[it->second].mask |= 1u << e.slot;
+	}
+	nr_curves_ = entries.size();
+	return true;
+}
+
+void calibration::apply(sample *s, size_t n, const float *rh)
+{
+	for (size_t x = 0; x < n; x += BATCH)
+		apply_batch(s + x, std::min(BATCH, n - x), rh != nullptr ? rh + x : nullptr);
+}
+
+void calibration::apply_batch(sample *s, size_t n, const float *rh)
+{
+	const size_t nr_sets = sets_.size();
+	uint32_t last_device = 0, last_set = 0;
+
+	if (nr_sets == 0 || n == 0)
+		return;
+	set_of_.resize(n);
+	order_.resize(n);
+	start_.assign(nr_sets + 1, 0);
+	x_.resize(BATCH + CAL_LANES);
+	rh_.resize(BATCH + CAL_LANES);
+
+	// Counting sort by set, so that each curve runs over contiguous values
+	for (size_t x = 0; x < n; ++x) {
+		if (x == 0 || s[x].device != last_device) {
+			auto it = by_device_.find(s[x].device);
+
+			last_device = s[x].device;
+			last_set = it != by_device_.end() ? it->second : 0;
+		}
+		set_of_[x] = last_set;
+		++start_[last_set + 1];
+	}
+	for (size_t g = 0; g < nr_sets; ++g)
+		start_[g + 1] += start_[g];
+	cursor_.assign(start_.begin(), start_.end() - 1);
+	for (size_t x = 0; x < n; ++x)
+		order_[cursor_[set_of_[x]]++] = (uint32_t)x;
+
+	for (size_t g = 0; g < nr_sets; ++g) {
+		const cal_set &set = sets_[g];
+		const uint32_t *idx = order_.data() + start_[g];
+		const size_t m = start_[g + 1] - start_[g];
+		const size_t padded = (m + CAL_LANES - 1) / CAL_LANES * CAL_LANES;
+
+		if (set.mask == 0 || m == 0)
+			continue;
+		if (rh != nullptr) {
+			for (size_t j = 0; j < m; ++j) {
+				const float h = rh[idx[j]];
+
+				// Unknown humidity disables both humidity terms.
+				rh_[j] = std::isnan(h) ? 0.0f : std::min(std::max(h, 0.0f), RH_MAX);
+			}
+			std::fill(rh_.begin() + m, rh_.begin() + padded, 0.0f);
+		}
+
+		for (unsigned int slot = 0; slot < CAL_NR_CURVES; ++slot) {
+			if ((set.mask & (1u << slot)) == 0)
+				continue;
+			for (size_t j = 0; j < m; ++j)
+				x_[j] = *channel(&s[idx[j]], slot);
+			std::fill(x_.begin() + m, x_.begin() + padded, 0.0f);
+
+			eval_curve(set.curves[slot], x_.data(), rh != nullptr ? rh_.data() : nullptr,
+				   padded);
+
+			for (size_t j = 0; j < m; ++j) {
+				const float y = std::min(std::max(x_[j], 0.0f), 65535.0f);
+
+				*channel(&s[idx[j]], slot) = (uint16_t)(y + 0.5f);
+			}
+		}
+		for (size_t j = 0; j < m; ++j)
+			s[idx[j]].flags |= SAMPLE_FLAG_CALIBRATED;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool calibration_file::open(const char *path, size_t *bad_line)
+{
+	path_ = path;
+	size_ = -1;
+	return refresh(bad_line);
+}
+
+bool calibration_file::refresh(size_t *bad_line)
+{
+	struct stat st;
+
+	*bad_line = 0;
+	if (stat(path_.c_str(), &st) != 0)
+		return false;
+	if ((long long)st.st_size == size_ && st.st_mtim.tv_sec == mtime_.tv_sec &&
+	    st.st_mtim.tv_nsec == mtime_.tv_nsec) {
+		errno = 0;
+		return false;
+	}
+
+	// Remember this version even if it is broken, to complain only once.
+	size_  = (long long)st.st_size;
+	mtime_ = st.st_mtim;
+
+	std::unique_ptr<calibration> cal(new calibration);
+	if (!cal->load(path_.c_str(), bad_line))
+		return false;
+	cal_ = std::move(cal);
+	return true;
+}
+
+}	// namespace pms
@@ -0,0 +1,172 @@
+/**
+ * @file  host/calibration.h
+ * @brief Per-sensor calibration and humidity correction of PM readings
+ */
+
+/*
+ * Coefficient file format: one curve per line, '#' starts a comment.
+ *
+ *   <device|*> <atm|cf1> <pm1_0|pm2_5|pm10> <curve> [rh <d>] [kappa <k>]
+ *
+ * where <curve> is one of
+ *
+ *   poly c0 [c1 [c2 [c3]]]	y = c0 + c1 x + c2 x^2 + c3 x^3
+ *   pwl x0 y0 x1 y1 ...	piecewise-linear through up to CAL_MAX_KNOTS
+ *				points (x ascending), extended linearly
+ *				beyond both ends
+ *
+ * x is the raw reading in ug/m3. "rh d" then adds d * RH (in %), as in the
+ * US EPA correction for Plantower sensors; "kappa k" divides the result by
+ * the kappa-Koehler growth factor 1 + (k / 1.65) * RH / (100 - RH). Both
+ * humidity terms are skipped for samples without a humidity reading. The
+ * result is clamped to [0, 65535] and rounded.
+ *
+ * Lines for '*' apply to every device; lines for a given device override
+ * them channel by channel. Channels without a curve are left untouched.
+ *
+ * Example (US EPA PurpleAir correction, for every device):
+ *
+ *   *  cf1  pm2_5  poly 5.75 0.52 rh -0.086
+ */
+
+#if !defined(EEE192_HOST_CALIBRATION_H_)
+#define EEE192_HOST_CALIBRATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Largest number of knots in a piecewise-linear curve
+constexpr size_t CAL_MAX_KNOTS = 16;
+
+/// Number of (kind, channel) pairs a device may have curves for
+constexpr size_t CAL_NR_CURVES = 2 * PMS_NR_PM;
+
+/// Correction of one channel
+struct cal_curve {
+	/// Polynomial coefficients, lowest order first (if @c nr_knots is 0)
+	float c[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+
+	/// Number of piecewise-linear knots; 0 for a polynomial
+	uint32_t nr_knots = 0;
+
+	/// Knot abscissae (raw values), ascending
+	float knot_x[CAL_MAX_KNOTS];
+
+	/// Value at the first knot
+	float y0 = 0.0f;
+
+	/// Slope of each segment; the first and last extend past the knots
+	float slope[CAL_MAX_KNOTS - 1];
+
+	/// Linear humidity term, per %RH
+	float rh = 0.0f;
+
+	/// Hygroscopic growth parameter; 0 disables the growth correction
+	float kappa = 0.0f;
+};
+
+/// Curves of one device, indexed by kind (atm first, then cf1) and channel
+struct cal_set {
+	/// Bit x set: curves[x] is in use
+	uint32_t mask = 0;
+
+	cal_curve curves[CAL_NR_CURVES];
+};
+
+/// Set of calibration curves, as loaded from a coefficient file
+class calibration {
+public:
+	/// Number of samples processed per pass
+	static constexpr size_t BATCH = 4096;
+
+	/**
+	 * Load a coefficient file
+	 *
+	 * @param[out]	bad_line	Set to the number of the first malformed
+	 *				line, or to 0
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno;
+	 *		@c EINVAL for a malformed line)
+	 */
+	bool load(const char *path, size_t *bad_line);
+
+	/**
+	 * Correct a batch of samples in place
+	 *
+	 * @param[in]	rh	Relative humidity (%) of each sample, NaN
+	 *			where unknown, or @c nullptr if none is known
+	 *
+	 * @note
+	 * Samples are grouped by device internally, so they may come in any
+	 * order; corrected samples get @c SAMPLE_FLAG_CALIBRATED.
+	 */
+	void apply(sample *s, size_t n, const float *rh);
+
+	/// Number of curves loaded
+	size_t nr_curves() const { return nr_curves_; }
+
+private:
+	void apply_batch(sample *s, size_t n, const float *rh);
+
+	// sets_[0] holds the curves for '*'
+	std::vector<cal_set> sets_;
+	std::unordered_map<uint32_t, uint32_t> by_device_;
+	size_t nr_curves_ = 0;
+
+	// Scratch space for apply()
+	std::vector<uint32_t> set_of_;
+	std::vector<uint32_t> order_;
+	std::vector<uint32_t> start_;
+	std::vector<uint32_t> cursor_;
+	std::vector<float> x_;
+	std::vector<float> rh_;
+};
+
+/**
+ * Coefficient file that is reloaded whenever it changes on disk
+ *
+ * @note
+ * A file that fails to load leaves the previous curves in place.
+ */
+class calibration_file {
+public:
+	/**
+	 * Load the file for the first time
+	 *
+	 * @return	@c true on success, @c false otherwise (see
+	 *		calibration::load())
+	 */
+	bool open(const char *path, size_t *bad_line);
+
+	/**
+	 * Reload the file if its modification time or size changed
+	 *
+	 * @return	@c true if the curves were replaced, @c false otherwise
+	 *		(@c errno is 0 if the file was merely unchanged)
+	 */
+	bool refresh(size_t *bad_line);
+
+	/// Current curves, or @c nullptr before open() succeeded
+	calibration *get() const { return cal_.get(); }
+
+	const std::string &path() const { return path_; }
+
+private:
+	std::string path_;
+	std::unique_ptr<calibration> cal_;
+	struct timespec mtime_ = {};
+	long long size_ = -1;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_CALIBRATION_H_)
@@ -0,0 +1,168 @@
+/**
+ * @file  host/chart.cpp
+ * @brief pms-chart: maintain rollups of PM archives and print chart series
+ */
+
+/*
+ * Usage: pms-chart [-s state] [-q state] [-d device] [-f from] [-u until]
+ *                  [-r res] [-n rows] [archive...]
+ *
+ * Samples from the given archives are folded into the rollups kept in the
+ * state file (created if missing, and written back afterwards); the series
+ * for one device over [from, until) (Unix seconds) is then printed as CSV.
+ * Each archive should be folded into a given state file only once.
+ *
+ * The resolution is one of 1s/1min/1h/1d; by default, the coarsest one
+ * still yielding at least -n rows (default 100) is used, so that e.g. a
+ * one-year chart reads 365 daily rows.
+ *
+ * With -q, per-hour quantile sketches are maintained in a second state file
+ * as well, and P50/P95/P99 columns are added (for hourly or coarser rows), as
+ * well as a summary over the whole window.
+ */
+
+#include <cerrno>
+#include <cinttypes>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "archive.h"
+#include "quantile.h"
+#include "rollup.h"
+
+using namespace pms;
+
+namespace {
+
+const char *const res_names[ROLLUP_NR_RES] = { "1s", "1min", "1h", "1d" };
+
+const double pctl_q[] = { 0.50, 0.95, 0.99 };
+constexpr size_t NR_PCTL = sizeof(pctl_q) / sizeof(pctl_q[0]);
+
+// Print P50/P95/P99 of every channel over [from, until)
+void print_pctl(const quantile_store &qs, uint32_t device, int64_t from, int64_t until)
+{
+	for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+		float v[NR_PCTL];
+
+		qs.window(device, ch, from, until).quantiles(pctl_q, v, NR_PCTL);
+		for (size_t x = 0; x < NR_PCTL; ++x)
+			std::printf(",%.0f", v[x]);
+	}
+}
+
+void usage(void)
+{
+	std::fprintf(stderr,
+		"usage: pms-chart [-s state] [-q state] [-d device] [-f from] [-u until] "
+		"[-r 1s|1min|1h|1d] [-n rows] [archive...]\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	const char *state_path = nullptr;
+	const char *qstate_path = nullptr;
+	uint32_t device = 0;
+	int64_t from = INT64_MIN, until = INT64_MAX;
+	int res = -1;
+	size_t min_rows = 100;
+	rollup_engine eng;
+	quantile_store qs;
+	std::vector<rollup_row> rows;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 's': state_path = argv[++x]; break;
+		case 'q': qstate_path = argv[++x]; break;
+		case 'd': device = (uint32_t)std::strtoul(argv[++x], nullptr, 0); break;
+		case 'f': from  = std::strtoll(argv[++x], nullptr, 0) * 1000; break;
+		case 'u': until = std::strtoll(argv[++x], nullptr, 0) * 1000; break;
+		case 'n': min_rows = (size_t)std::strtoul(argv[++x], nullptr, 0); break;
+		case 'r':
+			++x;
+			for (res = ROLLUP_NR_RES - 1; res >= 0; --res) {
+				if (std::strcmp(argv[x], res_names[res]) == 0)
+					break;
+			}
+			if (res < 0)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (state_path != nullptr && !eng.load(state_path) && errno != ENOENT) {
+		std::fprintf(stderr, "pms-chart: %s: %s\n", state_path, std::strerror(errno));
+		return 1;
+	}
+	if (qstate_path != nullptr && !qs.load(qstate_path) && errno != ENOENT) {
+		std::fprintf(stderr, "pms-chart: %s: %s\n", qstate_path, std::strerror(errno));
+		return 1;
+	}
+
+	for (; x < argc; ++x) {
+		archive_reader ar;
+
+		if (!ar.open(argv[x])) {
+			std::fprintf(stderr, "pms-chart: %s: %s\n", argv[x], std::strerror(errno));
+			return 1;
+		}
+		for (uint64_t y = 0; y < ar.header().nr_records; ++y) {
+			eng.add(ar.records()[y]);
+			if (qstate_path != nullptr)
+				qs.add(ar.records()[y]);
+		}
+	}
+	eng.expire();
+
+	if (state_path != nullptr && !eng.save(state_path)) {
+		std::fprintf(stderr, "pms-chart: %s: %s\n", state_path, std::strerror(errno));
+		return 1;
+	}
+	if (qstate_path != nullptr && !qs.save(qstate_path)) {
+		std::fprintf(stderr, "pms-chart: %s: %s\n", qstate_path, std::strerror(errno));
+		return 1;
+	}
+
+	// Open-ended ranges default to the last day of data.
+	if (until == INT64_MAX)
+		until = eng.watermark() + 1;
+	if (from == INT64_MIN)
+		from = until - rollup_width_ms[ROLLUP_1D];
+	if (res < 0)
+		res = eng.pick_res(from, until, min_rows);
+
+	eng.query(&rows, (rollup_res)res, device, from, until);
+	std::printf("# device %u, resolution %s, %zu rows\n", device, res_names[res], rows.size());
+	const bool row_pctl = qstate_path != nullptr && res >= ROLLUP_1H;
+
+	if (qstate_path != nullptr) {
+		std::printf("# p50/p95/p99 over the window");
+		print_pctl(qs, device, from, until);
+		std::printf("\n");
+	}
+	std::printf("ts,count,pm1_0_mean,pm1_0_min,pm1_0_max,pm1_0_std,"
+		    "pm2_5_mean,pm2_5_min,pm2_5_max,pm2_5_std,"
+		    "pm10_mean,pm10_min,pm10_max,pm10_std%s\n",
+		    row_pctl ? ",pm1_0_p50,pm1_0_p95,pm1_0_p99,pm2_5_p50,pm2_5_p95,pm2_5_p99,"
+			       "pm10_p50,pm10_p95,pm10_p99" : "");
+	for (const rollup_row &r : rows) {
+		std::printf("%lld,%" PRIu64, (long long)(r.ts_ms / 1000), r.count);
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			std::printf(",%.2f,%u,%u,%.2f", r.mean(ch), r.min[ch], r.max[ch], r.stddev(ch));
+		if (row_pctl)
+			print_pctl(qs, device, r.ts_ms, r.ts_ms + rollup_width_ms[res]);
+		std::printf("\n");
+	}
+	return 0;
+}
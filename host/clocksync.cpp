@@ -0,0 +1,120 @@
+/**
+ * @file  host/clocksync.cpp
+ * @brief Online mapping of a board's clock to wall-clock time
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "clocksync.h"
+
+namespace pms {
+
+/////////////////////////////////////////////////////////////////////////////
+
+void clock_sync::restart(uint64_t dev_us, int64_t host_us)
+{
+	dev0_ = dev_us;
+	off0_ = host_us - (int64_t)dev_us;
+	buckets_[0] = bucket{ 0, 0.0, 0.0 };
+	head_ = 0;
+	nr_buckets_ = 1;
+	base_ = 0.0;
+	drift_ = 0.0;
+	last_dev_us_ = dev_us;
+	last_delay_us_ = 0.0;
+}
+
+void clock_sync::add(uint64_t dev_us, int64_t host_us)
+{
+	++nr_points_;
+	if (nr_buckets_ == 0) {
+		restart(dev_us, host_us);
+		return;
+	}
+
+	const double x = (double)(int64_t)(dev_us - dev0_);
+	const double y = (double)((host_us - (int64_t)dev_us) - off0_);
+	const double r = y - (base_ + drift_ * x);
+
+	// A board reset, or the wall clock stepped back
+	if (dev_us < last_dev_us_ || r < -(double)CLOCK_STEP_US) {
+		++nr_resets_;
+		restart(dev_us, host_us);
+		return;
+	}
+	last_dev_us_ = dev_us;
+
+	const int64_t idx = (int64_t)(dev_us - dev0_) / CLOCK_BUCKET_US;
+	bucket &b = buckets_[head_];
+
+	if (idx == b.idx) {
+		if (r < b.y - (base_ + drift_ * b.x)) {
+			b.x = x;
+			b.y = y;
+		}
+	} else {
+		// The wall clock stepped forward while the bucket was filled.
+		if (b.y - (base_ + drift_ * b.x) > (double)CLOCK_STEP_US) {
+			++nr_resets_;
+			restart(dev_us, host_us);
+			return;
+		}
+		head_ = (head_ + 1) % CLOCK_NR_BUCKETS;
+		buckets_[head_] = bucket{ idx, x, y };
+		nr_buckets_ = std::min(nr_buckets_ + 1, CLOCK_NR_BUCKETS);
+	}
+	fit();
+	last_delay_us_ = y - (base_ + drift_ * x);
+}
+
+/*
+ * Fit the line under all buckets that passes closest to them on average:
+ * that is the edge of their lower convex hull above their mean device time.
+ */
+void clock_sync::fit()
+{
+	const size_t first = (head_ + CLOCK_NR_BUCKETS + 1 - nr_buckets_) % CLOCK_NR_BUCKETS;
+	const bucket *hull[CLOCK_NR_BUCKETS];
+	size_t nr_hull = 0, x;
+	double mx = 0.0;
+
+	drift_ = 0.0;
+	base_ = HUGE_VAL;
+	if (buckets_[head_].x - buckets_[first].x < (double)CLOCK_MIN_SPAN_US) {
+		for (x = 0; x < nr_buckets_; ++x)
+			base_ = std::min(base_, buckets_[(first + x) % CLOCK_NR_BUCKETS].y);
+		return;
+	}
+
+	// Monotone chain; buckets are in device-time order already.
+	for (x = 0; x < nr_buckets_; ++x) {
+		const bucket *b = &buckets_[(first + x) % CLOCK_NR_BUCKETS];
+
+		mx += b->x;
+		while (nr_hull >= 2) {
+			const bucket *p = hull[nr_hull - 2], *q = hull[nr_hull - 1];
+
+			// Drop q unless it lies strictly under the segment p-b.
+			if ((q->y - p->y) * (b->x - p->x) < (b->y - p->y) * (q->x - p->x))
+				break;
+			--nr_hull;
+		}
+		hull[nr_hull++] = b;
+	}
+	mx /= (double)nr_buckets_;
+
+	for (x = 0; x + 2 < nr_hull && hull[x + 1]->x < mx; ++x)
+		;
+	drift_ = (hull[x + 1]->y - hull[x]->y) / (hull[x + 1]->x - hull[x]->x);
+	base_  = hull[x]->y - drift_ * hull[x]->x;
+}
+
+int64_t clock_sync::map(uint64_t dev_us) const
+{
+	const double x = (double)(int64_t)(dev_us - dev0_);
+
+	return (int64_t)dev_us + off0_ + std::llround(base_ + drift_ * x);
+}
+
+}	// namespace pms
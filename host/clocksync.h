@@ -0,0 +1,123 @@
+/**
+ * @file  host/clocksync.h
+ * @brief Online mapping of a board's clock to wall-clock time
+ */
+
+/*
+ * Boards send when each frame began by their own clock (see ../stamp.h);
+ * the host only knows when the frame arrived, which is
+ *
+ *   arrival = device time + offset + drift * device time + delay
+ *
+ * where the delay (transmit batching, USB polling, scheduling, or the
+ * polling of a log file) is never negative, usually small, and has a long
+ * tail. Least squares through all points would be off by the mean delay,
+ * so only the points with the least delay are fitted:
+ *
+ *  - Device time is cut into CLOCK_BUCKET_US spans, each of which keeps its
+ *    point lying lowest under the current fit, i.e. the least delayed one.
+ *  - The line is fitted under the last CLOCK_NR_BUCKETS of those points,
+ *    as close to them as it gets on average. This is the linear-programming
+ *    counterpart of least squares for one-sided errors, and its solution is
+ *    the edge of their lower convex hull above their mean device time.
+ *  - Its slope is the drift; its offset is late by about the least delay
+ *    seen over the whole window (about an hour's worth of frames), which is
+ *    where a constant link latency ends up, as it cannot be told apart.
+ *
+ * This takes constant memory and O(CLOCK_NR_BUCKETS) time per point. The
+ * drift is only estimated once the points span CLOCK_MIN_SPAN_US, and taken
+ * as zero until then. Device time going backwards (the board was reset), a
+ * point lying well under the line, or a whole bucket lying well above it
+ * (the wall clock was stepped) starts over.
+ */
+
+#if !defined(EEE192_HOST_CLOCKSYNC_H_)
+#define EEE192_HOST_CLOCKSYNC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pms {
+
+/// Span of device time over which only the least delayed point is kept
+constexpr int64_t CLOCK_BUCKET_US = 60 * 1000000LL;
+
+/// Number of such spans fitted
+constexpr size_t CLOCK_NR_BUCKETS = 64;
+
+/// Span of device time needed before the drift is estimated
+constexpr int64_t CLOCK_MIN_SPAN_US = 5 * 60 * 1000000LL;
+
+/// Distance from the line beyond which the clocks are deemed to have stepped
+constexpr int64_t CLOCK_STEP_US = 2 * 1000000LL;
+
+/// Mapping of one board's clock to wall-clock time
+class clock_sync {
+public:
+	/**
+	 * Account for one frame
+	 *
+	 * @param[in]	dev_us	When the frame began, by the board's clock
+	 * @param[in]	host_us	When the frame arrived, in microseconds since
+	 *			the Unix epoch
+	 */
+	void add(uint64_t dev_us, int64_t host_us);
+
+	/// Whether any point was added since the last start-over
+	bool valid() const { return nr_buckets_ > 0; }
+
+	/**
+	 * Wall-clock time of a device time, in microseconds since the Unix
+	 * epoch
+	 *
+	 * @note
+	 * Only meaningful if valid().
+	 */
+	int64_t map(uint64_t dev_us) const;
+
+	/// Wall-clock time minus device time, at the latest point
+	int64_t offset_us() const { return map(last_dev_us_) - (int64_t)last_dev_us_; }
+
+	/// Wall-clock time elapsed per unit of device time, minus one
+	double drift() const { return drift_; }
+
+	/// Delay of the latest point, above the line
+	double delay_us() const { return last_delay_us_; }
+
+	/// Number of points added, and of start-overs
+	uint64_t nr_points() const { return nr_points_; }
+	uint64_t nr_resets() const { return nr_resets_; }
+
+private:
+	struct bucket {
+		int64_t idx;
+
+		// Least delayed point, relative to the origin
+		double x, y;
+	};
+
+	void restart(uint64_t dev_us, int64_t host_us);
+	void fit();
+
+	// Points are (x, y) = (dev - dev0, (host - dev) - off0), in microseconds.
+	uint64_t dev0_ = 0;
+	int64_t off0_ = 0;
+
+	// Ring of the latest buckets; buckets_[head_] is the current one
+	bucket buckets_[CLOCK_NR_BUCKETS];
+	size_t head_ = 0;
+	size_t nr_buckets_ = 0;
+
+	// y = base_ + drift_ * x
+	double base_ = 0.0;
+	double drift_ = 0.0;
+
+	uint64_t last_dev_us_ = 0;
+	double last_delay_us_ = 0.0;
+	uint64_t nr_points_ = 0;
+	uint64_t nr_resets_ = 0;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_CLOCKSYNC_H_)
@@ -0,0 +1,334 @@
+/**
+ * @file  host/decode.h
+ * @brief Batch and incremental (streaming) decoders for raw sensor byte streams
+ *
+ * Both decoders look for the start characters with memchr() and validate
+ * candidate frames in place, so bytes are only copied when a frame straddles
+ * two reads. On a bad candidate they move on by a single byte, so that a
+ * corrupted frame never hides the start of the next one. The AQI and
+ * timestamp records the firmware sends along its frames share their first
+ * start character; they are passed over like frames of another format
+ * instead of being counted as discarded bytes.
+ *
+ * The frame format is a template parameter (a "codec"); decode_batch() and
+ * stream_decoder use the portable PMS5003 decoder from pms.c.
+ */
+
+#if !defined(EEE192_HOST_DECODE_H_)
+#define EEE192_HOST_DECODE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "../aqi.h"
+#include "../pms.h"
+#include "../stamp.h"
+
+namespace pms {
+
+/// Counters kept by the decoders
+struct decode_stats {
+	/// Number of valid frames
+	uint64_t nr_frames = 0;
+
+	/// Number of candidates (start characters found) that failed validation
+	uint64_t nr_rejected = 0;
+
+	/// Number of bytes that were not part of any valid frame
+	uint64_t nr_skipped = 0;
+
+	/// Number of times lock was regained after discarding bytes
+	uint64_t nr_resyncs = 0;
+
+	/// Number of bytes discarded since the last valid frame
+	uint64_t gap = 0;
+
+	/// Largest number of bytes discarded between two valid frames
+	uint64_t max_gap = 0;
+
+	/// Account for @c n discarded bytes
+	void skip(uint64_t n) { nr_skipped += n; gap += n; }
+
+	/// Account for one valid frame
+	void lock()
+	{
+		++nr_frames;
+		if (gap > 0) {
+			++nr_resyncs;
+			max_gap = std::max(max_gap, gap);
+			gap = 0;
+		}
+	}
+};
+
+/**
+ * Frame format seen by the decoders below, for the portable C decoder
+ *
+ * Any type with the same members may be used instead (see model.h).
+ */
+struct pms_codec {
+	/// Decoded frame type
+	typedef pms_frame_t frame_type;
+
+	/// Length of a frame, in bytes
+	static constexpr size_t frame_len = PMS_FRAME_LEN;
+
+	/// First two bytes of every frame
+	static constexpr uint8_t start_1 = PMS_FRAME_START_1;
+	static constexpr uint8_t start_2 = PMS_FRAME_START_2;
+
+	/// Validate and decode a frame of @c frame_len bytes
+	static bool decode(const uint8_t *raw, frame_type *f) { return pms_frame_decode(f, raw); }
+};
+
+/// Codec for the AQI records the firmware sends after reported frames
+struct aqi_codec {
+	typedef aqi_t frame_type;
+
+	static constexpr size_t frame_len = AQI_RECORD_LEN;
+
+	static constexpr uint8_t start_1 = AQI_RECORD_START_1;
+	static constexpr uint8_t start_2 = AQI_RECORD_START_2;
+
+	static bool decode(const uint8_t *raw, frame_type *a) { return aqi_record_decode(a, raw); }
+};
+
+/// Codec for the timestamp records the firmware sends after frames
+struct stamp_codec {
+	/// Device time, in microseconds since boot
+	typedef uint64_t frame_type;
+
+	static constexpr size_t frame_len = STAMP_RECORD_LEN;
+
+	static constexpr uint8_t start_1 = STAMP_RECORD_START_1;
+	static constexpr uint8_t start_2 = STAMP_RECORD_START_2;
+
+	static bool decode(const uint8_t *raw, frame_type *us) { return stamp_record_decode(us, raw); }
+};
+
+/**
+ * Length of a valid AQI or timestamp record at @c raw, or 0 if there is none
+ * within @c avail bytes
+ *
+ * Records matching the codec's own start characters are left to it.
+ */
+template <typename Codec>
+size_t side_record_len(const uint8_t *raw, size_t avail)
+{
+	aqi_t a;
+	uint64_t us;
+
+	if (avail < 2 || raw[1] == Codec::start_2)
+		return 0;
+	if (avail >= AQI_RECORD_LEN && aqi_record_decode(&a, raw))
+		return AQI_RECORD_LEN;
+	if (avail >= STAMP_RECORD_LEN && stamp_record_decode(&us, raw))
+		return STAMP_RECORD_LEN;
+	return 0;
+}
+
+/**
+ * Decode all frames that start within the first @c start_limit bytes
+ *
+ * Frames may extend past @c start_limit, but never past @c len; this allows
+ * a large buffer to be split among threads without losing frames at the
+ * seams.
+ *
+ * @param[in]	fn	Called as
+ *			@code fn(const Codec::frame_type &, size_t offset) @endcode
+ *			for each valid frame
+ *
+ * @return	Offset at which scanning stopped
+ */
+template <typename Codec, typename Fn>
+size_t scan_frames(const uint8_t *p, size_t len, size_t start_limit,
+		   decode_stats *st, Fn fn)
+{
+	size_t x = 0, last_end = 0;
+
+	start_limit = std::min(start_limit, len);
+	while (x < start_limit) {
+		const uint8_t *q = static_cast<const uint8_t *>(
+			std::memchr(p + x, Codec::start_1, start_limit - x));
+		typename Codec::frame_type f;
+		size_t n;
+
+		if (q == nullptr) {
+			x = start_limit;
+			break;
+		}
+		x = (size_t)(q - p);
+		if ((n = side_record_len<Codec>(q, len - x)) > 0) {
+			st->skip(x - last_end);
+			x += n;
+			last_end = x;
+			continue;
+		}
+		if (len - x < Codec::frame_len)
+			break;
+		if (Codec::decode(q, &f)) {
+			st->skip(x - last_end);
+			st->lock();
+			fn(f, x);
+			x += Codec::frame_len;
+			last_end = x;
+		} else {
+			if (q[1] == Codec::start_2)
+				++st->nr_rejected;
+			++x;
+		}
+	}
+	st->skip(std::min(x, start_limit) - std::min(last_end, start_limit));
+	return x;
+}
+
+/// scan_frames() for PMS5003-family frames, through the portable decoder
+template <typename Fn>
+size_t decode_batch(const uint8_t *p, size_t len, size_t start_limit,
+		    decode_stats *st, Fn fn)
+{
+	return scan_frames<pms_codec>(p, len, start_limit, st, fn);
+}
+
+/**
+ * Incremental decoder for data arriving in arbitrarily-sized reads
+ *
+ * @note
+ * At most @code Codec::frame_len - 1 @endcode bytes are carried over
+ * between reads.
+ */
+template <typename Codec>
+class basic_stream_decoder {
+public:
+	typedef typename Codec::frame_type frame_type;
+
+	/**
+	 * Decode one read's worth of data
+	 *
+	 * @param[in]	fn	Called as @code fn(const frame_type &) @endcode
+	 *			for each valid frame, or as
+	 *			@code fn(const frame_type &, uint64_t end) @endcode,
+	 *			where @c end is the position() just past the frame
+	 */
+	template <typename Fn>
+	void feed(const uint8_t *p, size_t len, Fn fn);
+
+	/// Drop any partial frame (e.g. after the link was re-opened)
+	void reset() { st_.skip(carry_len_); carry_len_ = 0; }
+
+	/// Counters so far
+	const decode_stats &stats() const { return st_; }
+
+	/// Number of bytes held back, waiting for the rest of a frame
+	size_t pending() const { return carry_len_; }
+
+	/**
+	 * Number of bytes fed so far
+	 *
+	 * @note
+	 * This is not affected by reset(), so that decoders fed the same
+	 * bytes can tell which of their frames came first.
+	 */
+	uint64_t position() const { return nr_fed_; }
+
+private:
+	template <typename Fn>
+	static void emit(Fn &fn, const frame_type &f, uint64_t end)
+	{
+		if constexpr (std::is_invocable_v<Fn &, const frame_type &, uint64_t>)
+			fn(f, end);
+		else
+			fn(f);
+	}
+
+	uint8_t carry_[Codec::frame_len];
+	size_t carry_len_ = 0;
+	uint64_t nr_fed_ = 0;
+	decode_stats st_;
+};
+
+template <typename Codec>
+template <typename Fn>
+void basic_stream_decoder<Codec>::feed(const uint8_t *p, size_t len, Fn fn)
+{
+	constexpr size_t frame_len = Codec::frame_len;
+	const uint64_t base = nr_fed_;
+	size_t pos = 0;
+
+	nr_fed_ += len;
+
+	if (carry_len_ > 0) {
+		/*
+		 * Resolve the carried-over bytes first: any frame starting
+		 * within them needs at most frame_len - 1 new bytes.
+		 */
+		uint8_t tmp[2*frame_len];
+		const size_t take = std::min(len, frame_len - 1);
+		const size_t avail = carry_len_ + take;
+		size_t x, last = 0, n;
+
+		std::memcpy(tmp, carry_, carry_len_);
+		std::memcpy(tmp + carry_len_, p, take);
+		for (x = 0; x < carry_len_; ++x) {
+			frame_type f;
+
+			if (tmp[x] != Codec::start_1)
+				continue;
+			if ((n = side_record_len<Codec>(tmp + x, avail - x)) > 0) {
+				st_.skip(x - last);
+				last = x + n;
+				x = last - 1;
+				continue;
+			}
+			if (avail - x < frame_len) {
+				// Still incomplete; keep waiting.
+				st_.skip(x - last);
+				carry_len_ = avail - x;
+				std::memmove(carry_, tmp + x, carry_len_);
+				return;
+			}
+			if (Codec::decode(tmp + x, &f)) {
+				st_.skip(x - last);
+				st_.lock();
+				last = x + frame_len;
+				emit(fn, f, base + last - carry_len_);
+				break;
+			}
+			if (tmp[x + 1] == Codec::start_2)
+				++st_.nr_rejected;
+		}
+		// Past the carried-over bytes if a frame or record ran on into p
+		if (last < carry_len_)
+			st_.skip(carry_len_ - last);
+		else
+			pos = last - carry_len_;
+		carry_len_ = 0;
+	}
+
+	const uint64_t from = base + pos;
+
+	pos += scan_frames<Codec>(p + pos, len - pos, len - pos, &st_,
+		[&](const frame_type &f, size_t x) { emit(fn, f, from + x + frame_len); });
+
+	// Whatever is left is the start of a (possible) frame.
+	if (pos < len) {
+		carry_len_ = len - pos;
+		std::memcpy(carry_, p + pos, carry_len_);
+	}
+}
+
+/// Incremental decoder for PMS5003-family frames
+typedef basic_stream_decoder<pms_codec> stream_decoder;
+
+/// Incremental decoder for AQI records
+typedef basic_stream_decoder<aqi_codec> aqi_stream_decoder;
+
+/// Incremental decoder for timestamp records
+typedef basic_stream_decoder<stamp_codec> stamp_stream_decoder;
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_DECODE_H_)
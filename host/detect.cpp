@@ -0,0 +1,153 @@
+/**
+ * @file  host/detect.cpp
+ * @brief Online pollution-event detection on PM readings, in constant memory
+ */
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "detect.h"
+
+namespace pms {
+
+/////////////////////////////////////////////////////////////////////////////
+
+detect_cfg detect_defaults(unsigned int ch)
+{
+	detect_cfg cfg;
+
+	// US-EPA "unhealthy for sensitive groups" breakpoints (see ../aqi.c);
+	// PM1.0 has none, so it shares the PM2.5 one.
+	if (ch == PMS_PM10)
+		cfg.level = 155.0;
+	return cfg;
+}
+
+void detect_print(std::FILE *fp, const pm_event &e, bool begin)
+{
+	static const char *const ch_names[PMS_NR_PM] = { "pm1_0", "pm2_5", "pm10" };
+
+	std::fprintf(fp, "%s device=%u channel=%s kinds=%s%s%s start=%" PRId64
+		     " peak=%u peak_at=%" PRId64 " end=%" PRId64 " baseline=%.1f\n",
+		     begin ? "begin" : "end", e.device, ch_names[e.ch],
+		     (e.kinds & DETECT_CUSUM) ? "C" : "", (e.kinds & DETECT_RISE) ? "R" : "",
+		     (e.kinds & DETECT_EXCEED) ? "E" : "",
+		     e.start_ms, e.peak, e.peak_ms, e.end_ms, e.baseline);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+event_detector::event_detector(uint32_t device, unsigned int ch, const detect_cfg &cfg)
+	: cfg_(cfg)
+{
+	ev_.device = device;
+	ev_.ch     = (uint8_t)ch;
+}
+
+void event_detector::restart(int64_t ts_ms, double v)
+{
+	last_ms_     = ts_ms;
+	fast_        = v;
+	rate_        = 0.0;
+	cusum_       = 0.0;
+	above_since_ = 0;
+	quiet_since_ = 0;
+}
+
+unsigned int event_detector::add(int64_t ts_ms, uint16_t v)
+{
+	if (!primed_) {
+		restart(ts_ms, v);
+		base_ = v;
+		nr_base_ = 1;
+		primed_ = true;
+		return 0;
+	}
+
+	// After a gap, close any event where the data stopped, and start over.
+	const int64_t dt = std::max<int64_t>(ts_ms - last_ms_, 1);
+	if (dt > cfg_.gap_ms) {
+		const bool ended = active_;
+
+		if (ended) {
+			ev_.end_ms = last_ms_;
+			active_ = false;
+		}
+		restart(ts_ms, v);
+		return ended ? DETECT_END : 0;
+	}
+	last_ms_ = ts_ms;
+
+	// Fast EWMA and its slope, in ug/m3 per minute
+	const double a_fast = (double)dt / (double)(cfg_.fast_tau_ms + dt);
+	const double prev = fast_;
+
+	fast_ += a_fast * (v - fast_);
+	rate_ += a_fast * ((fast_ - prev) * 60000.0 / (double)dt - rate_);
+
+	if (cusum_ == 0.0)
+		cusum_since_ = ts_ms;
+	cusum_ = std::max(0.0, cusum_ + (v - base_ - cfg_.cusum_k) * (double)dt / 1000.0);
+
+	if (fast_ < cfg_.level)
+		above_since_ = 0;
+	else if (above_since_ == 0)
+		above_since_ = ts_ms;
+
+	uint8_t fired = 0;
+	int64_t start = ts_ms;
+
+	if (cusum_ > cfg_.cusum_h) {
+		fired |= DETECT_CUSUM;
+		start = std::min(start, cusum_since_);
+	}
+	if (rate_ >= cfg_.rise_per_min)
+		fired |= DETECT_RISE;
+	if (above_since_ != 0 && ts_ms - above_since_ >= cfg_.level_ms) {
+		fired |= DETECT_EXCEED;
+		start = std::min(start, above_since_);
+	}
+
+	if (!active_) {
+		if (fired == 0) {
+			// The baseline only learns from quiet air; early on, it is a
+			// plain mean, so that the first reading does not weigh for an
+			// hour.
+			const double a_base = std::max((double)dt / (double)(cfg_.base_tau_ms + dt),
+						       1.0 / (double)++nr_base_);
+
+			base_ += a_base * (v - base_);
+			return 0;
+		}
+		ev_.kinds    = fired;
+		ev_.peak     = v;
+		ev_.peak_ms  = ts_ms;
+		ev_.start_ms = start;
+		ev_.end_ms   = 0;
+		ev_.baseline = base_;
+		active_      = true;
+		quiet_since_ = 0;
+		++nr_events_;
+		return DETECT_BEGIN;
+	}
+
+	ev_.kinds |= fired;
+	if (v > ev_.peak) {
+		ev_.peak    = v;
+		ev_.peak_ms = ts_ms;
+	}
+	if (fast_ >= base_ + cfg_.cusum_k || fast_ >= cfg_.level) {
+		quiet_since_ = 0;
+	} else if (quiet_since_ == 0) {
+		quiet_since_ = ts_ms;
+	} else if (ts_ms - quiet_since_ >= cfg_.quiet_ms) {
+		ev_.end_ms   = quiet_since_;
+		active_      = false;
+		cusum_       = 0.0;
+		above_since_ = 0;
+		return DETECT_END;
+	}
+	return 0;
+}
+
+}	// namespace pms
@@ -0,0 +1,148 @@
+/**
+ * @file  host/detect.h
+ * @brief Online pollution-event detection on PM readings, in constant memory
+ */
+
+/*
+ * Each (device, PM channel) stream is watched by three detectors, which only
+ * keep a handful of running values, never past readings:
+ *
+ *  - CUSUM: S = max(0, S + (x - baseline - k) dt) integrates readings above
+ *    a slowly-tracking baseline (an EWMA, frozen during events) over time,
+ *    so that it does not depend on the frame rate, and fires once S exceeds
+ *    h. The time S last left zero estimates the change point.
+ *  - Rate of rise: the slope of a fast EWMA, in ug/m3 per minute, fires
+ *    above a limit.
+ *  - Sustained exceedance: the fast EWMA stays at or above a level (by
+ *    default the AQI "unhealthy for sensitive groups" breakpoint) for a
+ *    minimum time.
+ *
+ * An event begins when any detector fires; it records which ones did, and
+ * the peak reading. It ends once the fast EWMA has been back below both the
+ * baseline plus k and the level for a quiet period; the end time is when it
+ * first went back below. A gap in the readings also ends any event, at the
+ * last reading before the gap, and restarts the detectors.
+ */
+
+#if !defined(EEE192_HOST_DETECT_H_)
+#define EEE192_HOST_DETECT_H_
+
+#include <cstdint>
+#include <cstdio>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Detectors, as bits of @c pm_event::kinds
+constexpr uint8_t DETECT_CUSUM	= 0x01;
+constexpr uint8_t DETECT_RISE	= 0x02;
+constexpr uint8_t DETECT_EXCEED	= 0x04;
+
+/// What event_detector::add() saw
+constexpr unsigned int DETECT_BEGIN	= 0x01;
+constexpr unsigned int DETECT_END	= 0x02;
+
+/// Detector settings; values are in ug/m3, times in milliseconds
+struct detect_cfg {
+	/// CUSUM slack (k) and decision threshold (h, in ug/m3 x seconds)
+	double cusum_k = 5.0;
+	double cusum_h = 60.0;
+
+	/// Rate-of-rise limit, in ug/m3 per minute
+	double rise_per_min = 15.0;
+
+	/// Exceedance level, and how long it must be held
+	double level = 35.5;
+	int64_t level_ms = 5 * 60 * 1000;
+
+	/// Time constants of the fast EWMA and of the baseline
+	int64_t fast_tau_ms = 30 * 1000;
+	int64_t base_tau_ms = 60 * 60 * 1000;
+
+	/// Time the readings must stay quiet for an event to end
+	int64_t quiet_ms = 2 * 60 * 1000;
+
+	/// Longest gap between readings before the detectors restart
+	int64_t gap_ms = 5 * 60 * 1000;
+};
+
+/// Default settings for a PM channel (the level differs for PM10)
+detect_cfg detect_defaults(unsigned int ch);
+
+/// One pollution event
+struct pm_event {
+	uint32_t device;
+	uint8_t  ch;
+
+	/// Bitmask of @code DETECT_* @endcode detectors that fired
+	uint8_t  kinds;
+
+	/// Highest reading, and when it was seen
+	uint16_t peak;
+	int64_t  peak_ms;
+
+	/// Estimated start, and end (0 while the event is still going on)
+	int64_t  start_ms;
+	int64_t  end_ms;
+
+	/// Baseline at the start of the event
+	double   baseline;
+};
+
+/// Print an event as one line ("begin" or "end", then its fields)
+void detect_print(std::FILE *fp, const pm_event &e, bool begin);
+
+/// Detectors for one (device, channel) stream
+class event_detector {
+public:
+	event_detector() = default;
+	event_detector(uint32_t device, unsigned int ch, const detect_cfg &cfg);
+
+	/**
+	 * Process one reading
+	 *
+	 * @param[in]	ts_ms	Time of the reading; increasing
+	 * @param[in]	v	Reading
+	 *
+	 * @return	@c DETECT_BEGIN or @c DETECT_END if an event began or
+	 *		ended with this reading, or 0
+	 */
+	unsigned int add(int64_t ts_ms, uint16_t v);
+
+	/// Current event, or the last one if none is going on
+	const pm_event &event() const { return ev_; }
+
+	/// Whether an event is going on
+	bool active() const { return active_; }
+
+	/// Number of events begun so far
+	uint64_t nr_events() const { return nr_events_; }
+
+private:
+	void restart(int64_t ts_ms, double v);
+
+	detect_cfg cfg_;
+	pm_event ev_ = {};
+	bool active_ = false;
+	bool primed_ = false;
+	uint64_t nr_events_ = 0;
+
+	int64_t last_ms_ = 0;
+	double fast_ = 0.0;
+	double base_ = 0.0;
+	uint64_t nr_base_ = 0;
+	double rate_ = 0.0;
+
+	double cusum_ = 0.0;
+	int64_t cusum_since_ = 0;
+
+	// Start of the current run at or above the level, and below the end
+	// condition (0: none)
+	int64_t above_since_ = 0;
+	int64_t quiet_since_ = 0;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_DETECT_H_)
@@ -0,0 +1,104 @@
+/**
+ * @file  host/events.cpp
+ * @brief pms-events: replay PM archives through the pollution-event detectors
+ */
+
+/*
+ * Usage: pms-events [-d device] archive...
+ *
+ * Samples are fed, in time order, through the same detectors as pms-ingest
+ * runs live (see detect.h), one set per device and channel, and every event
+ * is printed as a "begin" and an "end" line; events still going on at the
+ * end of the data are printed as "begin" only. This is meant for picking
+ * detector settings on past data, and for finding events that happened
+ * before live detection was in place.
+ *
+ * Archives are read one after the other, so that several ones should cover
+ * successive periods (or different devices).
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "archive.h"
+#include "detect.h"
+
+using namespace pms;
+
+namespace {
+
+void usage(void)
+{
+	std::fprintf(stderr, "usage: pms-events [-d device] archive...\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	std::unordered_map<uint32_t, std::array<event_detector, PMS_NR_PM>> detectors;
+	uint64_t nr_samples = 0, nr_events = 0;
+	long device = -1;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'd': device = std::strtol(argv[++x], nullptr, 0); break;
+		default:  usage();
+		}
+	}
+	if (x == argc)
+		usage();
+
+	std::chrono::duration<double> busy(0);
+
+	for (; x < argc; ++x) {
+		archive_reader ar;
+
+		if (!ar.open(argv[x])) {
+			std::fprintf(stderr, "pms-events: %s: %s\n", argv[x], std::strerror(errno));
+			return 1;
+		}
+
+		auto t0 = std::chrono::steady_clock::now();
+		for (uint64_t y = 0; y < ar.header().nr_records; ++y) {
+			const sample &s = ar.records()[y];
+
+			if (device >= 0 && s.device != (uint32_t)device)
+				continue;
+
+			auto it = detectors.find(s.device);
+			if (it == detectors.end()) {
+				it = detectors.emplace(s.device, std::array<event_detector, PMS_NR_PM>()).first;
+				for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+					it->second[ch] = event_detector(s.device, ch, detect_defaults(ch));
+			}
+			for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+				event_detector &d = it->second[ch];
+				const unsigned int r = d.add(s.ts_ms, s.pm_atm[ch]);
+
+				if (r != 0)
+					detect_print(stdout, d.event(), r == DETECT_BEGIN);
+				nr_events += (r == DETECT_BEGIN) ? 1 : 0;
+			}
+			++nr_samples;
+		}
+		busy += std::chrono::steady_clock::now() - t0;
+	}
+
+	const double secs = std::max(busy.count(), 1e-9);
+	std::fprintf(stderr, "pms-events: %llu samples from %zu devices, %llu events "
+		     "(%.0f ns per sample, all channels)\n",
+		     (unsigned long long)nr_samples, detectors.size(), (unsigned long long)nr_events,
+		     nr_samples ? secs * 1e9 / (double)nr_samples : 0.0);
+	return 0;
+}
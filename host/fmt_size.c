@@ -0,0 +1,50 @@
+/**
+ * @file  host/fmt_size.c
+ * @brief Minimal program for "make fmt-size": one status line, formatted
+ *        either with ../fmt.h or with snprintf()
+ */
+
+#include <stdint.h>
+
+#if defined(FMT_SIZE_SNPRINTF)
+#include <stdio.h>
+#else
+#include "../fmt.h"
+#endif
+
+// Keep the compiler from folding anything away.
+volatile uint32_t in[4];
+volatile int32_t in_centi;
+char out[128];
+volatile uint16_t out_len;
+
+int main(void)
+{
+#if defined(FMT_SIZE_SNPRINTF)
+	uint32_t t = (uint32_t)(in_centi < 0 ? -in_centi : in_centi);
+	int n = snprintf(out, sizeof(out),
+		"\r\nframes %lu, bad %lu, up %06lu s, t %s%lu.%02lu, cause 0x%02lX\r\n",
+		(unsigned long)in[0], (unsigned long)in[1], (unsigned long)in[2],
+		in_centi < 0 ? "-" : "", (unsigned long)(t / 100), (unsigned long)(t % 100),
+		(unsigned long)in[3]);
+
+	out_len = (uint16_t)n;
+#else
+	fmt_t f;
+
+	fmt_init(&f, out, sizeof(out));
+	fmt_lit(&f, "\r\nframes ");
+	fmt_u32(&f, in[0]);
+	fmt_lit(&f, ", bad ");
+	fmt_u32(&f, in[1]);
+	fmt_lit(&f, ", up ");
+	fmt_u32_pad(&f, in[2], 6, '0');
+	fmt_lit(&f, " s, t ");
+	fmt_fixed(&f, in_centi, 2);
+	fmt_lit(&f, ", cause 0x");
+	fmt_hex(&f, in[3], 2);
+	fmt_lit(&f, "\r\n");
+	out_len = f.len;
+#endif
+	return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file  host/framegen.cpp
+ * @brief Synthetic PMS byte streams with controllable link impairments
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "../aqi.h"
+#include "../stamp.h"
+#include "framegen.h"
+
+namespace pms {
+
+/// Mean-reversion rate of the PM2.5 random walk, per frame
+constexpr double FRAMEGEN_REVERSION = 0.02;
+
+/// Probability of a single-frame spike (insects, dust bursts)
+constexpr double FRAMEGEN_P_SPIKE = 0.002;
+
+/// Version byte reported by the sensors captured in putty.log
+constexpr uint8_t FRAMEGEN_VERSION = 0x12;
+
+static void wr_be16(uint8_t *p, uint32_t v)
+{
+	v = std::min<uint32_t>(v, 0xFFFF);
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+frame_generator::frame_generator(const framegen_config &cfg)
+	: cfg_(cfg), rng_(cfg.seed * 0x9E3779B97F4A7C15ull + 1), pm2_5_(cfg.pm2_5_level)
+{
+}
+
+// splitmix64
+uint64_t frame_generator::next_u64()
+{
+	uint64_t z = (rng_ += 0x9E3779B97F4A7C15ull);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+double frame_generator::uniform()
+{
+	return (double)(next_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void frame_generator::next_frame(uint8_t raw[PMS_FRAME_LEN])
+{
+	double noise = (uniform() + uniform() + uniform() - 1.5) * 2.0;
+	double pm25, pm1, pm10;
+	uint16_t sum;
+
+	pm2_5_ += FRAMEGEN_REVERSION * (cfg_.pm2_5_level - pm2_5_) + noise;
+	pm2_5_  = std::max(pm2_5_, 0.0);
+	pm25    = pm2_5_;
+	if (uniform() < FRAMEGEN_P_SPIKE)
+		pm25 *= 3.0 + 5.0 * uniform();
+	pm1  = pm25 * 0.70;
+	pm10 = pm25 * 1.15;
+
+	raw[0] = PMS_FRAME_START_1;
+	raw[1] = PMS_FRAME_START_2;
+	wr_be16(&raw[2], PMS_FRAME_DATA_LEN);
+
+	// CF=1 values track the atmospheric ones, and read higher above ~30.
+	const double cf = pm25 > 30.0 ? 1.0 + (pm25 - 30.0) / 200.0 : 1.0;
+	wr_be16(&raw[4],  (uint32_t)std::lround(pm1 * cf));
+	wr_be16(&raw[6],  (uint32_t)std::lround(pm25 * cf));
+	wr_be16(&raw[8],  (uint32_t)std::lround(pm10 * cf));
+	wr_be16(&raw[10], (uint32_t)std::lround(pm1));
+	wr_be16(&raw[12], (uint32_t)std::lround(pm25));
+	wr_be16(&raw[14], (uint32_t)std::lround(pm10));
+
+	// Cumulative counts per 0.1L; the >10 um bin is the sequence number.
+	wr_be16(&raw[16], (uint32_t)std::lround(pm25 * 85.0));
+	wr_be16(&raw[18], (uint32_t)std::lround(pm25 * 57.0));
+	wr_be16(&raw[20], (uint32_t)std::lround(pm25 * 5.7));
+	wr_be16(&raw[22], (uint32_t)std::lround(pm10 * 0.3));
+	wr_be16(&raw[24], (uint32_t)std::lround(pm10 * 0.05));
+	wr_be16(&raw[26], seq_++);
+	raw[28] = FRAMEGEN_VERSION;
+	raw[29] = 0x00;
+
+	sum = pms_frame_checksum(raw);
+	wr_be16(&raw[30], sum);
+}
+
+uint64_t frame_generator::generate(std::vector<uint8_t> *out, size_t nr_frames,
+	std::vector<framegen_truth> *truth)
+{
+	const bool impaired = cfg_.p_bit_error > 0.0 || cfg_.p_drop > 0.0 ||
+			      cfg_.p_insert > 0.0 || cfg_.p_truncate > 0.0;
+	const uint64_t period_ns = (uint64_t)(1e9 / std::max(cfg_.frame_rate_hz, 1e-9));
+	uint64_t nr_events = 0;
+
+	out->reserve(out->size() + nr_frames * (PMS_FRAME_LEN +
+		     (cfg_.side_records ? AQI_RECORD_LEN + STAMP_RECORD_LEN : 0)));
+	for (size_t n = 0; n < nr_frames; ++n) {
+		uint8_t raw[PMS_FRAME_LEN];
+		framegen_truth t;
+
+		next_frame(raw);
+		t.seq    = (uint16_t)(seq_ - 1);
+		t.offset = out->size();
+		t.t_ns   = t_ns_;
+		t.intact = true;
+		t.damage_end = 0;
+		t_ns_   += period_ns;
+
+		if (!impaired) {
+			out->insert(out->end(), raw, raw + PMS_FRAME_LEN);
+		} else {
+			size_t len = PMS_FRAME_LEN;
+
+			if (uniform() < cfg_.p_truncate) {
+				len = (size_t)(next_u64() % PMS_FRAME_LEN);
+				t.intact = false;
+				++nr_events;
+			}
+			for (size_t x = 0; x < len; ++x) {
+				uint8_t c = raw[x];
+
+				// Garbage ahead of the first byte leaves the frame whole.
+				if (uniform() < cfg_.p_insert) {
+					out->push_back((uint8_t)next_u64());
+					t.intact = x == 0 && t.intact;
+					t.damage_end = out->size();
+					++nr_events;
+				}
+				if (x == 0)
+					t.offset = out->size();
+				if (uniform() < cfg_.p_drop) {
+					t.intact = false;
+					t.damage_end = out->size();
+					++nr_events;
+					continue;
+				}
+				if (uniform() < cfg_.p_bit_error) {
+					c ^= (uint8_t)(1u << (next_u64() & 7));
+					t.intact = false;
+					t.damage_end = out->size() + 1;
+					++nr_events;
+				}
+				out->push_back(c);
+			}
+			if (len < PMS_FRAME_LEN)
+				t.damage_end = out->size();
+		}
+		if (cfg_.side_records) {
+			uint8_t rec[AQI_RECORD_LEN + STAMP_RECORD_LEN];
+			pms_frame_t f;
+			aqi_t aqi;
+
+			pms_frame_decode(&f, raw);
+			aqi_from_frame(&aqi, &f);
+			aqi_record_encode(rec, &aqi);
+			stamp_record_encode(rec + AQI_RECORD_LEN, t.t_ns / 1000);
+			out->insert(out->end(), rec, rec + sizeof(rec));
+		}
+		if (truth != nullptr)
+			truth->push_back(t);
+	}
+	return nr_events;
+}
+
+size_t frame_generator::next_read_len()
+{
+	if (cfg_.read_max == 0)
+		return SIZE_MAX;
+	if (cfg_.read_max <= cfg_.read_min)
+		return std::max<size_t>(cfg_.read_min, 1);
+	return cfg_.read_min + (size_t)(next_u64() % (cfg_.read_max - cfg_.read_min + 1));
+}
+
+}	// namespace pms
@@ -0,0 +1,121 @@
+/**
+ * @file  host/framegen.h
+ * @brief Synthetic PMS byte streams with controllable link impairments
+ */
+
+/*
+ * Readings follow a mean-reverting random walk around a configurable PM2.5
+ * level, with occasional short spikes, and the other channels and particle
+ * counts are derived from it the way a real PMS5003 reports them. The >10 um
+ * particle count carries a frame sequence number instead, so that decoded
+ * frames can be matched against the ground truth.
+ *
+ * Impairments are applied per byte after framing: bit errors, dropped bytes
+ * and inserted garbage bytes; whole frames may also be cut short, as when a
+ * capture starts or stops mid-frame. Each generated frame records whether
+ * (and up to where) any impairment touched it.
+ *
+ * Frames may also be followed by an AQI record and a timestamp record, as
+ * the firmware forwards them (see ../aqi.h and ../stamp.h); those are never
+ * impaired.
+ */
+
+#if !defined(EEE192_HOST_FRAMEGEN_H_)
+#define EEE192_HOST_FRAMEGEN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../pms.h"
+
+namespace pms {
+
+/// Generator settings
+struct framegen_config {
+	/// Seed for all random choices; equal seeds give equal streams
+	uint64_t seed = 1;
+
+	/// Frames per second; the real sensor sends about one
+	double frame_rate_hz = 1.0;
+
+	/// Long-term PM2.5 level, in ug/m3
+	double pm2_5_level = 35.0;
+
+	/// Probability of a bit error, per byte
+	double p_bit_error = 0.0;
+
+	/// Probability of a byte being dropped
+	double p_drop = 0.0;
+
+	/// Probability of a garbage byte being inserted before a byte
+	double p_insert = 0.0;
+
+	/// Probability of a frame being cut short (the rest of it is lost)
+	double p_truncate = 0.0;
+
+	/// Whether each frame is followed by the firmware's AQI and timestamp records
+	bool side_records = false;
+
+	/// Bounds on the size of each simulated read (0: one single read)
+	size_t read_min = 0;
+	size_t read_max = 0;
+};
+
+/// Ground truth for one generated frame
+struct framegen_truth {
+	/// Sequence number, as carried in the >10 um count
+	uint16_t seq;
+
+	/// Offset of the frame's first byte in the (impaired) stream
+	size_t offset;
+
+	/// Nominal send time, in nanoseconds from the start of the stream
+	uint64_t t_ns;
+
+	/// Whether any impairment touched this frame
+	bool intact;
+
+	/// Offset of the first byte after the last impairment within (or just
+	/// ahead of) this frame; 0 if there was none
+	size_t damage_end;
+};
+
+/// Generator state
+class frame_generator {
+public:
+	explicit frame_generator(const framegen_config &cfg);
+
+	/// Produce the next reading as a raw, valid frame
+	void next_frame(uint8_t raw[PMS_FRAME_LEN]);
+
+	/**
+	 * Append @c nr_frames impaired frames to @c out
+	 *
+	 * @param[out]	truth	Per-frame ground truth; may be @c NULL
+	 *
+	 * @return	Number of impairment events applied
+	 */
+	uint64_t generate(std::vector<uint8_t> *out, size_t nr_frames,
+			  std::vector<framegen_truth> *truth);
+
+	/// Length of the next simulated read
+	size_t next_read_len();
+
+	/// Uniformly-distributed random number on [0, 1)
+	double uniform();
+
+	/// Raw 64-bit random number
+	uint64_t next_u64();
+
+private:
+	framegen_config cfg_;
+	uint64_t rng_;
+	double pm2_5_;
+	uint16_t seq_ = 0;
+	uint64_t t_ns_ = 0;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_FRAMEGEN_H_)
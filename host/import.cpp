@@ -0,0 +1,697 @@
+/**
+ * @file  host/import.cpp
+ * @brief pms-import: migrate legacy convert.log/putty.log captures into an archive
+ */
+
+/*
+ * Usage: pms-import [-j threads] [-d device] [-t epoch] -o archive file...
+ *
+ * Recognized inputs, detected per file:
+ * -- Text logs written by convert.py, in any mix of its two output formats:
+ *    "Hex: ..." followed by "PM1.0: 0.45 | PM2.5: ..." (each value printed as
+ *    "<high byte>.<low byte>"), and the newer "PM1.0: 45 | PM 2.5: 56 | ...".
+ *    One reading was logged every TIME_DELAY (1.01 s).
+ * -- Raw captures (putty.log), optionally starting with PuTTY's log header.
+ *    The sensor sends one frame per second.
+ * -- Journals written by pms-ingest, which carry their own timestamps and
+ *    device identifiers (-d and -t do not apply to them).
+ *
+ * Logs and captures carry no per-reading timestamps. Unless -t gives the
+ * start time of the files that follow it, the PuTTY header is used if
+ * present; otherwise the file's mtime is taken as the time of its last
+ * reading.
+ *
+ * Duplicates are removed in two passes:
+ * -- convert.py re-read the same last frame whenever no new one had arrived;
+ *    consecutive identical full frames within a text log are dropped.
+ * -- Captures of the same device that overlap (e.g. a copy of a log taken
+ *    before it grew further) are recognized by content, aligned onto the
+ *    capture they overlap, and trimmed.
+ * -- Samples present in several journals (e.g. a journal imported again
+ *    after it grew) are dropped as exact duplicates while merging.
+ *
+ * -d and -t apply to all files that follow them on the command line.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "decode.h"
+#include "journal.h"
+#include "sample.h"
+#include "scan.h"
+
+using namespace pms;
+
+namespace {
+
+/// Interval between readings in a convert.py log (its TIME_DELAY)
+constexpr int64_t TEXT_PERIOD_MS	= 1010;
+
+/// Interval between frames in a raw capture
+constexpr int64_t RAW_PERIOD_MS		= 1000;
+
+/// Size of the slices that input files are cut into for parallel parsing
+constexpr size_t RANGE_BYTES		= (size_t)32 << 20;
+
+/// Number of consecutive samples used to recognize overlapping captures
+constexpr size_t OVERLAP_WINDOW		= 32;
+
+/// Minimum number of distinct readings for a window to be trusted
+constexpr size_t OVERLAP_MIN_DISTINCT	= 4;
+
+/// Sentinel for "timestamp unknown"
+constexpr int64_t TS_UNKNOWN		= INT64_MIN;
+
+enum class input_format { text_log, raw_capture, journal };
+
+struct input_file {
+	const char *path = nullptr;
+	uint32_t device = 0;
+	int64_t ts_start_ms = TS_UNKNOWN;
+	int64_t ts_end_ms = 0;
+
+	const char *data = nullptr;
+	size_t len = 0;
+	size_t data_begin = 0;
+	input_format fmt = input_format::text_log;
+	int64_t period_ms = 0;
+
+	std::vector<sample> samples;
+	std::vector<uint64_t> fps;
+	size_t nr_rereads = 0;
+
+	// Overlap resolution: samples [0, overlap) are also in base at base_pos
+	long base = -1;
+	size_t base_pos = 0;
+	size_t overlap = 0;
+	bool aligned = false;
+};
+
+struct work_range {
+	size_t file;
+	size_t begin;
+	size_t end;
+
+	std::vector<sample> out;
+	uint64_t nr_lines;
+	uint64_t nr_bad;
+};
+
+struct overlap_hit {
+	size_t file;	// File whose head was found...
+	size_t base;	// ... inside this one...
+	size_t pos;	// ... at this position
+};
+
+// Run fn(0) .. fn(n-1) on up to nr_threads threads
+template <typename Fn>
+void parallel_for(size_t n, unsigned int nr_threads, Fn fn)
+{
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> pool;
+	auto worker = [&]() {
+		for (size_t x; (x = next.fetch_add(1)) < n; )
+			fn(x);
+	};
+
+	nr_threads = (unsigned int)std::min<size_t>(nr_threads, n);
+	for (unsigned int x = 1; x < nr_threads; ++x)
+		pool.emplace_back(worker);
+	worker();
+	for (std::thread &t : pool)
+		t.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+ * PuTTY starts session logs with a line of the form
+ *
+ *   =~=~=~=~=~=~=~=~=~=~=~= PuTTY log 2025.03.12 14:03:11 =~=~=~=~=~=~=~=~=~=~=~=
+ *
+ * with the time given in local time.
+ */
+bool parse_putty_header(const char *p, const char *end, int64_t *ts_ms, size_t *hdr_len)
+{
+	const char *line = p;
+	const char *eol  = scan::line_end(p, end);
+	uint32_t v[6];
+	struct tm tm;
+
+	if (!scan::lit(p, eol, "=~=~=~=~", 8) || !scan::skip_past(p, eol, 'P') ||
+	    !scan::lit(p, eol, "uTTY log ", 9))
+		return false;
+	for (unsigned int x = 0; x < 6; ++x) {
+		if (!scan::dec(p, eol, &v[x]))
+			return false;
+		if (x < 5)
+			++p;	// Separator
+	}
+
+	std::memset(&tm, 0, sizeof(tm));
+	tm.tm_year  = (int)v[0] - 1900;
+	tm.tm_mon   = (int)v[1] - 1;
+	tm.tm_mday  = (int)v[2];
+	tm.tm_hour  = (int)v[3];
+	tm.tm_min   = (int)v[4];
+	tm.tm_sec   = (int)v[5];
+	tm.tm_isdst = -1;
+	*ts_ms = (int64_t)std::mktime(&tm) * 1000;
+	*hdr_len = (size_t)(eol - line) + (eol < end ? 1 : 0);
+	return true;
+}
+
+// Decide between a text log and a raw capture from the first few KiB
+input_format detect_format(const char *p, size_t len)
+{
+	size_t nr_binary = 0;
+
+	len = std::min<size_t>(len, 4096);
+	for (size_t x = 0; x < len; ++x) {
+		unsigned char c = (unsigned char)p[x];
+
+		if (c >= 0x80 || (c < 0x20 && c != '\r' && c != '\n' && c != '\t' && c != 0x1b))
+			++nr_binary;
+	}
+	return (nr_binary*16 > len) ? input_format::raw_capture : input_format::text_log;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Parse the three values of a "PM1.0: ..." line; *is_dec tells the old format
+bool parse_value_line(const char *p, const char *eol, uint16_t pm[PMS_NR_PM], bool *is_dec)
+{
+	*is_dec = false;
+	for (unsigned int x = 0; x < PMS_NR_PM; ++x) {
+		uint32_t a, b;
+
+		if (x > 0 && (!scan::skip_past(p, eol, '|') || !scan::skip_past(p, eol, ':')))
+			return false;
+		scan::skip_ws(p, eol);
+		if (!scan::dec(p, eol, &a))
+			return false;
+		if (p < eol && *p == '.') {
+			/*
+			 * The old convert.py printed each byte of the value in
+			 * decimal, separated by a dot; i.e., "0.68" is 0x0044.
+			 */
+			++p;
+			if (!scan::dec(p, eol, &b) || a > 0xFF || b > 0xFF)
+				return false;
+			a = (a << 8) | b;
+			*is_dec = true;
+		} else if (a > 0xFFFF) {
+			return false;
+		}
+		pm[x] = (uint16_t)a;
+	}
+	return true;
+}
+
+// Parse all lines of a text log that start within [begin, end)
+void parse_text_range(const input_file &in, work_range &r)
+{
+	const char *base = in.data;
+	const char *p    = base + r.begin;
+	const char *lim  = base + r.end;
+	const char *eof  = base + in.len;
+	bool after_hex   = false;
+
+	// Only whole lines belong to a range; the previous one owns the rest.
+	if (r.begin > in.data_begin && p[-1] != '\n') {
+		if (!scan::skip_past(p, eof, '\n'))
+			return;
+	}
+	if (p > base + in.data_begin) {
+		// Was the previous line a "Hex:" line?
+		const char *q = p - 1;
+
+		while (q > base + in.data_begin && q[-1] != '\n')
+			--q;
+		after_hex = scan::lit(q, p, "Hex: ", 5);
+	}
+
+	while (p < lim) {
+		const char *eol  = scan::line_end(p, eof);
+		const char *next = (eol < eof) ? eol + 1 : eof;
+		sample s;
+
+		++r.nr_lines;
+		std::memset(&s, 0, sizeof(s));
+		s.device = in.device;
+
+		if (scan::lit(p, eol, "Hex: ", 5)) {
+			uint8_t raw[PMS_FRAME_LEN] = { PMS_FRAME_START_1, PMS_FRAME_START_2 };
+			pms_frame_t f;
+
+			after_hex = true;
+			if (scan::hex_bytes(p, eol, &raw[2], PMS_FRAME_LEN - 2) &&
+			    pms_frame_decode(&f, raw)) {
+				sample_from_frame(&s, &f);
+				r.out.push_back(s);
+			} else {
+				++r.nr_bad;
+			}
+		} else if (scan::lit(p, eol, "PM1.0:", 6)) {
+			bool is_dec;
+
+			if (!parse_value_line(p, eol, s.pm_atm, &is_dec)) {
+				++r.nr_bad;
+			} else if (!(is_dec && after_hex)) {
+				// A "Hex:" line already carried this reading.
+				r.out.push_back(s);
+			}
+			after_hex = false;
+		} else if (scan::lit(p, eol, "Error!", 6)) {
+			// convert.py retried immediately, so no time elapsed.
+			after_hex = false;
+		} else if (p != eol && !(eol - p == 1 && *p == '\r')) {
+			++r.nr_bad;
+		}
+		p = next;
+	}
+}
+
+// Extract all frames whose start characters lie within [begin, end)
+void parse_raw_range(const input_file &in, work_range &r)
+{
+	const size_t b = std::max(r.begin, in.data_begin);
+	decode_stats st;
+
+	if (b >= r.end)
+		return;
+	decode_batch(reinterpret_cast<const uint8_t *>(in.data) + b, in.len - b, r.end - b, &st,
+		[&](const pms_frame_t &f, size_t) {
+			sample s;
+
+			std::memset(&s, 0, sizeof(s));
+			s.device = in.device;
+			sample_from_frame(&s, &f);
+			r.out.push_back(s);
+		});
+	r.nr_lines += st.nr_frames;
+}
+
+// Copy all journal records that start within [begin, end)
+void parse_journal_range(const input_file &in, work_range &r)
+{
+	const size_t b = std::max(r.begin, in.data_begin);
+	size_t first = (b - in.data_begin + sizeof(sample) - 1) / sizeof(sample);
+	size_t last  = (r.end - in.data_begin + sizeof(sample) - 1) / sizeof(sample);
+
+	last = std::min(last, (in.len - in.data_begin) / sizeof(sample));
+	for (size_t x = first; x < last; ++x) {
+		sample s;
+
+		std::memcpy(&s, in.data + in.data_begin + x * sizeof(sample), sizeof(s));
+		r.out.push_back(s);
+	}
+	r.nr_lines += last > first ? last - first : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Rolling hash over a window of fingerprints
+constexpr uint64_t WINDOW_MUL = 0x9E3779B97F4A7C15ull;
+
+uint64_t window_hash(const uint64_t *fp, size_t n)
+{
+	uint64_t h = 0;
+
+	for (size_t x = 0; x < n; ++x)
+		h = h*WINDOW_MUL + fp[x];
+	return h;
+}
+
+bool window_trusted(const uint64_t *fp, size_t n)
+{
+	size_t distinct = 1;
+
+	for (size_t x = 1; x < n && distinct < OVERLAP_MIN_DISTINCT; ++x) {
+		if (std::find(fp, fp + x, fp[x]) == fp + x)
+			++distinct;
+	}
+	return distinct >= OVERLAP_MIN_DISTINCT;
+}
+
+// Place a file's samples in time, one period apart
+void time_file(input_file &in)
+{
+	if (in.ts_start_ms == TS_UNKNOWN) {
+		in.ts_start_ms = in.ts_end_ms -
+			(int64_t)(in.samples.empty() ? 0 : in.samples.size() - 1) * in.period_ms;
+	}
+	for (size_t x = 0; x < in.samples.size(); ++x) {
+		in.samples[x].ts_ms  = in.ts_start_ms + (int64_t)x * in.period_ms;
+		in.samples[x].flags |= SAMPLE_FLAG_TS_SYNTH;
+	}
+}
+
+// Shift a file's samples onto the capture it overlaps, aligning that one first
+void align_file(std::vector<input_file> &files, size_t idx)
+{
+	input_file &in = files[idx];
+	int64_t delta;
+
+	if (in.aligned)
+		return;
+	in.aligned = true;
+	if (in.base < 0 || in.samples.empty())
+		return;
+
+	align_file(files, (size_t)in.base);
+	delta = files[(size_t)in.base].samples[in.base_pos].ts_ms - in.samples[0].ts_ms;
+	for (sample &s : in.samples)
+		s.ts_ms += delta;
+}
+
+// Whether following overlap bases from one file leads to another
+bool reaches(const std::vector<input_file> &files, size_t from, size_t to)
+{
+	for (size_t n = 0; n <= files.size(); ++n) {
+		if (from == to)
+			return true;
+		if (files[from].base < 0)
+			return false;
+		from = (size_t)files[from].base;
+	}
+	return true;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr,
+		"usage: pms-import [-j threads] [-d device] [-t epoch] -o archive file...\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+	const char *out_path = nullptr;
+	unsigned int nr_threads = std::max(1u, std::thread::hardware_concurrency());
+	uint32_t device = 0;
+	int64_t ts_start = TS_UNKNOWN;
+	std::vector<input_file> files;
+	std::vector<work_range> ranges;
+	uint64_t nr_lines = 0, nr_bad = 0, nr_bytes = 0;
+	uint64_t nr_rereads = 0, nr_overlap = 0, nr_written = 0;
+
+	// Options and inputs may be interleaved; -d and -t are positional.
+	for (int x = 1; x < argc; ++x) {
+		const char *a = argv[x];
+
+		if (a[0] == '-' && a[1] != '\0' && a[2] == '\0') {
+			if (x + 1 >= argc)
+				usage();
+			switch (a[1]) {
+			case 'o': out_path = argv[++x]; break;
+			case 'j': nr_threads = (unsigned int)std::max(1L, std::strtol(argv[++x], nullptr, 0)); break;
+			case 'd': device = (uint32_t)std::strtoul(argv[++x], nullptr, 0); break;
+			case 't': ts_start = (int64_t)std::strtoll(argv[++x], nullptr, 0) * 1000; break;
+			default:  usage();
+			}
+			continue;
+		}
+
+		input_file in;
+		in.path        = a;
+		in.device      = device;
+		in.ts_start_ms = ts_start;
+		files.push_back(std::move(in));
+	}
+	if (out_path == nullptr || files.empty())
+		usage();
+
+	auto t_begin = std::chrono::steady_clock::now();
+
+	// Map every input, and cut it into ranges.
+	for (size_t x = 0; x < files.size(); ++x) {
+		input_file &in = files[x];
+		struct stat st;
+		int fd = open(in.path, O_RDONLY);
+
+		if (fd < 0 || fstat(fd, &st) != 0) {
+			std::fprintf(stderr, "pms-import: %s: %s\n", in.path, std::strerror(errno));
+			return 1;
+		}
+		in.len       = (size_t)st.st_size;
+		in.ts_end_ms = (int64_t)st.st_mtime * 1000;
+		if (in.len > 0) {
+			void *m = mmap(nullptr, in.len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (m == MAP_FAILED) {
+				std::fprintf(stderr, "pms-import: %s: %s\n", in.path, std::strerror(errno));
+				return 1;
+			}
+			madvise(m, in.len, MADV_SEQUENTIAL);
+			in.data = static_cast<const char *>(m);
+		}
+		close(fd);
+		nr_bytes += in.len;
+
+		int64_t hdr_ts;
+		size_t hdr_len;
+		if (journal_nr_records(in.data, in.len) >= 0) {
+			in.data_begin = sizeof(journal_header);
+			in.fmt = input_format::journal;
+		} else {
+			if (in.len > 0 && parse_putty_header(in.data, in.data + in.len, &hdr_ts, &hdr_len)) {
+				in.data_begin = hdr_len;
+				if (in.ts_start_ms == TS_UNKNOWN)
+					in.ts_start_ms = hdr_ts;
+			}
+			in.fmt = detect_format(in.data + in.data_begin, in.len - in.data_begin);
+			in.period_ms = (in.fmt == input_format::text_log) ? TEXT_PERIOD_MS : RAW_PERIOD_MS;
+		}
+
+		for (size_t b = in.data_begin; b < in.len; b += RANGE_BYTES) {
+			work_range r;
+
+			r.file    = x;
+			r.begin   = b;
+			r.end     = std::min(in.len, b + RANGE_BYTES);
+			r.nr_lines = 0;
+			r.nr_bad  = 0;
+			ranges.push_back(std::move(r));
+		}
+	}
+
+	// Parse all ranges in parallel.
+	parallel_for(ranges.size(), nr_threads, [&](size_t x) {
+		work_range &r = ranges[x];
+		const input_file &in = files[r.file];
+
+		// About 55 bytes per reading in text logs
+		r.out.reserve((r.end - r.begin) / (in.fmt == input_format::text_log ? 55 :
+			      in.fmt == input_format::journal ? sizeof(sample) : PMS_FRAME_LEN) + 1);
+		if (in.fmt == input_format::text_log)
+			parse_text_range(in, r);
+		else if (in.fmt == input_format::journal)
+			parse_journal_range(in, r);
+		else
+			parse_raw_range(in, r);
+	});
+
+	for (work_range &r : ranges) {
+		std::vector<sample> &dst = files[r.file].samples;
+
+		nr_lines += r.nr_lines;
+		nr_bad   += r.nr_bad;
+		dst.insert(dst.end(), r.out.begin(), r.out.end());
+		std::vector<sample>().swap(r.out);
+	}
+
+	/*
+	 * Drop re-reads of the same frame, but only after timing each file as
+	 * a whole, as each re-read still took one TIME_DELAY.
+	 */
+	parallel_for(files.size(), nr_threads, [&](size_t x) {
+		input_file &in = files[x];
+		std::vector<sample> &v = in.samples;
+		size_t n = 0;
+
+		// Journals interleave devices, but are timestamped already.
+		if (in.fmt == input_format::journal) {
+			std::stable_sort(v.begin(), v.end(), [](const sample &a, const sample &b) {
+				return a.ts_ms != b.ts_ms ? a.ts_ms < b.ts_ms : a.device < b.device;
+			});
+		} else {
+			time_file(in);
+		}
+		for (size_t y = 0; y < v.size(); ++y) {
+			if (in.fmt == input_format::text_log && n > 0 &&
+			    (v[y].flags & SAMPLE_FLAG_CHECKED) != 0 &&
+			    (v[n-1].flags & SAMPLE_FLAG_CHECKED) != 0 &&
+			    sample_fingerprint(&v[y]) == sample_fingerprint(&v[n-1]))
+				continue;
+			v[n++] = v[y];
+		}
+		in.nr_rereads = v.size() - n;
+		v.resize(n);
+
+		in.fps.resize(n);
+		for (size_t y = 0; y < n; ++y)
+			in.fps[y] = sample_fingerprint(&v[y]);
+	});
+	for (const input_file &in : files)
+		nr_rereads += in.nr_rereads;
+
+	// Look for the head of each capture inside every other capture.
+	std::unordered_multimap<uint64_t, size_t> heads;
+	for (size_t x = 0; x < files.size(); ++x) {
+		const input_file &in = files[x];
+
+		if (in.fmt != input_format::journal && in.fps.size() >= OVERLAP_WINDOW &&
+		    window_trusted(in.fps.data(), OVERLAP_WINDOW))
+			heads.emplace(window_hash(in.fps.data(), OVERLAP_WINDOW), x);
+	}
+
+	std::vector<std::vector<overlap_hit>> hits(files.size());
+	if (!heads.empty()) {
+		uint64_t pow_k = 1;
+
+		for (size_t x = 0; x < OVERLAP_WINDOW; ++x)
+			pow_k *= WINDOW_MUL;
+
+		parallel_for(files.size(), nr_threads, [&](size_t g) {
+			const std::vector<uint64_t> &fp = files[g].fps;
+			uint64_t h;
+
+			if (files[g].fmt == input_format::journal || fp.size() < OVERLAP_WINDOW)
+				return;
+			h = window_hash(fp.data(), OVERLAP_WINDOW);
+			for (size_t pos = 0; ; ++pos) {
+				auto rng = heads.equal_range(h);
+
+				for (auto it = rng.first; it != rng.second; ++it) {
+					const input_file &f = files[it->second];
+					size_t n;
+
+					if (it->second == g || f.device != files[g].device)
+						continue;
+					n = std::min(f.fps.size(), fp.size() - pos);
+					if (std::equal(f.fps.begin(), f.fps.begin() + (long)n, fp.begin() + (long)pos))
+						hits[g].push_back({ it->second, g, pos });
+				}
+				if (pos + OVERLAP_WINDOW >= fp.size())
+					break;
+				h = h*WINDOW_MUL + fp[pos + OVERLAP_WINDOW] - fp[pos]*pow_k;
+			}
+		});
+	}
+
+	// Resolve overlaps; of identical captures, the last one listed is kept.
+	std::vector<overlap_hit> all_hits;
+	for (std::vector<overlap_hit> &v : hits)
+		all_hits.insert(all_hits.end(), v.begin(), v.end());
+	std::sort(all_hits.begin(), all_hits.end(), [](const overlap_hit &a, const overlap_hit &b) {
+		return a.file != b.file ? a.file < b.file : a.pos < b.pos;
+	});
+	for (const overlap_hit &h : all_hits) {
+		input_file &f = files[h.file];
+
+		if (f.base >= 0 || reaches(files, h.base, h.file))
+			continue;
+		f.base     = (long)h.base;
+		f.base_pos = h.pos;
+		f.overlap  = std::min(f.samples.size(), files[h.base].samples.size() - h.pos);
+	}
+	for (size_t x = 0; x < files.size(); ++x)
+		align_file(files, x);
+
+	// Merge all captures in (ts_ms, device) order.
+	archive_writer aw;
+	if (!aw.open(out_path)) {
+		std::fprintf(stderr, "pms-import: %s: %s\n", out_path, std::strerror(errno));
+		return 1;
+	}
+
+	typedef std::pair<size_t, size_t> cursor_t;	// (file, position)
+	auto later = [&](const cursor_t &a, const cursor_t &b) {
+		const sample &sa = files[a.first].samples[a.second];
+		const sample &sb = files[b.first].samples[b.second];
+
+		if (sa.ts_ms != sb.ts_ms)
+			return sa.ts_ms > sb.ts_ms;
+		if (sa.device != sb.device)
+			return sa.device > sb.device;
+		return a.first > b.first;
+	};
+	std::priority_queue<cursor_t, std::vector<cursor_t>, decltype(later)> pq(later);
+
+	for (size_t x = 0; x < files.size(); ++x) {
+		input_file &in = files[x];
+
+		nr_overlap += in.overlap;
+		if (in.overlap < in.samples.size())
+			pq.push(cursor_t(x, in.overlap));
+	}
+
+	sample last;
+	uint64_t last_fp = 0;
+	bool have_last = false;
+	while (!pq.empty()) {
+		cursor_t c = pq.top();
+		const sample &s = files[c.first].samples[c.second];
+		uint64_t fp = files[c.first].fps[c.second];
+
+		pq.pop();
+		if (c.second + 1 < files[c.first].samples.size())
+			pq.push(cursor_t(c.first, c.second + 1));
+
+		// The same capture, imported twice
+		if (have_last && s.ts_ms == last.ts_ms && s.device == last.device && fp == last_fp) {
+			++nr_overlap;
+			continue;
+		}
+		if (!aw.append(s)) {
+			std::fprintf(stderr, "pms-import: %s: %s\n", out_path, std::strerror(errno));
+			return 1;
+		}
+		last = s;
+		last_fp = fp;
+		have_last = true;
+		++nr_written;
+	}
+	if (!aw.close()) {
+		std::fprintf(stderr, "pms-import: %s: %s\n", out_path, std::strerror(errno));
+		return 1;
+	}
+
+	std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t_begin;
+	double secs = std::max(dt.count(), 1e-9);
+
+	std::fprintf(stderr,
+		"pms-import: %zu file(s), %llu lines/frames, %.1f MiB in %.3f s "
+		"(%.0f lines/s, %.1f MiB/s, %u threads)\n",
+		files.size(), (unsigned long long)nr_lines, nr_bytes / 1048576.0, secs,
+		nr_lines / secs, nr_bytes / 1048576.0 / secs, nr_threads);
+	std::fprintf(stderr,
+		"pms-import: %llu samples written, %llu re-reads and %llu overlapping "
+		"samples dropped, %llu unparseable lines\n",
+		(unsigned long long)nr_written, (unsigned long long)nr_rereads,
+		(unsigned long long)nr_overlap, (unsigned long long)nr_bad);
+	return 0;
+}
@@ -0,0 +1,1183 @@
+/**
+ * @file  host/ingest.cpp
+ * @brief pms-ingest: collect frames from many boards into one journal
+ */
+
+/*
+ * Usage: pms-ingest [-o journal] [-s baud] [-b batch] [-t flush_ms]
+ *                   [-i stats_s] [-m port] [-c coeffs] [-e events] [-r ring]
+ *                   [-R rollups] [-Q quantiles] [-f list] [device=]path[@model]...
+ *
+ * Every path (a serial port, such as a board's /dev/ttyACM*, or a pty) is
+ * opened non-blocking and multiplexed on a single epoll loop; each keeps its
+ * own framing state, so one noisy link cannot disturb another. Frames are
+ * timestamped on arrival and appended to the journal (default pms.journal)
+ * in batches: a write happens once -b samples (default 4096) are pending,
+ * or every -t milliseconds (default 1000), whichever comes first.
+ *
+ * Boards that send timestamp records (see ../stamp.h) have their frames
+ * timestamped instead by when they began by the board's own clock, mapped to
+ * wall-clock time (see clocksync.h), so that readings from different boards
+ * line up to the millisecond. Once a board has sent such a record, each of
+ * its frames is held back until its record comes in, or until it is clear
+ * that none will.
+ *
+ * Device identifiers default to the position of each path on the command
+ * line, starting at 1. With -f, further "[device] path [model]" lines are
+ * read from a file ('#' starts a comment), which is handier with hundreds of
+ * boards.
+ *
+ * Each device is decoded according to its sensor model (see model.h):
+ * pms5003 (the default), pms7003 or sds011.
+ *
+ * Endpoints that fail or hang up (e.g. a board being unplugged) are retried
+ * every two seconds. A one-line summary is printed every -i seconds
+ * (default 60, 0 to disable); SIGUSR1 prints the health of every device,
+ * as does exiting on SIGINT or SIGTERM.
+ *
+ * With -m, metrics are served in the Prometheus text format on
+ * http://127.0.0.1:<port>/metrics: latest readings (and the AQI, for boards
+ * that send it; see ../aqi.h), frame rates, checksum failures, resyncs,
+ * frames the device clamped as spikes (see ../hampel.h), the offset and
+ * drift of the board's clock, and per-read decode latency histograms, per
+ * device.
+ * Scrapes are answered from the same loop, from buffers allocated at
+ * start-up.
+ *
+ * With -c, the latest readings are also served corrected by the curves in
+ * the given coefficient file (see calibration.h), without humidity terms.
+ * The file is checked for changes on every -t tick and reloaded on the fly;
+ * the journal always holds raw readings.
+ *
+ * Every reading also goes through the pollution-event detectors of its
+ * device and channel (see detect.h). With -e, a "begin" line is appended to
+ * the given file as soon as an event is detected, and an "end" line with its
+ * start, peak and end times once it is over; events in progress and their
+ * totals are part of the metrics.
+ *
+ * With -r, every sample is also pushed, as it is journaled, into a ring of
+ * that name in shared memory (see ring.h), holding the last RING_CAPACITY
+ * samples. Any number of local consumers (e.g. pms-tap) can read it in
+ * place, instead of decoding the links again; one that falls behind loses
+ * samples, and never holds up ingestion. The ring is removed on exit.
+ *
+ * With -R, rollups of every device (see rollup.h) at 1 min, 1 h and 1 day
+ * are kept up to date as samples come in, on top of those already in the
+ * given state file, the one pms-chart -s reads and writes (created if
+ * missing). Buckets past their retention are dropped and the file is
+ * rewritten from the flush timer, every STATE_SAVE_MS or so, and on exit,
+ * so that a crash loses at most that much. A device's minute is
+ * complete once a later sample of that device came in, or once the minute is
+ * over by more than a frame may be held back; the count, mean, min and max
+ * of the last complete one are part of the metrics.
+ *
+ * Every reading is also added to quantile sketches of its device and
+ * channel (see quantile.h), kept by minute for the last hour. Whenever a
+ * minute is complete, P50/P95/P99 over the hour up to it are worked out for
+ * the metrics. With -Q, hourly sketches of the last QUANTILE_KEEP_MS are
+ * kept as well, on top of those already in the given state file, the one
+ * pms-chart -q reads and writes; it is expired and rewritten along with the
+ * rollups.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "calibration.h"
+#include "ingest.h"
+#include "journal.h"
+#include "metrics.h"
+#include "ring.h"
+
+using namespace pms;
+
+namespace {
+
+/// Delay before re-opening a failed endpoint
+constexpr int64_t REOPEN_MS = 2000;
+
+/// Largest read from one endpoint per wake-up, so that all are served fairly
+constexpr size_t READ_BYTES = 4096;
+
+/// Number of epoll events handled per wake-up
+constexpr int MAX_EVENTS = 256;
+
+/**
+ * Bytes run through all decoders of an endpoint at a time, so that frames
+ * can be paired with the timestamp records after them while only a few are
+ * pending
+ */
+constexpr size_t PIECE_BYTES = 256;
+static_assert(PIECE_BYTES / 10 + 1 <= MAX_PENDING_FRAMES,
+	      "a piece may hold more frames than can be pending");
+
+/// How long a frame may wait for its timestamp record
+constexpr int64_t STAMP_WAIT_US = 500 * 1000;
+
+/// Number of samples kept in the ring, about a minute's worth of 1000 boards
+constexpr size_t RING_CAPACITY = 64 * 1024;
+
+/// Window of the percentiles in the metrics
+constexpr int64_t PCTL_WINDOW_MS = 3600 * 1000;
+
+/// Finest rollup resolution kept, and how often state files are rewritten
+constexpr rollup_res INGEST_ROLLUP_FINEST = ROLLUP_1MIN;
+constexpr int64_t STATE_SAVE_MS = 60 * 1000;
+
+/// How long hourly quantile sketches are kept (a few MB per device)
+constexpr int64_t QUANTILE_KEEP_MS = 30 * 86400 * 1000ll;
+
+// epoll tokens for the non-endpoint descriptors
+constexpr uint64_t TOKEN_SIGNAL  = UINT64_MAX;
+constexpr uint64_t TOKEN_TIMER   = UINT64_MAX - 1;
+constexpr uint64_t TOKEN_METRICS = UINT64_MAX - 64;
+
+const char *const pm_names[PMS_NR_PM] = { "pm1_0", "pm2_5", "pm10" };
+
+/// Percentiles in the metrics, and their labels
+const double pctl_q[3] = { 0.50, 0.95, 0.99 };
+const char *const pctl_names[3] = { "0.5", "0.95", "0.99" };
+const char *const bin_names[PMS_NR_BINS] = { "0.3", "0.5", "1.0", "2.5", "5.0", "10" };
+
+/// Per-device counters in the metrics, in the order render() lists them
+const struct {
+	const char *name;
+	const char *help;
+} counters[] = {
+	{ "pms_frames_total",            "Valid frames decoded." },
+	{ "pms_checksum_failures_total", "Candidate frames failing validation." },
+	{ "pms_resyncs_total",           "Times lock was regained after discarding bytes." },
+	{ "pms_skipped_bytes_total",     "Bytes not part of any valid frame." },
+	{ "pms_bytes_total",             "Bytes read." },
+	{ "pms_opens_total",             "Times the endpoint was opened." },
+	{ "pms_errors_total",            "Open or read errors, including hang-ups." },
+	{ "pms_clamped_frames_total",    "Frames whose spikes were clamped by the device." },
+	{ "pms_stamped_frames_total",    "Frames timestamped by the board's clock." },
+	{ "pms_unmatched_stamps_total",  "Timestamp records that followed no frame." },
+	{ "pms_clock_resets_total",      "Times the clock mapping started over." },
+};
+constexpr size_t NR_COUNTERS = sizeof(counters) / sizeof(counters[0]);
+
+/// Per-device gauge series in the metrics, at most (see render())
+constexpr size_t METRICS_DEVICE_GAUGES =
+	1 +			// pms_up
+	2 * PMS_NR_PM * 2 +	// pms_pm_ugm3 and pms_pm_corrected_ugm3, atm and cf1
+	3 * PMS_NR_PM + 1 +	// pms_pm_minute_ugm3, pms_minute_samples
+	3 * PMS_NR_PM +		// pms_pm_hour_quantile_ugm3
+	PMS_NR_BINS +		// pms_particles_per_dl
+	2 +			// pms_aqi, pms_aqi_category
+	2 * PMS_NR_PM +		// pms_pm_event_active, pms_pm_events_total
+	5;			// Frame age and rate, clock offset, drift and delay
+
+/**
+ * Most series rendered for one device: its gauges, counters and decode
+ * latency histogram (one per bucket, then +Inf, the sum and the count); and
+ * the longest line of any
+ */
+constexpr size_t METRICS_DEVICE_SERIES =
+	METRICS_DEVICE_GAUGES + NR_COUNTERS + LATENCY_NR_BUCKETS + 3;
+constexpr size_t METRICS_LINE_MAX = 192;
+
+/// Room for the HELP and TYPE lines, and for the global series
+constexpr size_t METRICS_GLOBAL_BYTES = 8192;
+
+// Pick the decoder for a model, by name
+bool set_model(endpoint *ep, const char *name)
+{
+	if (std::strcmp(name, model::pms5003::name) == 0) {
+		ep->decoder.emplace<0>();
+		ep->model = model::pms5003::name;
+	} else if (std::strcmp(name, model::pms7003::name) == 0) {
+		ep->decoder.emplace<1>();
+		ep->model = model::pms7003::name;
+	} else if (std::strcmp(name, model::sds011::name) == 0) {
+		ep->decoder.emplace<2>();
+		ep->model = model::sds011::name;
+	} else {
+		errno = EINVAL;
+		return false;
+	}
+	return true;
+}
+
+int64_t clock_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct baud_rate {
+	unsigned long bps;
+	speed_t code;
+};
+
+const baud_rate baud_rates[] = {
+	{ 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+	{ 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+};
+
+int64_t clock_ms(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int64_t clock_us(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+class ingester {
+public:
+	ingester(journal_writer &jw, calibration_file *cal, std::FILE *events, sample_ring *ring,
+		 rollup_engine *rollups, const char *rollup_path, quantile_store *quantiles,
+		 const char *quantile_path, speed_t speed, int64_t flush_ms)
+		: jw_(jw), cal_(cal), events_(events), ring_(ring), rollups_(rollups),
+		  rollup_path_(rollup_path), quantiles_(quantiles),
+		  quantile_path_(quantile_path), speed_(speed), flush_ms_(flush_ms)
+	{
+	}
+
+	bool add(uint32_t device, const char *path, const char *model);
+	bool run(int64_t stats_ms, int metrics_port);
+	void print_health(std::FILE *fp) const;
+	bool save_state();
+
+private:
+	void open_endpoint(size_t idx);
+	void close_endpoint(size_t idx, int err);
+	void read_endpoint(size_t idx);
+	void decode(endpoint &ep, const uint8_t *p, size_t len, int64_t now_us);
+	void match_stamp(endpoint &ep, uint64_t dev_us, uint64_t start);
+	void settle(endpoint &ep, size_t n);
+	void append(endpoint &ep, const sample &f, int64_t ts_ms);
+	void tick();
+	void refresh_calibration();
+	void detect(endpoint &ep, const sample &s);
+	void close_minute(endpoint &ep, int64_t frontier);
+	void print_summary(double secs);
+	void render(metrics_text &t);
+
+	journal_writer &jw_;
+	calibration_file *cal_;
+	int cal_errno_ = 0;
+	std::FILE *events_;
+	sample_ring *ring_;
+	rollup_engine *rollups_;
+	const char *rollup_path_;
+	quantile_store *quantiles_;
+	const char *quantile_path_;
+	speed_t speed_;
+	int64_t flush_ms_;
+	int epfd_ = -1;
+	std::vector<std::unique_ptr<endpoint>> eps_;
+	metrics_server metrics_;
+	int64_t last_tick_ms_ = 0;
+	int64_t saved_ms_ = 0;
+	bool save_failed_ = false;
+
+	// Latest samples of all devices, corrected at each scrape
+	std::vector<sample> corrected_;
+
+	// Rows of a rollup query, kept to reuse their storage
+	std::vector<rollup_row> rows_;
+
+	// Counters since the last summary
+	uint64_t nr_frames_ = 0;
+	uint64_t nr_bytes_ = 0;
+
+	// errno of a failed journal write, if any
+	int failed_ = 0;
+};
+
+bool ingester::add(uint32_t device, const char *path, const char *model)
+{
+	std::unique_ptr<endpoint> ep(new endpoint);
+
+	for (const std::unique_ptr<endpoint> &other : eps_) {
+		if (other->device == device || other->path == path) {
+			errno = EEXIST;
+			return false;
+		}
+	}
+	if (!set_model(ep.get(), model))
+		return false;
+	ep->device = device;
+	ep->path   = path;
+	for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+		ep->detect[ch] = event_detector(device, ch, detect_defaults(ch));
+	std::snprintf(ep->labels, sizeof(ep->labels), "device=\"%u\",model=\"%s\"",
+		      device, ep->model);
+	eps_.push_back(std::move(ep));
+	return true;
+}
+
+void ingester::open_endpoint(size_t idx)
+{
+	endpoint &ep = *eps_[idx];
+	struct epoll_event ev;
+	struct termios tio;
+
+	ep.fd = open(ep.path.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (ep.fd < 0) {
+		close_endpoint(idx, errno);
+		return;
+	}
+
+	// Serial ports and ptys alike: raw bytes, no echo, no line discipline.
+	if (isatty(ep.fd) && tcgetattr(ep.fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tio.c_cc[VMIN]  = 1;
+		tio.c_cc[VTIME] = 0;
+		cfsetispeed(&tio, speed_);
+		cfsetospeed(&tio, speed_);
+		tcsetattr(ep.fd, TCSANOW, &tio);
+		tcflush(ep.fd, TCIFLUSH);
+	}
+
+	ev.events   = EPOLLIN;
+	ev.data.u64 = idx;
+	if (epoll_ctl(epfd_, EPOLL_CTL_ADD, ep.fd, &ev) != 0) {
+		close_endpoint(idx, errno);
+		return;
+	}
+	std::visit([](auto &d) { d.reset(); }, ep.decoder);
+	ep.aqi_decoder.reset();
+	ep.stamp_decoder.reset();
+	ep.first_end = 0;
+	ep.health.connected = true;
+	++ep.health.nr_opens;
+}
+
+void ingester::close_endpoint(size_t idx, int err)
+{
+	endpoint &ep = *eps_[idx];
+
+	// Only report the first of a series of failures.
+	if (ep.health.connected || ep.health.nr_errors == 0)
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", ep.path.c_str(),
+			     err != 0 ? std::strerror(err) : "hang-up");
+	if (ep.fd >= 0) {
+		epoll_ctl(epfd_, EPOLL_CTL_DEL, ep.fd, nullptr);
+		close(ep.fd);
+		ep.fd = -1;
+	}
+	settle(ep, ep.nr_pending);
+	ep.health.connected = false;
+	++ep.health.nr_errors;
+	ep.retry_ms = clock_ms(CLOCK_MONOTONIC) + REOPEN_MS;
+}
+
+void ingester::read_endpoint(size_t idx)
+{
+	static uint8_t buf[READ_BYTES];
+	endpoint &ep = *eps_[idx];
+	ssize_t n = read(ep.fd, buf, sizeof(buf));
+	int64_t now_us;
+
+	if (n <= 0) {
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+		close_endpoint(idx, n < 0 ? errno : 0);
+		return;
+	}
+	nr_bytes_ += (uint64_t)n;
+	ep.health.nr_bytes += (uint64_t)n;
+	++ep.health.nr_reads;
+
+	now_us = clock_us(CLOCK_REALTIME);
+	const int64_t t0 = clock_ns();
+	for (size_t pos = 0; pos < (size_t)n; pos += PIECE_BYTES)
+		decode(ep, buf + pos, std::min((size_t)n - pos, PIECE_BYTES), now_us);
+	ep.health.decode_latency.add((uint64_t)(clock_ns() - t0));
+}
+
+// Run bytes through all decoders of an endpoint, pairing frames and timestamp records
+void ingester::decode(endpoint &ep, const uint8_t *p, size_t len, int64_t now_us)
+{
+	std::visit([&](auto &d) {
+		d.feed(p, len, [&](const sample &f, uint64_t end) {
+			if (ep.first_end == 0)
+				ep.first_end = end;
+			if (!ep.stamped) {
+				append(ep, f, now_us / 1000);
+				return;
+			}
+			if (ep.nr_pending == MAX_PENDING_FRAMES)
+				settle(ep, 1);
+
+			pending_frame &pf = ep.pending[ep.nr_pending++];
+
+			pf.s = f;
+			pf.arrival_us = now_us;
+			pf.end = end;
+		});
+	}, ep.decoder);
+	ep.aqi_decoder.feed(p, len, [&](const aqi_t &a) {
+		ep.health.aqi = a;
+		ep.health.has_aqi = true;
+		if ((a.flags & AQI_FLAG_CLAMPED) != 0)
+			++ep.health.nr_clamped;
+	});
+	ep.stamp_decoder.feed(p, len, [&](uint64_t dev_us, uint64_t end) {
+		match_stamp(ep, dev_us, end - STAMP_RECORD_LEN);
+	});
+
+	// Frames followed by another one, or too far behind, get no record.
+	if (ep.nr_pending > 1)
+		settle(ep, ep.nr_pending - 1);
+	if (ep.nr_pending == 1 && ep.stamp_decoder.position() >=
+	    ep.pending[0].end + STAMP_RECORD_MAX_LAG + STAMP_RECORD_LEN)
+		settle(ep, 1);
+}
+
+// Timestamp the frame a record starting at a stream position refers to
+void ingester::match_stamp(endpoint &ep, uint64_t dev_us, uint64_t start)
+{
+	const bool was_stamped = ep.stamped;
+	size_t x = ep.nr_pending;
+
+	ep.stamped = true;
+	while (x > 0 && ep.pending[x - 1].end > start)
+		--x;
+	if (x == 0 || start - ep.pending[x - 1].end > STAMP_RECORD_MAX_LAG) {
+		/*
+		 * Not counted: the first record of all, whose frame was written
+		 * before records were known to come, and those before the first
+		 * whole frame since opening, whose frames were cut off by it.
+		 */
+		if (was_stamped && ep.first_end != 0 && ep.first_end <= start)
+			++ep.health.nr_unmatched_stamps;
+		return;
+	}
+	settle(ep, x - 1);
+
+	sample s = ep.pending[0].s;
+
+	ep.clock.add(dev_us, ep.pending[0].arrival_us);
+	s.flags |= SAMPLE_FLAG_TS_DEVICE;
+	append(ep, s, ep.clock.map(dev_us) / 1000);
+	++ep.health.nr_stamped;
+	std::copy(ep.pending + 1, ep.pending + ep.nr_pending, ep.pending);
+	--ep.nr_pending;
+}
+
+// Write out the n oldest pending frames, timestamped on arrival
+void ingester::settle(endpoint &ep, size_t n)
+{
+	for (size_t x = 0; x < n; ++x)
+		append(ep, ep.pending[x].s, ep.pending[x].arrival_us / 1000);
+	std::copy(ep.pending + n, ep.pending + ep.nr_pending, ep.pending);
+	ep.nr_pending -= n;
+}
+
+// Record a reading, and journal it
+void ingester::append(endpoint &ep, const sample &f, int64_t ts_ms)
+{
+	sample &s = ep.health.latest;
+
+	s = f;
+	// Keep each device's timestamps strictly increasing.
+	s.ts_ms  = std::max(ts_ms, ep.health.last_frame_ms + 1);
+	s.device = ep.device;
+	ep.health.last_frame_ms = s.ts_ms;
+	++nr_frames_;
+	if (!jw_.append(s) && failed_ == 0)
+		failed_ = errno;
+	if (ring_ != nullptr)
+		ring_->push(s);
+	detect(ep, s);
+
+	close_minute(ep, s.ts_ms);
+	ep.minute_ms = rollup_bucket_start(s.ts_ms, rollup_width_ms[ROLLUP_1MIN]);
+	ep.quantiles.add(s);
+	if (rollups_ != nullptr)
+		rollups_->add(s);
+	if (quantiles_ != nullptr)
+		quantiles_->add(s);
+}
+
+/*
+ * Close the minute being filled if it ends at or before frontier, past which
+ * no sample of the device is expected any more: keep its rollup, and work
+ * out the percentiles over the hour up to it
+ */
+void ingester::close_minute(endpoint &ep, int64_t frontier)
+{
+	const int64_t end = ep.minute_ms + rollup_width_ms[ROLLUP_1MIN];
+
+	if (ep.minute_ms == 0 || end > frontier)
+		return;
+	rows_.clear();
+	if (rollups_ != nullptr &&
+	    rollups_->query(&rows_, ROLLUP_1MIN, ep.device, ep.minute_ms, ep.minute_ms + 1) > 0)
+		ep.last_minute = rows_.front();
+
+	ep.quantiles.expire(end - PCTL_WINDOW_MS);
+	for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+		ep.quantiles.window(ep.device, ch, end - PCTL_WINDOW_MS, end)
+			.quantiles(pctl_q, ep.pctl[ch], 3);
+	ep.has_pctl = true;
+	ep.minute_ms = 0;
+}
+
+// Run a reading through the event detectors, and log what they see
+void ingester::detect(endpoint &ep, const sample &s)
+{
+	for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+		event_detector &d = ep.detect[ch];
+		const unsigned int r = d.add(s.ts_ms, s.pm_atm[ch]);
+
+		if (events_ == nullptr || r == 0)
+			continue;
+		detect_print(events_, d.event(), r == DETECT_BEGIN);
+		if (std::fflush(events_) != 0 && failed_ == 0)
+			failed_ = errno;
+	}
+}
+
+void ingester::tick()
+{
+	const int64_t now = clock_ms(CLOCK_MONOTONIC);
+	const int64_t now_us = clock_us(CLOCK_REALTIME);
+	const double secs = (double)(now - last_tick_ms_) / 1000.0;
+
+	for (size_t x = 0; x < eps_.size(); ++x) {
+		endpoint &ep = *eps_[x];
+		const uint64_t nr_frames = ep.stats().nr_frames;
+
+		// The link went quiet right after a frame; its record is not coming.
+		if (ep.nr_pending > 0 && now_us - ep.pending[0].arrival_us >= STAMP_WAIT_US)
+			settle(ep, ep.nr_pending);
+		close_minute(ep, (now_us - STAMP_WAIT_US) / 1000);
+
+		if (ep.fd < 0 && now >= ep.retry_ms)
+			open_endpoint(x);
+		if (secs > 0.0)
+			ep.health.frame_rate = (double)(nr_frames - ep.health.frames_at_tick) / secs;
+		ep.health.frames_at_tick = nr_frames;
+	}
+	last_tick_ms_ = now;
+	if (!jw_.flush() && failed_ == 0)
+		failed_ = errno;
+	if (cal_ != nullptr)
+		refresh_calibration();
+
+	// State files are not worth losing ingestion over; keep trying.
+	if (now - saved_ms_ >= STATE_SAVE_MS) {
+		const bool ok = save_state();
+
+		saved_ms_ = now;
+		save_failed_ = !ok;
+	}
+}
+
+/*
+ * Drop expired rollups and sketches, and rewrite the state files; only the
+ * first of a series of failures is reported
+ */
+bool ingester::save_state()
+{
+	const char *failed = nullptr;
+	int err = 0;
+
+	if (rollups_ != nullptr) {
+		rollups_->expire();
+		if (!rollups_->save(rollup_path_)) {
+			failed = rollup_path_;
+			err = errno;
+		}
+	}
+	if (quantiles_ != nullptr) {
+		quantiles_->expire(clock_ms(CLOCK_REALTIME) - QUANTILE_KEEP_MS);
+		if (!quantiles_->save(quantile_path_) && failed == nullptr) {
+			failed = quantile_path_;
+			err = errno;
+		}
+	}
+	if (failed != nullptr && !save_failed_)
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", failed, std::strerror(err));
+	return failed == nullptr;
+}
+
+// Pick up edits to the coefficient file
+void ingester::refresh_calibration()
+{
+	size_t bad_line;
+
+	if (cal_->refresh(&bad_line)) {
+		std::fprintf(stderr, "pms-ingest: %s: reloaded, %zu curves\n",
+			     cal_->path().c_str(), cal_->get()->nr_curves());
+		cal_errno_ = 0;
+	} else if (bad_line != 0) {
+		std::fprintf(stderr, "pms-ingest: %s:%zu: malformed curve, keeping the previous ones\n",
+			     cal_->path().c_str(), bad_line);
+	} else if (errno != 0 && errno != cal_errno_) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", cal_->path().c_str(), std::strerror(errno));
+		cal_errno_ = errno;
+	}
+}
+
+void ingester::print_summary(double secs)
+{
+	size_t nr_up = 0;
+
+	for (const std::unique_ptr<endpoint> &ep : eps_)
+		nr_up += ep->health.connected ? 1 : 0;
+	std::fprintf(stderr, "pms-ingest: %zu/%zu devices up, %.1f frames/s, %.1f KiB/s, "
+		     "%llu samples in %llu writes\n",
+		     nr_up, eps_.size(), (double)nr_frames_ / secs,
+		     (double)nr_bytes_ / secs / 1024.0,
+		     (unsigned long long)jw_.nr_written(), (unsigned long long)jw_.nr_writes());
+	nr_frames_ = 0;
+	nr_bytes_  = 0;
+}
+
+// Render all metrics, grouped by metric name as the text format requires
+void ingester::render(metrics_text &t)
+{
+	const int64_t now = clock_ms(CLOCK_REALTIME);
+
+	t.add("# HELP pms_up Whether the device's endpoint is open.\n"
+	      "# TYPE pms_up gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_)
+		t.add("pms_up{%s} %d\n", ep->labels, ep->health.connected ? 1 : 0);
+
+	t.add("# HELP pms_pm_ugm3 Latest mass concentration.\n"
+	      "# TYPE pms_pm_ugm3 gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		const sample &s = ep->health.latest;
+
+		if (ep->health.last_frame_ms == 0)
+			continue;
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+			t.add("pms_pm_ugm3{%s,channel=\"%s\",kind=\"atm\"} %u\n",
+			      ep->labels, pm_names[ch], s.pm_atm[ch]);
+			if ((s.flags & SAMPLE_FLAG_CF1) != 0)
+				t.add("pms_pm_ugm3{%s,channel=\"%s\",kind=\"cf1\"} %u\n",
+				      ep->labels, pm_names[ch], s.pm_cf1[ch]);
+		}
+	}
+
+	if (cal_ != nullptr) {
+		corrected_.clear();
+		for (const std::unique_ptr<endpoint> &ep : eps_) {
+			if (ep->health.last_frame_ms != 0)
+				corrected_.push_back(ep->health.latest);
+		}
+		cal_->get()->apply(corrected_.data(), corrected_.size(), nullptr);
+
+		t.add("# HELP pms_pm_corrected_ugm3 Latest mass concentration, after calibration.\n"
+		      "# TYPE pms_pm_corrected_ugm3 gauge\n");
+		for (size_t x = 0, y = 0; x < eps_.size(); ++x) {
+			if (eps_[x]->health.last_frame_ms == 0)
+				continue;
+
+			const sample &s = corrected_[y++];
+			if ((s.flags & SAMPLE_FLAG_CALIBRATED) == 0)
+				continue;
+			for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+				t.add("pms_pm_corrected_ugm3{%s,channel=\"%s\",kind=\"atm\"} %u\n",
+				      eps_[x]->labels, pm_names[ch], s.pm_atm[ch]);
+				if ((s.flags & SAMPLE_FLAG_CF1) != 0)
+					t.add("pms_pm_corrected_ugm3{%s,channel=\"%s\",kind=\"cf1\"} %u\n",
+					      eps_[x]->labels, pm_names[ch], s.pm_cf1[ch]);
+			}
+		}
+	}
+
+	t.add("# HELP pms_pm_minute_ugm3 Mass concentration over the last complete minute.\n"
+	      "# TYPE pms_pm_minute_ugm3 gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		const rollup_row &r = ep->last_minute;
+
+		if (r.count == 0)
+			continue;
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			t.add("pms_pm_minute_ugm3{%s,channel=\"%s\",stat=\"mean\"} %.2f\n"
+			      "pms_pm_minute_ugm3{%s,channel=\"%s\",stat=\"min\"} %u\n"
+			      "pms_pm_minute_ugm3{%s,channel=\"%s\",stat=\"max\"} %u\n",
+			      ep->labels, pm_names[ch], r.mean(ch), ep->labels, pm_names[ch], r.min[ch],
+			      ep->labels, pm_names[ch], r.max[ch]);
+	}
+
+	t.add("# HELP pms_minute_samples Samples in the last complete minute.\n"
+	      "# TYPE pms_minute_samples gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->last_minute.count != 0)
+			t.add("pms_minute_samples{%s} %llu\n", ep->labels,
+			      (unsigned long long)ep->last_minute.count);
+	}
+
+	t.add("# HELP pms_pm_hour_quantile_ugm3 Mass concentration percentiles over the hour "
+	      "up to the last complete minute.\n"
+	      "# TYPE pms_pm_hour_quantile_ugm3 gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (!ep->has_pctl)
+			continue;
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch) {
+			for (unsigned int q = 0; q < 3; ++q)
+				t.add("pms_pm_hour_quantile_ugm3{%s,channel=\"%s\",quantile=\"%s\"} %.0f\n",
+				      ep->labels, pm_names[ch], pctl_names[q], ep->pctl[ch][q]);
+		}
+	}
+
+	t.add("# HELP pms_particles_per_dl Latest particle counts per 0.1L, beyond each size (um).\n"
+	      "# TYPE pms_particles_per_dl gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if ((ep->health.latest.flags & SAMPLE_FLAG_COUNTS) == 0)
+			continue;
+		for (unsigned int b = 0; b < PMS_NR_BINS; ++b)
+			t.add("pms_particles_per_dl{%s,size=\"%s\"} %u\n",
+			      ep->labels, bin_names[b], ep->health.latest.nr_particles[b]);
+	}
+
+	t.add("# HELP pms_aqi Latest US-EPA AQI, as computed by the device.\n"
+	      "# TYPE pms_aqi gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->health.has_aqi)
+			t.add("pms_aqi{%s,dominant=\"%s\"} %u\n", ep->labels,
+			      pm_names[ep->health.aqi.dominant], ep->health.aqi.aqi);
+	}
+
+	t.add("# HELP pms_aqi_category Latest AQI category (0: good .. 5: hazardous).\n"
+	      "# TYPE pms_aqi_category gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->health.has_aqi)
+			t.add("pms_aqi_category{%s} %u\n", ep->labels, ep->health.aqi.category);
+	}
+
+	t.add("# HELP pms_pm_event_active Whether a pollution event is going on.\n"
+	      "# TYPE pms_pm_event_active gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			t.add("pms_pm_event_active{%s,channel=\"%s\"} %d\n",
+			      ep->labels, pm_names[ch], ep->detect[ch].active() ? 1 : 0);
+	}
+
+	t.add("# HELP pms_pm_events_total Pollution events detected.\n"
+	      "# TYPE pms_pm_events_total counter\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			t.add("pms_pm_events_total{%s,channel=\"%s\"} %llu\n", ep->labels, pm_names[ch],
+			      (unsigned long long)ep->detect[ch].nr_events());
+	}
+
+	t.add("# HELP pms_last_frame_age_seconds Time since the last valid frame.\n"
+	      "# TYPE pms_last_frame_age_seconds gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->health.last_frame_ms != 0)
+			t.add("pms_last_frame_age_seconds{%s} %.3f\n", ep->labels,
+			      (double)(now - ep->health.last_frame_ms) / 1000.0);
+	}
+
+	t.add("# HELP pms_clock_offset_seconds Wall-clock time minus the board's clock.\n"
+	      "# TYPE pms_clock_offset_seconds gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->clock.valid())
+			t.add("pms_clock_offset_seconds{%s} %.6f\n", ep->labels,
+			      (double)ep->clock.offset_us() * 1e-6);
+	}
+
+	t.add("# HELP pms_clock_drift_ppm How much slower the board's clock runs than the wall clock.\n"
+	      "# TYPE pms_clock_drift_ppm gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->clock.valid())
+			t.add("pms_clock_drift_ppm{%s} %.3f\n", ep->labels, ep->clock.drift() * 1e6);
+	}
+
+	t.add("# HELP pms_clock_delay_seconds How late the latest timestamped frame arrived.\n"
+	      "# TYPE pms_clock_delay_seconds gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		if (ep->clock.valid())
+			t.add("pms_clock_delay_seconds{%s} %.6f\n", ep->labels,
+			      ep->clock.delay_us() * 1e-6);
+	}
+
+	t.add("# HELP pms_frame_rate_hz Valid frames per second, over the last timer period.\n"
+	      "# TYPE pms_frame_rate_hz gauge\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_)
+		t.add("pms_frame_rate_hz{%s} %.3f\n", ep->labels, ep->health.frame_rate);
+
+	// Counters
+	for (size_t c = 0; c < NR_COUNTERS; ++c) {
+		t.add("# HELP %s %s\n# TYPE %s counter\n",
+		      counters[c].name, counters[c].help, counters[c].name);
+		for (const std::unique_ptr<endpoint> &ep : eps_) {
+			const decode_stats &st = ep->stats();
+			const device_health &h = ep->health;
+			const uint64_t v[] = {
+				st.nr_frames, st.nr_rejected, st.nr_resyncs, st.nr_skipped,
+				h.nr_bytes, h.nr_opens, h.nr_errors, h.nr_clamped,
+				h.nr_stamped, h.nr_unmatched_stamps, ep->clock.nr_resets(),
+			};
+			static_assert(sizeof(v) / sizeof(v[0]) == NR_COUNTERS,
+				      "a value per counter");
+
+			t.add("%s{%s} %llu\n", counters[c].name, ep->labels, (unsigned long long)v[c]);
+		}
+	}
+
+	t.add("# HELP pms_decode_latency_seconds Time spent decoding each read.\n"
+	      "# TYPE pms_decode_latency_seconds histogram\n");
+	for (const std::unique_ptr<endpoint> &ep : eps_)
+		t.histogram("pms_decode_latency_seconds", ep->labels, ep->health.decode_latency);
+
+	t.add("# HELP pms_journal_samples_total Samples written to the journal.\n"
+	      "# TYPE pms_journal_samples_total counter\n"
+	      "pms_journal_samples_total %llu\n"
+	      "# HELP pms_journal_writes_total Batched writes to the journal.\n"
+	      "# TYPE pms_journal_writes_total counter\n"
+	      "pms_journal_writes_total %llu\n"
+	      "# HELP pms_scrapes_total Metrics scrapes answered before this one.\n"
+	      "# TYPE pms_scrapes_total counter\n"
+	      "pms_scrapes_total %llu\n"
+	      "# HELP pms_scrape_render_seconds_total Time spent rendering metrics.\n"
+	      "# TYPE pms_scrape_render_seconds_total counter\n"
+	      "pms_scrape_render_seconds_total %.6f\n"
+	      "# HELP pms_scrape_truncations_total Scrapes refused as the metrics did not fit.\n"
+	      "# TYPE pms_scrape_truncations_total counter\n"
+	      "pms_scrape_truncations_total %llu\n",
+	      (unsigned long long)jw_.nr_written(), (unsigned long long)jw_.nr_writes(),
+	      (unsigned long long)metrics_.nr_scrapes(), (double)metrics_.render_ns() * 1e-9,
+	      (unsigned long long)metrics_.nr_truncated());
+}
+
+void ingester::print_health(std::FILE *fp) const
+{
+	const int64_t now = clock_ms(CLOCK_REALTIME);
+
+	std::fprintf(fp, "%8s %-7s %-4s %10s %9s %8s %8s %9s %6s %6s %8s  %s\n",
+		     "device", "model", "up", "bytes", "frames", "rejected", "resyncs",
+		     "skipped", "opens", "errors", "age(s)", "path");
+	for (const std::unique_ptr<endpoint> &ep : eps_) {
+		const device_health &h = ep->health;
+		const decode_stats &st = ep->stats();
+
+		std::fprintf(fp, "%8u %-7s %-4s %10llu %9llu %8llu %8llu %9llu %6llu %6llu ",
+			     ep->device, ep->model, h.connected ? "yes" : "no",
+			     (unsigned long long)h.nr_bytes, (unsigned long long)st.nr_frames,
+			     (unsigned long long)st.nr_rejected, (unsigned long long)st.nr_resyncs,
+			     (unsigned long long)st.nr_skipped, (unsigned long long)h.nr_opens,
+			     (unsigned long long)h.nr_errors);
+		if (h.last_frame_ms != 0)
+			std::fprintf(fp, "%8.1f", (double)(now - h.last_frame_ms) / 1000.0);
+		else
+			std::fprintf(fp, "%8s", "-");
+		std::fprintf(fp, "  %s\n", ep->path.c_str());
+	}
+}
+
+bool ingester::run(int64_t stats_ms, int metrics_port)
+{
+	struct epoll_event evs[MAX_EVENTS];
+	struct epoll_event ev;
+	struct itimerspec its;
+	sigset_t mask;
+	int sfd, tfd;
+	int64_t last_stats = clock_ms(CLOCK_MONOTONIC);
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGUSR1);
+	sigprocmask(SIG_BLOCK, &mask, nullptr);
+
+	epfd_ = epoll_create1(EPOLL_CLOEXEC);
+	sfd   = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	tfd   = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (epfd_ < 0 || sfd < 0 || tfd < 0)
+		return false;
+
+	// One timer drives re-opening, journal flushes and statistics.
+	its.it_value.tv_sec  = flush_ms_ / 1000;
+	its.it_value.tv_nsec = (flush_ms_ % 1000) * 1000000;
+	its.it_interval = its.it_value;
+	ev.events = EPOLLIN;
+	ev.data.u64 = TOKEN_SIGNAL;
+	if (epoll_ctl(epfd_, EPOLL_CTL_ADD, sfd, &ev) != 0)
+		return false;
+	ev.data.u64 = TOKEN_TIMER;
+	if (timerfd_settime(tfd, 0, &its, nullptr) != 0 ||
+	    epoll_ctl(epfd_, EPOLL_CTL_ADD, tfd, &ev) != 0)
+		return false;
+
+	if (metrics_port > 0 &&
+	    !metrics_.open(epfd_, (uint16_t)metrics_port, TOKEN_METRICS,
+			   METRICS_GLOBAL_BYTES +
+			   eps_.size() * METRICS_DEVICE_SERIES * METRICS_LINE_MAX,
+			   [this](metrics_text &t) { render(t); }))
+		return false;
+	corrected_.reserve(eps_.size());
+	rows_.reserve(1);
+
+	last_tick_ms_ = clock_ms(CLOCK_MONOTONIC);
+	saved_ms_ = last_tick_ms_;
+	for (size_t x = 0; x < eps_.size(); ++x)
+		open_endpoint(x);
+
+	while (failed_ == 0) {
+		int n = epoll_wait(epfd_, evs, MAX_EVENTS, -1);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		for (int x = 0; x < n; ++x) {
+			const uint64_t tok = evs[x].data.u64;
+
+			if (tok == TOKEN_TIMER) {
+				uint64_t expirations;
+				int64_t now;
+
+				if (read(tfd, &expirations, sizeof(expirations)) < 0)
+					continue;
+				tick();
+				now = clock_ms(CLOCK_MONOTONIC);
+				if (stats_ms > 0 && now - last_stats >= stats_ms) {
+					print_summary((double)(now - last_stats) / 1000.0);
+					last_stats = now;
+				}
+			} else if (tok == TOKEN_SIGNAL) {
+				struct signalfd_siginfo si;
+
+				if (read(sfd, &si, sizeof(si)) != (ssize_t)sizeof(si))
+					continue;
+				if (si.ssi_signo == SIGUSR1) {
+					print_health(stderr);
+					continue;
+				}
+				close(sfd);
+				close(tfd);
+				return true;
+			} else if (metrics_.owns(tok)) {
+				metrics_.handle(tok, evs[x].events);
+			} else if (eps_[tok]->fd >= 0) {
+				// Errors and hang-ups surface through read() as well.
+				read_endpoint((size_t)tok);
+			}
+		}
+	}
+	errno = failed_;
+	return false;
+}
+
+/// One endpoint as given on the command line or in a list
+struct endpoint_spec {
+	long device;
+	std::string path;
+	std::string model;
+};
+
+// Read "[device] path [model]" lines
+bool read_list(const char *list, std::vector<endpoint_spec> *out)
+{
+	std::FILE *fp = std::fopen(list, "r");
+	char line[PATH_MAX + 32];
+
+	if (fp == nullptr)
+		return false;
+	while (std::fgets(line, sizeof(line), fp) != nullptr) {
+		char *p = line, *end;
+		long device = -1;
+
+		line[std::strcspn(line, "#\r\n")] = '\0';
+		while (*p == ' ' || *p == '\t')
+			++p;
+		if (*p == '\0')
+			continue;
+		if (*p >= '0' && *p <= '9') {
+			device = std::strtol(p, &end, 0);
+			if (*end == ' ' || *end == '\t')
+				p = end;
+			else
+				device = -1;
+			while (*p == ' ' || *p == '\t')
+				++p;
+		}
+		end = p + std::strcspn(p, " \t");
+		if (*end != '\0') {
+			*end++ = '\0';
+			while (*end == ' ' || *end == '\t')
+				++end;
+			end[std::strcspn(end, " \t")] = '\0';
+		}
+		out->push_back({device, p, *end != '\0' ? end : model::pms5003::name});
+	}
+	std::fclose(fp);
+	return true;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr,
+		"usage: pms-ingest [-o journal] [-s baud] [-b batch] [-t flush_ms] "
+		"[-i stats_s] [-m port] [-c coeffs] [-e events] [-r ring] [-R rollups] "
+		"[-Q quantiles] [-f list] [device=]path[@model]...\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	const char *out_path = "pms.journal";
+	unsigned long bps = 9600;
+	size_t batch = 4096;
+	int64_t flush_ms = 1000, stats_ms = 60 * 1000;
+	int metrics_port = 0;
+	std::vector<endpoint_spec> paths;
+	speed_t speed = 0;
+	journal_writer jw;
+	calibration_file cal;
+	const char *cal_path = nullptr;
+	const char *events_path = nullptr;
+	std::FILE *events = nullptr;
+	const char *ring_name = nullptr;
+	sample_ring ring;
+	const char *rollup_path = nullptr;
+	rollup_engine rollups(INGEST_ROLLUP_FINEST);
+	const char *quantile_path = nullptr;
+	quantile_store quantiles;
+	size_t bad_line;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'o': out_path = argv[++x]; break;
+		case 's': bps = std::strtoul(argv[++x], nullptr, 0); break;
+		case 'b': batch = (size_t)std::strtoul(argv[++x], nullptr, 0); break;
+		case 't': flush_ms = std::strtoll(argv[++x], nullptr, 0); break;
+		case 'i': stats_ms = std::strtoll(argv[++x], nullptr, 0) * 1000; break;
+		case 'm': metrics_port = (int)std::strtol(argv[++x], nullptr, 0); break;
+		case 'c': cal_path = argv[++x]; break;
+		case 'e': events_path = argv[++x]; break;
+		case 'r': ring_name = argv[++x]; break;
+		case 'R': rollup_path = argv[++x]; break;
+		case 'Q': quantile_path = argv[++x]; break;
+		case 'f':
+			if (!read_list(argv[++x], &paths)) {
+				std::fprintf(stderr, "pms-ingest: %s: %s\n", argv[x], std::strerror(errno));
+				return 1;
+			}
+			break;
+		default:
+			usage();
+		}
+	}
+	for (; x < argc; ++x) {
+		const char *path = argv[x];
+		const char *eq = std::strchr(path, '=');
+		const char *at = std::strrchr(path, '@');
+		char *end;
+		long device = -1;
+
+		if (eq != nullptr) {
+			device = std::strtol(path, &end, 0);
+			if (end != eq)
+				usage();
+			path = eq + 1;
+		}
+		if (at != nullptr && at > path)
+			paths.push_back({device, std::string(path, at), at + 1});
+		else
+			paths.push_back({device, path, model::pms5003::name});
+	}
+	for (const baud_rate &b : baud_rates) {
+		if (b.bps == bps)
+			speed = b.code;
+	}
+	if (paths.empty() || speed == 0 || batch == 0 || flush_ms <= 0 ||
+	    metrics_port < 0 || metrics_port > 65535)
+		usage();
+
+	if (cal_path != nullptr && !cal.open(cal_path, &bad_line)) {
+		if (bad_line != 0)
+			std::fprintf(stderr, "pms-ingest: %s:%zu: malformed curve\n", cal_path, bad_line);
+		else
+			std::fprintf(stderr, "pms-ingest: %s: %s\n", cal_path, std::strerror(errno));
+		return 1;
+	}
+	if (events_path != nullptr && (events = std::fopen(events_path, "a")) == nullptr) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", events_path, std::strerror(errno));
+		return 1;
+	}
+	if (rollup_path != nullptr && !rollups.load(rollup_path) && errno != ENOENT) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", rollup_path, std::strerror(errno));
+		return 1;
+	}
+	if (quantile_path != nullptr && !quantiles.load(quantile_path) && errno != ENOENT) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", quantile_path, std::strerror(errno));
+		return 1;
+	}
+	if (ring_name != nullptr && !ring.create_shared(ring_name, RING_CAPACITY)) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", ring_name, std::strerror(errno));
+		return 1;
+	}
+	if (!jw.open(out_path, batch)) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", out_path, std::strerror(errno));
+		return 1;
+	}
+
+	ingester ing(jw, cal_path != nullptr ? &cal : nullptr, events,
+		     ring_name != nullptr ? &ring : nullptr,
+		     rollup_path != nullptr ? &rollups : nullptr, rollup_path,
+		     quantile_path != nullptr ? &quantiles : nullptr, quantile_path,
+		     speed, flush_ms);
+	for (size_t y = 0; y < paths.size(); ++y) {
+		const endpoint_spec &spec = paths[y];
+		const uint32_t device = spec.device >= 0 ? (uint32_t)spec.device : (uint32_t)(y + 1);
+
+		if (!ing.add(device, spec.path.c_str(), spec.model.c_str())) {
+			if (errno == EEXIST)
+				std::fprintf(stderr, "pms-ingest: %s: device %u listed twice\n",
+					     spec.path.c_str(), device);
+			else
+				std::fprintf(stderr, "pms-ingest: %s: unknown model %s\n",
+					     spec.path.c_str(), spec.model.c_str());
+			return 1;
+		}
+	}
+
+	bool ok = ing.run(stats_ms, metrics_port);
+	if (!ok)
+		std::fprintf(stderr, "pms-ingest: %s\n", std::strerror(errno));
+	ing.print_health(stderr);
+	if (!jw.close()) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", out_path, std::strerror(errno));
+		return 1;
+	}
+	if (events != nullptr && std::fclose(events) != 0) {
+		std::fprintf(stderr, "pms-ingest: %s: %s\n", events_path, std::strerror(errno));
+		return 1;
+	}
+	if (!ing.save_state())
+		return 1;
+	return ok ? 0 : 1;
+}
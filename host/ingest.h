@@ -0,0 +1,159 @@
+/**
+ * @file  host/ingest.h
+ * @brief Per-device state shared by the parts of pms-ingest
+ */
+
+#if !defined(EEE192_HOST_INGEST_H_)
+#define EEE192_HOST_INGEST_H_
+
+#include <cstdint>
+#include <string>
+#include <variant>
+
+#include "clocksync.h"
+#include "decode.h"
+#include "detect.h"
+#include "metrics.h"
+#include "model.h"
+#include "quantile.h"
+#include "rollup.h"
+#include "sample.h"
+
+namespace pms {
+
+/// Health counters of one device
+struct device_health {
+	/// Whether the endpoint is currently open
+	bool connected = false;
+
+	/// Number of bytes read
+	uint64_t nr_bytes = 0;
+
+	/// Number of read() calls that returned data
+	uint64_t nr_reads = 0;
+
+	/// Number of times the endpoint was (re-)opened
+	uint64_t nr_opens = 0;
+
+	/// Number of open or read errors, including hang-ups
+	uint64_t nr_errors = 0;
+
+	/// Wall-clock time of the last valid frame (0: none yet)
+	int64_t last_frame_ms = 0;
+
+	/// Frames per second, over the last timer period
+	double frame_rate = 0.0;
+
+	/// Frame count at the start of the current timer period
+	uint64_t frames_at_tick = 0;
+
+	/// Time spent decoding each read
+	latency_histogram decode_latency;
+
+	/// Most recent reading
+	sample latest = {};
+
+	/// Most recent AQI sent by the device, if any (see ../aqi.h)
+	aqi_t aqi = {};
+	bool has_aqi = false;
+
+	/// Number of AQI records flagged @c AQI_FLAG_CLAMPED
+	uint64_t nr_clamped = 0;
+
+	/// Number of frames timestamped by the board's clock, and of records matching none
+	uint64_t nr_stamped = 0;
+	uint64_t nr_unmatched_stamps = 0;
+};
+
+/// Most frames of one endpoint waiting for their timestamp records
+constexpr size_t MAX_PENDING_FRAMES = 32;
+
+/// A frame waiting for its timestamp record
+struct pending_frame {
+	/// Decoded reading, without its timestamp
+	sample s;
+
+	/// When it arrived, in microseconds since the Unix epoch
+	int64_t arrival_us;
+
+	/// Stream position just past it (see basic_stream_decoder::position())
+	uint64_t end;
+};
+
+/// Framing state for any of the supported sensor models
+typedef std::variant<
+	model::model_stream<model::pms5003>,
+	model::model_stream<model::pms7003>,
+	model::model_stream<model::sds011>
+> any_decoder;
+
+/// One serial port or pty being ingested
+struct endpoint {
+	/// Device identifier recorded in each sample
+	uint32_t device = 0;
+
+	/// Path to (re-)open
+	std::string path;
+
+	/// Sensor model, e.g. @c pms5003
+	const char *model = model::pms5003::name;
+
+	/// Prometheus labels identifying this device, e.g. @c device="1"
+	char labels[64];
+
+	/// Open file descriptor, or -1
+	int fd = -1;
+
+	/// Earliest time for the next open attempt (monotonic, ms)
+	int64_t retry_ms = 0;
+
+	/// Framing state, for the device's model
+	any_decoder decoder;
+
+	/// Framing state for AQI records, which may come along any model
+	aqi_stream_decoder aqi_decoder;
+
+	/// Framing state for timestamp records (see ../stamp.h), likewise
+	stamp_stream_decoder stamp_decoder;
+
+	/// Whether the board sends timestamp records, so frames wait for them
+	bool stamped = false;
+
+	/// Stream position just past the first frame since (re-)opening (0: none yet)
+	uint64_t first_end = 0;
+
+	/// Frames waiting for their timestamp records, oldest first
+	pending_frame pending[MAX_PENDING_FRAMES];
+	size_t nr_pending = 0;
+
+	/// Mapping of the board's clock to wall-clock time
+	clock_sync clock;
+
+	/// Pollution-event detectors, per PM channel (atmospheric values)
+	event_detector detect[PMS_NR_PM];
+
+	/// Sketches of the last hour or so, by minute (see quantile.h)
+	quantile_store quantiles{ rollup_width_ms[ROLLUP_1MIN] };
+
+	/// Start of the minute being filled (0: none), and the last complete one
+	int64_t minute_ms = 0;
+	rollup_row last_minute = {};
+
+	/// P50/P95/P99 per channel over the hour up to the last complete minute
+	float pctl[PMS_NR_PM][3];
+	bool has_pctl = false;
+
+	/// Health counters; stats() holds the framing ones
+	device_health health;
+
+	/// Framing counters
+	const decode_stats &stats() const
+	{
+		return std::visit([](const auto &d) -> const decode_stats & { return d.stats(); },
+				  decoder);
+	}
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_INGEST_H_)
@@ -0,0 +1,146 @@
+/**
+ * @file  host/journal.cpp
+ * @brief Append-only store of live PM samples, as written by pms-ingest
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.h"
+
+namespace pms {
+
+long long journal_nr_records(const void *p, size_t len)
+{
+	journal_header hdr;
+
+	if (len < sizeof(hdr))
+		return -1;
+	std::memcpy(&hdr, p, sizeof(hdr));
+	if (std::memcmp(hdr.magic, JOURNAL_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.version != JOURNAL_VERSION || hdr.record_size != sizeof(sample))
+		return -1;
+	return (long long)((len - sizeof(hdr)) / sizeof(sample));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+journal_writer::~journal_writer()
+{
+	if (fd_ >= 0)
+		close();
+}
+
+bool journal_writer::open(const char *path, size_t batch)
+{
+	journal_header hdr;
+	struct stat st;
+	long long n;
+
+	if (fd_ >= 0 || batch == 0) {
+		errno = EINVAL;
+		return false;
+	}
+	fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd_ < 0)
+		return false;
+	if (fstat(fd_, &st) != 0)
+		goto fail;
+
+	if (st.st_size == 0) {
+		std::memset(&hdr, 0, sizeof(hdr));
+		std::memcpy(hdr.magic, JOURNAL_MAGIC, sizeof(hdr.magic));
+		hdr.version     = JOURNAL_VERSION;
+		hdr.record_size = sizeof(sample);
+		if (pwrite(fd_, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+			goto fail;
+		n = 0;
+	} else {
+		if (pread(fd_, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+		    (n = journal_nr_records(&hdr, (size_t)st.st_size)) < 0) {
+			errno = EINVAL;
+			goto fail;
+		}
+	}
+
+	// Cut off a record left incomplete by a crash.
+	if (ftruncate(fd_, (off_t)(sizeof(hdr) + (size_t)n * sizeof(sample))) != 0 ||
+	    lseek(fd_, 0, SEEK_END) < 0)
+		goto fail;
+
+	batch_ = batch;
+	buf_.clear();
+	buf_.reserve(batch);
+	done_ = 0;
+	nr_written_ = 0;
+	nr_writes_  = 0;
+	return true;
+
+fail:
+	{
+		int e = errno;
+
+		::close(fd_);
+		fd_ = -1;
+		errno = e;
+	}
+	return false;
+}
+
+bool journal_writer::append(const sample &s)
+{
+	if (fd_ < 0)
+		return false;
+	buf_.push_back(s);
+	if (buf_.size() >= batch_)
+		return flush();
+	return true;
+}
+
+bool journal_writer::flush()
+{
+	const uint8_t *p = reinterpret_cast<const uint8_t *>(buf_.data());
+	const size_t len = buf_.size() * sizeof(sample);
+
+	if (fd_ < 0)
+		return false;
+	if (len == 0)
+		return true;
+
+	// After a failed write, carry on exactly where it stopped.
+	while (done_ < len) {
+		ssize_t n = write(fd_, p + done_, len - done_);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		done_ += (size_t)n;
+	}
+	++nr_writes_;
+	nr_written_ += buf_.size();
+	buf_.clear();
+	done_ = 0;
+	return true;
+}
+
+bool journal_writer::close()
+{
+	bool ok;
+
+	if (fd_ < 0)
+		return false;
+	ok = flush();
+	if (::close(fd_) != 0)
+		ok = false;
+	fd_ = -1;
+	return ok;
+}
+
+}	// namespace pms
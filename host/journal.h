@@ -0,0 +1,117 @@
+/**
+ * @file  host/journal.h
+ * @brief Append-only store of live PM samples, as written by pms-ingest
+ */
+
+/*
+ * File layout (native byte order, like archives):
+ *
+ *   +----------------------+  offset 0
+ *   | journal_header       |
+ *   +----------------------+  offset sizeof(journal_header)
+ *   | sample[...]          |  in arrival order; each device's samples are
+ *   |                      |  in time order, but devices are interleaved
+ *   +----------------------+
+ *
+ * Journals carry no index, so that they can be extended with plain appends
+ * and survive a crash at any point: a partial record at the end is ignored,
+ * and cut off when the journal is opened for writing again. pms-import
+ * turns journals into indexed archives.
+ */
+
+#if !defined(EEE192_HOST_JOURNAL_H_)
+#define EEE192_HOST_JOURNAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Magic string at the start of every journal
+#define JOURNAL_MAGIC		"PMSJNL\r\n"
+
+/// Current journal format revision
+constexpr uint32_t JOURNAL_VERSION	= 1;
+
+/// Journal file header
+struct journal_header {
+	/// @c JOURNAL_MAGIC, without the terminating NUL
+	char     magic[8];
+
+	/// @c JOURNAL_VERSION at the time of creation
+	uint32_t version;
+
+	/// Must be equal to @code sizeof(sample) @endcode
+	uint32_t record_size;
+};
+static_assert(sizeof(journal_header) == 16, "journal_header is part of the journal format");
+
+/**
+ * Check a journal header
+ *
+ * @return	Number of complete records following the header, or -1 if
+ *		@c p does not start with a valid header
+ */
+long long journal_nr_records(const void *p, size_t len);
+
+/**
+ * Batching journal writer
+ *
+ * @note
+ * Samples are buffered in memory and written with a single write() per
+ * batch; nothing is written until the buffer fills up or flush() is called.
+ */
+class journal_writer {
+public:
+	journal_writer() = default;
+	~journal_writer();
+
+	journal_writer(const journal_writer &) = delete;
+	journal_writer &operator=(const journal_writer &) = delete;
+
+	/**
+	 * Open a journal for appending, creating it if needed
+	 *
+	 * @param[in]	batch	Number of samples buffered before a write
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno)
+	 */
+	bool open(const char *path, size_t batch);
+
+	/**
+	 * Buffer one sample, writing the batch out once it is full
+	 *
+	 * @return	@c false on an I/O error
+	 */
+	bool append(const sample &s);
+
+	/// Write out all buffered samples
+	bool flush();
+
+	/// Flush, then close the file
+	bool close();
+
+	/// Number of samples buffered
+	size_t pending() const { return buf_.size(); }
+
+	/// Number of samples written out so far (since open())
+	uint64_t nr_written() const { return nr_written_; }
+
+	/// Number of write() calls so far
+	uint64_t nr_writes() const { return nr_writes_; }
+
+private:
+	int fd_ = -1;
+	size_t batch_ = 0;
+	std::vector<sample> buf_;
+	size_t done_ = 0;		// Bytes of buf_ already written
+	uint64_t nr_written_ = 0;
+	uint64_t nr_writes_ = 0;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_JOURNAL_H_)
@@ -0,0 +1,258 @@
+/**
+ * @file  host/metrics.cpp
+ * @brief Localhost HTTP endpoint serving metrics in the Prometheus text format
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+namespace pms {
+
+const uint64_t latency_bucket_ns[LATENCY_NR_BUCKETS] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000, 500000, 1000000,
+};
+
+// The same bounds, as rendered in "le" labels
+static const char *const latency_bucket_le[LATENCY_NR_BUCKETS] = {
+	"1e-06", "2e-06", "5e-06", "1e-05", "2e-05", "5e-05", "0.0001", "0.00025", "0.0005", "0.001",
+};
+
+/// Room kept in each response buffer for the HTTP header
+constexpr size_t HTTP_HEADER_MAX = 256;
+
+/////////////////////////////////////////////////////////////////////////////
+
+void metrics_text::add(const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (truncated_)
+		return;
+	va_start(ap, fmt);
+	n = std::vsnprintf(buf_ + len_, cap_ - len_, fmt, ap);
+	va_end(ap);
+	if (n < 0 || (size_t)n >= cap_ - len_) {
+		truncated_ = true;
+		return;
+	}
+	len_ += (size_t)n;
+}
+
+void metrics_text::histogram(const char *name, const char *labels, const latency_histogram &h)
+{
+	uint64_t acc = 0;
+
+	for (size_t x = 0; x < LATENCY_NR_BUCKETS; ++x) {
+		acc += h.counts[x];
+		add("%s_bucket{%s,le=\"%s\"} %llu\n", name, labels,
+		    latency_bucket_le[x], (unsigned long long)acc);
+	}
+	acc += h.counts[LATENCY_NR_BUCKETS];
+	add("%s_bucket{%s,le=\"+Inf\"} %llu\n", name, labels, (unsigned long long)acc);
+	add("%s_sum{%s} %.9f\n", name, labels, (double)h.sum_ns * 1e-9);
+	add("%s_count{%s} %llu\n", name, labels, (unsigned long long)acc);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+metrics_server::~metrics_server()
+{
+	for (client &c : clients_)
+		drop(c);
+	if (fd_ >= 0)
+		close(fd_);
+}
+
+bool metrics_server::open(int epfd, uint16_t port, uint64_t token_base, size_t body_cap,
+	render_fn fn)
+{
+	struct sockaddr_in sa;
+	struct epoll_event ev;
+	int one = 1;
+
+	if (fd_ >= 0) {
+		errno = EINVAL;
+		return false;
+	}
+	fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd_ < 0)
+		return false;
+
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sin_family      = AF_INET;
+	sa.sin_port        = htons(port);
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ev.events   = EPOLLIN;
+	ev.data.u64 = token_base;
+	if (setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+	    bind(fd_, reinterpret_cast<struct sockaddr *>(&sa), sizeof(sa)) != 0 ||
+	    listen(fd_, (int)MAX_CLIENTS) != 0 ||
+	    epoll_ctl(epfd, EPOLL_CTL_ADD, fd_, &ev) != 0) {
+		int e = errno;
+
+		close(fd_);
+		fd_ = -1;
+		errno = e;
+		return false;
+	}
+
+	epfd_       = epfd;
+	token_base_ = token_base;
+	render_     = fn;
+	for (client &c : clients_)
+		c.out.resize(HTTP_HEADER_MAX + body_cap);
+	return true;
+}
+
+void metrics_server::handle(uint64_t tok, uint32_t events)
+{
+	client *c;
+
+	if (tok == token_base_) {
+		accept_clients();
+		return;
+	}
+	c = &clients_[tok - token_base_ - 1];
+	if (c->fd < 0)
+		return;
+	if ((events & (EPOLLERR | EPOLLHUP)) != 0 && c->out_len == 0) {
+		drop(*c);
+		return;
+	}
+	if (c->out_len > 0) {
+		flush(*c);
+		return;
+	}
+
+	ssize_t n = read(c->fd, c->req + c->req_len, sizeof(c->req) - 1 - c->req_len);
+	if (n <= 0) {
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+		drop(*c);
+		return;
+	}
+	c->req_len += (size_t)n;
+	c->req[c->req_len] = '\0';
+
+	// Requests are tiny; anything but the end of the header is ignored.
+	if (std::strstr(c->req, "\r\n\r\n") != nullptr || std::strstr(c->req, "\n\n") != nullptr ||
+	    c->req_len == sizeof(c->req) - 1)
+		serve(*c);
+}
+
+void metrics_server::accept_clients()
+{
+	for (;;) {
+		int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		struct epoll_event ev;
+		size_t x;
+
+		if (fd < 0)
+			return;
+		for (x = 0; x < MAX_CLIENTS && clients_[x].fd >= 0; ++x)
+			;
+		if (x == MAX_CLIENTS) {
+			close(fd);
+			continue;
+		}
+		ev.events   = EPOLLIN;
+		ev.data.u64 = token_base_ + 1 + x;
+		if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			close(fd);
+			continue;
+		}
+		clients_[x].fd      = fd;
+		clients_[x].req_len = 0;
+		clients_[x].out_len = 0;
+		clients_[x].out_done = 0;
+	}
+}
+
+void metrics_server::serve(client &c)
+{
+	char *body = c.out.data() + HTTP_HEADER_MAX;
+	const size_t body_cap = c.out.size() - HTTP_HEADER_MAX;
+	const bool found = std::strncmp(c.req, "GET /metrics ", 13) == 0 ||
+			   std::strncmp(c.req, "GET / ", 6) == 0;
+	const char *status = "200 OK";
+	metrics_text text(body, body_cap);
+	char hdr[HTTP_HEADER_MAX];
+	struct timespec t0, t1;
+	int hlen;
+
+	if (found) {
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		render_(text);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		render_ns_ += (uint64_t)((t1.tv_sec - t0.tv_sec) * 1000000000LL +
+					 (t1.tv_nsec - t0.tv_nsec));
+		++nr_scrapes_;
+		if (text.truncated()) {
+			++nr_truncated_;
+			status = "500 Internal Server Error";
+			text = metrics_text(body, body_cap);
+			text.add("metrics do not fit in %zu bytes\n", body_cap);
+		}
+	} else {
+		status = "404 Not Found";
+		text.add("not found\n");
+	}
+
+	// Put the header right in front of the body, so that one write() does.
+	hlen = std::snprintf(hdr, sizeof(hdr),
+		"HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %zu\r\nConnection: close\r\n\r\n",
+		status, text.len());
+	std::memcpy(body - hlen, hdr, (size_t)hlen);
+	c.out_done = HTTP_HEADER_MAX - (size_t)hlen;
+	c.out_len  = HTTP_HEADER_MAX + text.len();
+	flush(c);
+}
+
+void metrics_server::flush(client &c)
+{
+	while (c.out_done < c.out_len) {
+		ssize_t n = write(c.fd, c.out.data() + c.out_done, c.out_len - c.out_done);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN) {
+				struct epoll_event ev;
+
+				// Wait for room in the socket buffer.
+				ev.events   = EPOLLOUT;
+				ev.data.u64 = token_base_ + 1 + (uint64_t)(&c - clients_);
+				epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+				return;
+			}
+			break;
+		}
+		c.out_done += (size_t)n;
+	}
+	drop(c);
+}
+
+void metrics_server::drop(client &c)
+{
+	if (c.fd < 0)
+		return;
+	epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+	close(c.fd);
+	c.fd = -1;
+	c.out_len = 0;
+}
+
+}	// namespace pms
@@ -0,0 +1,154 @@
+/**
+ * @file  host/metrics.h
+ * @brief Localhost HTTP endpoint serving metrics in the Prometheus text format
+ */
+
+/*
+ * The server is driven by the caller's epoll loop and never allocates once
+ * open: each of the MAX_CLIENTS connection slots owns a response buffer
+ * sized up front, and metrics are rendered into it with snprintf(). A
+ * scrape costs one accept, one read, one render and (usually) one write.
+ * A render that does not fit is answered with a 500 rather than cut short,
+ * as a partial exposition would be misread, and counted.
+ */
+
+#if !defined(EEE192_HOST_METRICS_H_)
+#define EEE192_HOST_METRICS_H_
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace pms {
+
+/// Number of finite latency buckets
+constexpr size_t LATENCY_NR_BUCKETS = 10;
+
+/// Upper bounds of the latency buckets, in nanoseconds
+extern const uint64_t latency_bucket_ns[LATENCY_NR_BUCKETS];
+
+/// Fixed-bucket latency histogram
+struct latency_histogram {
+	/// Per-bucket counts; the last one counts everything beyond
+	uint64_t counts[LATENCY_NR_BUCKETS + 1] = {};
+
+	/// Sum of all observations, in nanoseconds
+	uint64_t sum_ns = 0;
+
+	/// Add one observation
+	void add(uint64_t ns)
+	{
+		size_t x = 0;
+
+		while (x < LATENCY_NR_BUCKETS && ns > latency_bucket_ns[x])
+			++x;
+		++counts[x];
+		sum_ns += ns;
+	}
+};
+
+/// Bounded text buffer that metrics are rendered into
+class metrics_text {
+public:
+	metrics_text(char *buf, size_t cap) : buf_(buf), cap_(cap) {}
+
+	/// Append formatted text; output past the capacity is dropped
+	void add(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+	/**
+	 * Append one histogram in Prometheus form (cumulative buckets, sum
+	 * and count), in seconds
+	 *
+	 * @param[in]	labels	Label list without braces, e.g. @c device="1"
+	 */
+	void histogram(const char *name, const char *labels, const latency_histogram &h);
+
+	/// Length of the text so far
+	size_t len() const { return len_; }
+
+	/// Whether some text had to be dropped
+	bool truncated() const { return truncated_; }
+
+private:
+	char *buf_;
+	size_t cap_;
+	size_t len_ = 0;
+	bool truncated_ = false;
+};
+
+/// Minimal HTTP server for metrics scrapes
+class metrics_server {
+public:
+	/// Number of concurrent connections served
+	static constexpr size_t MAX_CLIENTS = 4;
+
+	/// Renders the metrics; called once per scrape
+	typedef std::function<void(metrics_text &)> render_fn;
+
+	metrics_server() = default;
+	~metrics_server();
+
+	metrics_server(const metrics_server &) = delete;
+	metrics_server &operator=(const metrics_server &) = delete;
+
+	/**
+	 * Listen on 127.0.0.1
+	 *
+	 * @param[in]	epfd		epoll instance to register with
+	 * @param[in]	token_base	First of the @code MAX_CLIENTS + 1 @endcode
+	 *				epoll tokens to use
+	 * @param[in]	body_cap	Largest response body expected; larger
+	 *				renders are answered with an error
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno)
+	 */
+	bool open(int epfd, uint16_t port, uint64_t token_base, size_t body_cap, render_fn fn);
+
+	/// Whether an epoll token belongs to this server
+	bool owns(uint64_t tok) const
+	{
+		return fd_ >= 0 && tok >= token_base_ && tok - token_base_ <= MAX_CLIENTS;
+	}
+
+	/// Handle readiness of one of this server's descriptors
+	void handle(uint64_t tok, uint32_t events);
+
+	/// Number of scrapes answered
+	uint64_t nr_scrapes() const { return nr_scrapes_; }
+
+	/// Time spent rendering, over all scrapes, in nanoseconds
+	uint64_t render_ns() const { return render_ns_; }
+
+	/// Number of scrapes whose metrics did not fit in the body
+	uint64_t nr_truncated() const { return nr_truncated_; }
+
+private:
+	struct client {
+		int fd = -1;
+		size_t req_len = 0;
+		size_t out_len = 0;
+		size_t out_done = 0;
+		char req[1024];
+		std::vector<char> out;
+	};
+
+	void accept_clients();
+	void serve(client &c);
+	void flush(client &c);
+	void drop(client &c);
+
+	int epfd_ = -1;
+	int fd_ = -1;
+	uint64_t token_base_ = 0;
+	render_fn render_;
+	client clients_[MAX_CLIENTS];
+	uint64_t nr_scrapes_ = 0;
+	uint64_t render_ns_ = 0;
+	uint64_t nr_truncated_ = 0;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_METRICS_H_)
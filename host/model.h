@@ -0,0 +1,272 @@
+/**
+ * @file  host/model.h
+ * @brief Frame layouts of the supported sensor models, decoded at compile time
+ */
+
+/*
+ * A model is a plain struct describing one frame layout: its length, byte
+ * order, the constant bytes that frame it, a checksum rule and a table of
+ * 16-bit fields. model_codec<Model> turns that description into a decoder
+ * for the templates in decode.h; every loop over the layout is expanded at
+ * compile time, and the checks are OR-ed together rather than tested one at
+ * a time, so a candidate frame costs the same whether it is valid or not.
+ *
+ * The description is also the documentation of the layout: see the models
+ * at the end of this file.
+ */
+
+#if !defined(EEE192_HOST_MODEL_H_)
+#define EEE192_HOST_MODEL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "decode.h"
+#include "sample.h"
+
+namespace pms {
+namespace model {
+
+/// Byte order of multi-byte fields
+enum class byte_order { big, little };
+
+/**
+ * Where a field is stored in a sample
+ *
+ * These index @c pm_cf1, then @c pm_atm, then @c nr_particles.
+ */
+enum dest : unsigned {
+	CF1_PM1_0 = 0,
+	CF1_PM2_5,
+	CF1_PM10,
+	ATM_PM1_0,
+	ATM_PM2_5,
+	ATM_PM10,
+	BIN_0_3,
+	BIN_0_5,
+	BIN_1_0,
+	BIN_2_5,
+	BIN_5_0,
+	BIN_10,
+	NR_DESTS
+};
+
+/// Read a 16-bit value
+template <byte_order Order>
+inline uint16_t load16(const uint8_t *p)
+{
+	if constexpr (Order == byte_order::big)
+		return (uint16_t)(p[0] << 8 | p[1]);
+	else
+		return (uint16_t)(p[0] | p[1] << 8);
+}
+
+/// Constant bytes at a fixed offset, e.g. start characters or a trailer
+template <size_t Offset, uint8_t... Bytes>
+struct fixed {
+	/// Offset just past the last byte
+	static constexpr size_t end = Offset + sizeof...(Bytes);
+
+	/// The bytes themselves
+	static constexpr uint8_t bytes[] = {Bytes...};
+
+	/// Zero if all bytes match, non-zero otherwise
+	template <byte_order>
+	static unsigned mismatch(const uint8_t *raw)
+	{
+		return mismatch(raw, std::make_index_sequence<sizeof...(Bytes)>());
+	}
+
+private:
+	template <size_t... I>
+	static unsigned mismatch(const uint8_t *raw, std::index_sequence<I...>)
+	{
+		return (0u | ... | (unsigned)(raw[Offset + I] ^ Bytes));
+	}
+};
+
+/// 16-bit sum of bytes [Begin, End), stored at @c At in the model's byte order
+template <size_t Begin, size_t End, size_t At>
+struct sum16 {
+	static constexpr size_t end = At + 2;
+
+	template <byte_order Order>
+	static unsigned mismatch(const uint8_t *raw)
+	{
+		return (unsigned)(uint16_t)(sum(raw, std::make_index_sequence<End - Begin>()) ^
+					    load16<Order>(raw + At));
+	}
+
+private:
+	template <size_t... I>
+	static unsigned sum(const uint8_t *raw, std::index_sequence<I...>)
+	{
+		return (0u + ... + raw[Begin + I]);
+	}
+};
+
+/// 8-bit sum of bytes [Begin, End), stored at @c At
+template <size_t Begin, size_t End, size_t At>
+struct sum8 {
+	static constexpr size_t end = At + 1;
+
+	template <byte_order>
+	static unsigned mismatch(const uint8_t *raw)
+	{
+		return (unsigned)(uint8_t)(sum(raw, std::make_index_sequence<End - Begin>()) ^ raw[At]);
+	}
+
+private:
+	template <size_t... I>
+	static unsigned sum(const uint8_t *raw, std::index_sequence<I...>)
+	{
+		return (0u + ... + raw[Begin + I]);
+	}
+};
+
+/**
+ * 16-bit field at @c Offset, stored into @c Dest
+ *
+ * Values are divided by @c Div (rounding to nearest) on the way, for sensors
+ * reporting finer units than a sample holds.
+ */
+template <size_t Offset, dest Dest, unsigned Div = 1>
+struct field {
+	static_assert(Dest < NR_DESTS && Div > 0, "bad field");
+
+	static constexpr size_t end = Offset + 2;
+
+	template <byte_order Order>
+	static void store(const uint8_t *raw, sample *s)
+	{
+		uint16_t v = load16<Order>(raw + Offset);
+
+		if constexpr (Div > 1)
+			v = (uint16_t)(((unsigned)v + Div / 2) / Div);
+		if constexpr (Dest < ATM_PM1_0)
+			s->pm_cf1[Dest - CF1_PM1_0] = v;
+		else if constexpr (Dest < BIN_0_3)
+			s->pm_atm[Dest - ATM_PM1_0] = v;
+		else
+			s->nr_particles[Dest - BIN_0_3] = v;
+	}
+};
+
+/// Ordered list of checks or fields
+template <typename... T>
+struct list {
+	/// Offset just past the furthest element
+	static constexpr size_t end = std::max({size_t(0), T::end...});
+
+	/// OR of the elements' mismatch() results
+	template <byte_order Order>
+	static unsigned mismatch(const uint8_t *raw)
+	{
+		return (0u | ... | T::template mismatch<Order>(raw));
+	}
+
+	/// Store every field
+	template <byte_order Order>
+	static void store(const uint8_t *raw, sample *s)
+	{
+		(T::template store<Order>(raw, s), ...);
+	}
+};
+
+/**
+ * Decoder for one model, for use with scan_frames() and
+ * basic_stream_decoder
+ *
+ * A model provides:
+ * - @c name, as accepted on command lines
+ * - @c frame_len and @c order
+ * - @c header, a fixed<0, ...> of at least the two start characters
+ * - @c checks, a list<> of further fixed<> bytes and the checksum
+ * - @c fields, a list<> of field<>
+ * - @c flags, the @code SAMPLE_FLAG_* @endcode set on every sample
+ */
+template <typename Model>
+struct model_codec {
+	typedef sample frame_type;
+
+	static constexpr size_t frame_len = Model::frame_len;
+	static constexpr uint8_t start_1  = Model::header::bytes[0];
+	static constexpr uint8_t start_2  = Model::header::bytes[1];
+
+	static_assert(Model::header::end >= 2, "a header needs two start characters");
+	static_assert(Model::header::end <= frame_len && Model::checks::end <= frame_len &&
+		      Model::fields::end <= frame_len, "layout exceeds the frame");
+
+	/**
+	 * Validate and decode a frame of @c frame_len bytes
+	 *
+	 * @note
+	 * Only the readings and flags are filled in; the fields are stored
+	 * even if the frame turns out to be invalid.
+	 */
+	static bool decode(const uint8_t *raw, sample *s)
+	{
+		constexpr byte_order order = Model::order;
+
+		std::memset(s->pm_cf1, 0, offsetof(sample, reserved) - offsetof(sample, pm_cf1));
+		s->flags = Model::flags;
+		Model::fields::template store<order>(raw, s);
+		return (Model::header::template mismatch<order>(raw) |
+			Model::checks::template mismatch<order>(raw)) == 0;
+	}
+};
+
+/// Incremental decoder for one model
+template <typename Model>
+using model_stream = basic_stream_decoder<model_codec<Model>>;
+
+/////////////////////////////////////////////////////////////////////////////
+
+/// Plantower PMS5003: 32-byte frames, big-endian, summed over bytes 0-29
+struct pms5003 {
+	static constexpr const char *name = "pms5003";
+	static constexpr size_t frame_len = 32;
+	static constexpr byte_order order = byte_order::big;
+	static constexpr uint16_t flags   = SAMPLE_FLAG_FULL_FRAME;
+
+	// Start characters and the length field (28)
+	typedef fixed<0, 0x42, 0x4D, 0x00, 0x1C> header;
+	typedef list<sum16<0, 30, 30>> checks;
+	typedef list<
+		field< 4, CF1_PM1_0>, field< 6, CF1_PM2_5>, field< 8, CF1_PM10>,
+		field<10, ATM_PM1_0>, field<12, ATM_PM2_5>, field<14, ATM_PM10>,
+		field<16, BIN_0_3>,   field<18, BIN_0_5>,   field<20, BIN_1_0>,
+		field<22, BIN_2_5>,   field<24, BIN_5_0>,   field<26, BIN_10>
+	> fields;
+};
+
+/// Plantower PMS7003: the PMS5003 layout
+struct pms7003 : pms5003 {
+	static constexpr const char *name = "pms7003";
+};
+
+/**
+ * Nova Fitness SDS011: 10-byte frames, little-endian, PM2.5 and PM10 only
+ *
+ * @note
+ * The sensor reports 0.1 ug/m3 units; samples hold them rounded to ug/m3.
+ */
+struct sds011 {
+	static constexpr const char *name = "sds011";
+	static constexpr size_t frame_len = 10;
+	static constexpr byte_order order = byte_order::little;
+	static constexpr uint16_t flags   = SAMPLE_FLAG_CHECKED;
+
+	// Start character and the "data report" command
+	typedef fixed<0, 0xAA, 0xC0> header;
+	typedef list<sum8<2, 8, 8>, fixed<9, 0xAB>> checks;
+	typedef list<field<2, ATM_PM2_5, 10>, field<4, ATM_PM10, 10>> fields;
+};
+
+}	// namespace model
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_MODEL_H_)
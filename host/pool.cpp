@@ -0,0 +1,143 @@
+/**
+ * @file  host/pool.cpp
+ * @brief Work-stealing thread pool for index-range jobs
+ */
+
+#include "pool.h"
+
+namespace pms {
+
+/////////////////////////////////////////////////////////////////////////////
+
+work_pool::work_pool(unsigned int nr_workers)
+{
+	if (nr_workers == 0)
+		nr_workers = 1;
+	for (unsigned int w = 0; w < nr_workers; ++w)
+		shares_.emplace_back(new share);
+	for (unsigned int w = 1; w < nr_workers; ++w)
+		threads_.emplace_back(&work_pool::loop, this, w);
+}
+
+work_pool::~work_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mu_);
+		quit_ = true;
+	}
+	start_cv_.notify_all();
+	for (std::thread &t : threads_)
+		t.join();
+}
+
+void work_pool::run(size_t n, const task_fn &fn)
+{
+	const size_t nr = shares_.size();
+
+	{
+		std::lock_guard<std::mutex> lock(mu_);
+
+		for (size_t w = 0; w < nr; ++w) {
+			std::lock_guard<std::mutex> slock(shares_[w]->mu);
+
+			shares_[w]->lo = n * w / nr;
+			shares_[w]->hi = n * (w + 1) / nr;
+		}
+		fn_ = &fn;
+		nr_busy_ = (unsigned int)threads_.size();
+		++generation_;
+	}
+	start_cv_.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(mu_);
+	done_cv_.wait(lock, [this]() { return nr_busy_ == 0; });
+	fn_ = nullptr;
+}
+
+// Take the next task of a worker's own share
+bool work_pool::take(unsigned int w, size_t *x)
+{
+	share &s = *shares_[w];
+	std::lock_guard<std::mutex> lock(s.mu);
+
+	if (s.lo >= s.hi)
+		return false;
+	*x = s.lo++;
+	return true;
+}
+
+// Refill a worker's (empty) share from the largest one left
+bool work_pool::steal(unsigned int w)
+{
+	for (;;) {
+		unsigned int victim = w;
+		size_t most = 0;
+
+		for (unsigned int v = 0; v < shares_.size(); ++v) {
+			std::lock_guard<std::mutex> lock(shares_[v]->mu);
+
+			if (shares_[v]->hi - shares_[v]->lo > most) {
+				most = shares_[v]->hi - shares_[v]->lo;
+				victim = v;
+			}
+		}
+		if (most == 0)
+			return false;
+
+		// The victim may have moved on meanwhile; look again if it ran dry.
+		size_t lo, hi;
+		{
+			share &s = *shares_[victim];
+			std::lock_guard<std::mutex> lock(s.mu);
+			const size_t left = s.hi - s.lo;
+
+			if (left == 0)
+				continue;
+			hi = s.hi;
+			lo = s.hi - (left + 1) / 2;
+			s.hi = lo;
+		}
+
+		share &mine = *shares_[w];
+		std::lock_guard<std::mutex> lock(mine.mu);
+
+		mine.lo = lo;
+		mine.hi = hi;
+		++nr_steals_;
+		return true;
+	}
+}
+
+void work_pool::work(unsigned int w)
+{
+	size_t x;
+
+	do {
+		while (take(w, &x))
+			(*fn_)(w, x);
+	} while (steal(w));
+}
+
+void work_pool::loop(unsigned int w)
+{
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(mu_);
+
+	for (;;) {
+		start_cv_.wait(lock, [&]() { return quit_ || generation_ != seen; });
+		if (quit_)
+			return;
+		seen = generation_;
+
+		lock.unlock();
+		work(w);
+		lock.lock();
+
+		if (--nr_busy_ == 0)
+			done_cv_.notify_one();
+	}
+}
+
+}	// namespace pms
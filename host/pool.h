@@ -0,0 +1,84 @@
+/**
+ * @file  host/pool.h
+ * @brief Work-stealing thread pool for index-range jobs
+ */
+
+/*
+ * A job is a range of task indices [0, n). Each worker starts with an equal,
+ * contiguous share of it and takes tasks from the front of its own share, so
+ * that neighbouring tasks (e.g. adjacent archive chunks) tend to run in order
+ * on the same core. A worker that runs dry steals the back half of the
+ * largest share left, so that skewed jobs (most chunks pruned, a few dense
+ * ones) still keep every core busy until the end.
+ *
+ * Shares are guarded by one mutex each; tasks are expected to be coarse
+ * (thousands of samples), so the lock is never contended for long.
+ */
+
+#if !defined(EEE192_HOST_POOL_H_)
+#define EEE192_HOST_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pms {
+
+/// Pool of persistent worker threads
+class work_pool {
+public:
+	/// Task body: fn(worker, index), with worker in [0, nr_workers())
+	typedef std::function<void(unsigned int, size_t)> task_fn;
+
+	/// Start a pool; the calling thread counts as one of @c nr_workers
+	explicit work_pool(unsigned int nr_workers);
+	~work_pool();
+
+	work_pool(const work_pool &) = delete;
+	work_pool &operator=(const work_pool &) = delete;
+
+	/// Run fn(w, 0) .. fn(w, n-1), and return once all of them are done
+	void run(size_t n, const task_fn &fn);
+
+	/// Number of workers, including the calling thread
+	unsigned int nr_workers() const { return (unsigned int)shares_.size(); }
+
+	/// Number of successful steals since the pool was started
+	uint64_t nr_steals() const { return nr_steals_; }
+
+private:
+	// Remaining tasks [lo, hi) of one worker
+	struct alignas(64) share {
+		std::mutex mu;
+		size_t lo = 0;
+		size_t hi = 0;
+	};
+
+	bool take(unsigned int w, size_t *x);
+	bool steal(unsigned int w);
+	void work(unsigned int w);
+	void loop(unsigned int w);
+
+	std::vector<std::unique_ptr<share>> shares_;
+	std::vector<std::thread> threads_;
+
+	std::mutex mu_;
+	std::condition_variable start_cv_;
+	std::condition_variable done_cv_;
+	const task_fn *fn_ = nullptr;
+	uint64_t generation_ = 0;
+	unsigned int nr_busy_ = 0;
+	bool quit_ = false;
+
+	std::atomic<uint64_t> nr_steals_{0};
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_POOL_H_)
@@ -0,0 +1,389 @@
+/**
+ * @file  host/quantile.cpp
+ * @brief Mergeable, bounded-memory quantile sketches of PM samples
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "quantile.h"
+
+namespace pms {
+
+/// Ratio between the capacities of adjacent KLL levels
+constexpr double KLL_C = 2.0 / 3.0;
+
+/// Smallest capacity of any KLL level
+constexpr size_t KLL_MIN_CAPACITY = 2;
+
+/// Magic string at the start of every saved quantile file
+#define QUANTILE_MAGIC	"PMSQNT\r\n"
+
+/// Current quantile file revision
+constexpr uint32_t QUANTILE_VERSION = 1;
+
+// Little-endian encoding helpers, so that saved sketches are portable
+template <typename T>
+static void put_le(std::vector<uint8_t> *out, T v)
+{
+	uint64_t u = 0;
+
+	std::memcpy(&u, &v, sizeof(v));
+	for (size_t x = 0; x < sizeof(T); ++x)
+		out->push_back((uint8_t)(u >> (8*x)));
+}
+
+template <typename T>
+static bool get_le(const uint8_t *&p, const uint8_t *end, T *v)
+{
+	uint64_t u = 0;
+
+	if ((size_t)(end - p) < sizeof(T))
+		return false;
+	for (size_t x = 0; x < sizeof(T); ++x)
+		u |= (uint64_t)p[x] << (8*x);
+	std::memcpy(v, &u, sizeof(T));
+	p += sizeof(T);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+kll_sketch::kll_sketch(uint16_t k)
+	: k_(std::max<uint16_t>(k, 8)), rng_(0x2545F4914F6CDD1Dull ^ k), levels_(1)
+{
+	recompute_capacity();
+}
+
+size_t kll_sketch::capacity(size_t level) const
+{
+	const size_t depth = levels_.size() - 1 - level;
+
+	return std::max(KLL_MIN_CAPACITY,
+		(size_t)std::ceil(k_ * std::pow(KLL_C, (double)depth)));
+}
+
+void kll_sketch::recompute_capacity()
+{
+	cap0_ = capacity(0);
+	cap_total_ = 0;
+	for (size_t h = 0; h < levels_.size(); ++h)
+		cap_total_ += capacity(h);
+}
+
+size_t kll_sketch::nr_retained() const
+{
+	size_t t = 0;
+
+	for (const std::vector<float> &lv : levels_)
+		t += lv.size();
+	return t;
+}
+
+// xorshift64*; only the offset of each compaction needs to be random
+bool kll_sketch::coin()
+{
+	rng_ ^= rng_ >> 12;
+	rng_ ^= rng_ << 25;
+	rng_ ^= rng_ >> 27;
+	return ((rng_ * 0x2545F4914F6CDD1Dull) >> 63) != 0;
+}
+
+void kll_sketch::compress()
+{
+	while (nr_retained() > cap_total_) {
+		size_t h;
+
+		for (h = 0; h < levels_.size(); ++h) {
+			if (levels_[h].size() >= capacity(h))
+				break;
+		}
+		if (h == levels_.size())
+			return;
+		if (h + 1 == levels_.size()) {
+			levels_.emplace_back();
+			recompute_capacity();
+		}
+
+		std::vector<float> &src = levels_[h];
+		std::vector<float> &dst = levels_[h + 1];
+		float odd = 0.0f;
+		const bool has_odd = (src.size() & 1) != 0;
+
+		// An odd item out stays behind at its level.
+		if (has_odd) {
+			odd = src.back();
+			src.pop_back();
+		}
+		std::sort(src.begin(), src.end());
+		for (size_t x = coin() ? 1 : 0; x < src.size(); x += 2)
+			dst.push_back(src[x]);
+		src.clear();
+		if (has_odd)
+			src.push_back(odd);
+	}
+}
+
+void kll_sketch::update(float v)
+{
+	if (std::isnan(v))
+		return;
+	levels_[0].push_back(v);
+	++n_;
+	if (levels_[0].size() >= cap0_)
+		compress();
+}
+
+void kll_sketch::merge(const kll_sketch &o)
+{
+	if (o.n_ == 0)
+		return;
+	if (o.levels_.size() > levels_.size()) {
+		levels_.resize(o.levels_.size());
+		recompute_capacity();
+	}
+	for (size_t h = 0; h < o.levels_.size(); ++h)
+		levels_[h].insert(levels_[h].end(), o.levels_[h].begin(), o.levels_[h].end());
+	n_ += o.n_;
+	compress();
+}
+
+void kll_sketch::quantiles(const double *qs, float *out, size_t n) const
+{
+	std::vector<std::pair<float, uint64_t>> items;
+	uint64_t total = 0, acc = 0;
+	size_t i = 0;
+
+	items.reserve(nr_retained());
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		for (float v : levels_[h])
+			items.emplace_back(v, (uint64_t)1 << h);
+	}
+	if (items.empty()) {
+		for (size_t x = 0; x < n; ++x)
+			out[x] = std::numeric_limits<float>::quiet_NaN();
+		return;
+	}
+	std::sort(items.begin(), items.end());
+	for (const auto &it : items)
+		total += it.second;
+
+	for (size_t x = 0; x < n; ++x) {
+		const double target = std::min(std::max(qs[x], 0.0), 1.0) * (double)total;
+
+		while (i + 1 < items.size() && (double)(acc + items[i].second) < target)
+			acc += items[i++].second;
+		out[x] = items[i].first;
+	}
+}
+
+float kll_sketch::quantile(double q) const
+{
+	float v;
+
+	quantiles(&q, &v, 1);
+	return v;
+}
+
+double kll_sketch::rank(float v) const
+{
+	uint64_t below = 0, total = 0;
+
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		for (float x : levels_[h]) {
+			if (x < v)
+				below += (uint64_t)1 << h;
+			total += (uint64_t)1 << h;
+		}
+	}
+	return total ? (double)below / (double)total : 0.0;
+}
+
+void kll_sketch::serialize(std::vector<uint8_t> *out) const
+{
+	put_le<uint16_t>(out, k_);
+	put_le<uint64_t>(out, n_);
+	put_le<uint16_t>(out, (uint16_t)levels_.size());
+	for (const std::vector<float> &lv : levels_) {
+		put_le<uint32_t>(out, (uint32_t)lv.size());
+		for (float v : lv)
+			put_le<float>(out, v);
+	}
+}
+
+bool kll_sketch::deserialize(const uint8_t *&p, const uint8_t *end)
+{
+	uint16_t k, nr_levels;
+	uint64_t n;
+
+	if (!get_le(p, end, &k) || !get_le(p, end, &n) || !get_le(p, end, &nr_levels) ||
+	    k < 8 || nr_levels == 0 || nr_levels > 64)
+		return false;
+
+	std::vector<std::vector<float>> levels(nr_levels);
+	for (std::vector<float> &lv : levels) {
+		uint32_t len;
+
+		if (!get_le(p, end, &len) || (size_t)(end - p) / sizeof(float) < len)
+			return false;
+		lv.resize(len);
+		for (float &v : lv)
+			get_le(p, end, &v);
+	}
+	k_ = k;
+	n_ = n;
+	levels_ = std::move(levels);
+	recompute_capacity();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+quantile_store::quantile_store(int64_t bucket_ms, uint16_t k)
+	: bucket_ms_(bucket_ms > 0 ? bucket_ms : 3600 * 1000), k_(k)
+{
+}
+
+quantile_store::entry_t &quantile_store::bucket(uint32_t device, int64_t start)
+{
+	auto it = buckets_.find(key_t(device, start));
+
+	if (it == buckets_.end()) {
+		entry_t e = { kll_sketch(k_), kll_sketch(k_), kll_sketch(k_) };
+
+		it = buckets_.emplace(key_t(device, start), std::move(e)).first;
+	}
+	return it->second;
+}
+
+void quantile_store::add(const sample &s)
+{
+	int64_t r = s.ts_ms % bucket_ms_;
+	entry_t &e = bucket(s.device, s.ts_ms - (r < 0 ? r + bucket_ms_ : r));
+
+	for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+		e[ch].update((float)s.pm_atm[ch]);
+}
+
+bool quantile_store::merge(const quantile_store &o)
+{
+	if (o.bucket_ms_ != bucket_ms_)
+		return false;
+	for (const auto &kv : o.buckets_) {
+		entry_t &e = bucket(kv.first.first, kv.first.second);
+
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			e[ch].merge(kv.second[ch]);
+	}
+	return true;
+}
+
+kll_sketch quantile_store::window(uint32_t device, unsigned int ch,
+	int64_t from, int64_t until) const
+{
+	kll_sketch out(k_);
+	const int64_t first = (from < INT64_MIN + bucket_ms_) ? INT64_MIN : from - bucket_ms_ + 1;
+	auto it = buckets_.lower_bound(key_t(device, first));
+
+	for (; it != buckets_.end() && it->first.first == device &&
+	       it->first.second < until; ++it)
+		out.merge(it->second[ch]);
+	return out;
+}
+
+void quantile_store::expire(int64_t cutoff)
+{
+	for (auto it = buckets_.begin(); it != buckets_.end(); ) {
+		if (it->first.second < cutoff)
+			it = buckets_.erase(it);
+		else
+			++it;
+	}
+}
+
+bool quantile_store::save(const char *path) const
+{
+	const std::string tmp = std::string(path) + ".tmp";
+	std::vector<uint8_t> buf;
+	std::FILE *fp;
+	bool ok;
+
+	buf.insert(buf.end(), QUANTILE_MAGIC, QUANTILE_MAGIC + 8);
+	put_le<uint32_t>(&buf, QUANTILE_VERSION);
+	put_le<int64_t>(&buf, bucket_ms_);
+	put_le<uint64_t>(&buf, buckets_.size());
+	for (const auto &kv : buckets_) {
+		put_le<uint32_t>(&buf, kv.first.first);
+		put_le<int64_t>(&buf, kv.first.second);
+		for (const kll_sketch &sk : kv.second)
+			sk.serialize(&buf);
+	}
+
+	fp = std::fopen(tmp.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+	ok = std::fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+	if (std::fclose(fp) != 0)
+		ok = false;
+	if (ok && std::rename(tmp.c_str(), path) != 0)
+		ok = false;
+	if (!ok) {
+		const int err = errno;
+
+		std::remove(tmp.c_str());
+		errno = err;
+	}
+	return ok;
+}
+
+bool quantile_store::load(const char *path)
+{
+	std::vector<uint8_t> buf;
+	std::FILE *fp = std::fopen(path, "rb");
+	uint8_t tmp[65536];
+	size_t len;
+
+	if (fp == nullptr)
+		return false;
+	while ((len = std::fread(tmp, 1, sizeof(tmp), fp)) > 0)
+		buf.insert(buf.end(), tmp, tmp + len);
+	std::fclose(fp);
+
+	const uint8_t *p = buf.data(), *end = buf.data() + buf.size();
+	uint32_t version;
+	int64_t bucket_ms;
+	uint64_t n;
+
+	errno = EINVAL;
+	if (buf.size() < 8 || std::memcmp(p, QUANTILE_MAGIC, 8) != 0)
+		return false;
+	p += 8;
+	if (!get_le(p, end, &version) || version != QUANTILE_VERSION ||
+	    !get_le(p, end, &bucket_ms) || bucket_ms != bucket_ms_ ||
+	    !get_le(p, end, &n))
+		return false;
+
+	for (uint64_t x = 0; x < n; ++x) {
+		uint32_t device;
+		int64_t start;
+		entry_t e = { kll_sketch(k_), kll_sketch(k_), kll_sketch(k_) };
+
+		if (!get_le(p, end, &device) || !get_le(p, end, &start))
+			return false;
+		for (kll_sketch &sk : e) {
+			if (!sk.deserialize(p, end))
+				return false;
+		}
+		entry_t &dst = bucket(device, start);
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			dst[ch].merge(e[ch]);
+	}
+	return true;
+}
+
+}	// namespace pms
@@ -0,0 +1,153 @@
+/**
+ * @file  host/quantile.h
+ * @brief Mergeable, bounded-memory quantile sketches of PM samples
+ */
+
+/*
+ * kll_sketch is the KLL sketch (Karnin, Lang & Liberty, 2016): items are kept
+ * in a stack of "compactors", level h holding items of weight 2^h. When the
+ * sketch outgrows its capacity, the lowest over-full level is sorted and every
+ * other item (starting at a random offset) is promoted to the next level.
+ * With k = 200, rank error stays around 1.3% regardless of the number of
+ * items, while the sketch holds at most about 3k items.
+ *
+ * quantile_store keeps one sketch per (device, PM channel, time bucket); a
+ * percentile over an arbitrary window merges the buckets that the window
+ * covers, so its cost depends on the number of buckets and the sketch size,
+ * never on the number of samples.
+ */
+
+#if !defined(EEE192_HOST_QUANTILE_H_)
+#define EEE192_HOST_QUANTILE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Default accuracy parameter for KLL sketches
+constexpr uint16_t KLL_DEFAULT_K = 200;
+
+/// KLL quantile sketch over single-precision values
+class kll_sketch {
+public:
+	explicit kll_sketch(uint16_t k = KLL_DEFAULT_K);
+
+	/// Add one value
+	void update(float v);
+
+	/// Fold another sketch into this one
+	void merge(const kll_sketch &o);
+
+	/**
+	 * Estimate the value at normalized rank @c q
+	 *
+	 * @param[in]	q	Rank on the interval [0, 1]
+	 *
+	 * @return	The estimated quantile, or NaN if the sketch is empty
+	 */
+	float quantile(double q) const;
+
+	/// Estimate several quantiles at once (@c qs must be ascending)
+	void quantiles(const double *qs, float *out, size_t n) const;
+
+	/// Estimate the normalized rank of @c v
+	double rank(float v) const;
+
+	/// Number of values added so far (including merged sketches)
+	uint64_t count() const { return n_; }
+
+	/// Number of values actually retained
+	size_t nr_retained() const;
+
+	/// Append a portable encoding of the sketch to @c out
+	void serialize(std::vector<uint8_t> *out) const;
+
+	/**
+	 * Decode a sketch previously encoded with serialize()
+	 *
+	 * @param[in,out]	p	Start of the encoding; advanced past it
+	 * @param[in]		end	End of the buffer
+	 *
+	 * @return	@c true on success, @c false if the encoding is invalid
+	 */
+	bool deserialize(const uint8_t *&p, const uint8_t *end);
+
+private:
+	size_t capacity(size_t level) const;
+	void recompute_capacity();
+	void compress();
+	bool coin();
+
+	uint16_t k_;
+	uint64_t n_ = 0;
+	uint64_t rng_;
+	std::vector<std::vector<float>> levels_;
+
+	// Capacities only change with the number of levels; cache them.
+	size_t cap0_ = 0;
+	size_t cap_total_ = 0;
+};
+
+/// Per-device, per-channel sketches over time buckets
+class quantile_store {
+public:
+	/**
+	 * @param[in]	bucket_ms	Width of each bucket; this is also the
+	 *				finest window resolution
+	 * @param[in]	k		Accuracy parameter of each sketch
+	 */
+	explicit quantile_store(int64_t bucket_ms = 3600 * 1000, uint16_t k = KLL_DEFAULT_K);
+
+	/// Add all PM channels of one sample
+	void add(const sample &s);
+
+	/// Fold all buckets of another store (with the same bucket width) in
+	bool merge(const quantile_store &o);
+
+	/**
+	 * Merge all buckets of one device and channel overlapping [from, until)
+	 *
+	 * @note
+	 * Buckets are included whole; the window is thus widened to bucket
+	 * boundaries.
+	 */
+	kll_sketch window(uint32_t device, unsigned int ch, int64_t from, int64_t until) const;
+
+	/// Number of buckets held
+	size_t nr_buckets() const { return buckets_.size(); }
+
+	/// Drop buckets that started before @c cutoff
+	void expire(int64_t cutoff);
+
+	/**
+	 * Save all sketches to a file, or load (and merge) them back
+	 *
+	 * The file is written anew and renamed over @c path, so that it is never
+	 * left half-written.
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno)
+	 */
+	bool save(const char *path) const;
+	bool load(const char *path);
+
+private:
+	typedef std::pair<uint32_t, int64_t> key_t;	// (device, bucket start)
+	typedef std::array<kll_sketch, PMS_NR_PM> entry_t;
+
+	entry_t &bucket(uint32_t device, int64_t start);
+
+	int64_t bucket_ms_;
+	uint16_t k_;
+	std::map<key_t, entry_t> buckets_;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_QUANTILE_H_)
@@ -0,0 +1,189 @@
+/**
+ * @file  host/query.cpp
+ * @brief pms-query: aggregate PM archives over a time range, in parallel
+ */
+
+/*
+ * Usage: pms-query [-j threads] [-d device] [-f from] [-u until] [-b bucket]
+ *                  [-p channel:lo[:hi]] [-g device|none] archive...
+ *
+ * Samples in [from, until) (Unix seconds) are grouped into buckets of the
+ * given width (1s/1min/1h/1d, a number of seconds, or "all" for a single
+ * bucket; default 1d, aligned on UTC) and, unless -g none is given, per
+ * device; the rows are printed as CSV as soon as they are final, in time
+ * order. -d may be repeated to select several devices. -p keeps only samples
+ * whose atmospheric PM value of a channel (pm1_0, pm2_5 or pm10) lies within
+ * [lo, hi], and may be repeated as well.
+ *
+ * For example, the daily maximum of PM2.5 at device 3 over a quarter:
+ *
+ *   pms-query -d 3 -f 1735689600 -u 1743465600 -b 1d site.pmsarc
+ *
+ * Archive chunks are pruned through their index, and the rest are scanned on
+ * -j threads (default: one per core); see aggregate.h.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "aggregate.h"
+#include "archive.h"
+
+using namespace pms;
+
+namespace {
+
+const char *const res_names[ROLLUP_NR_RES] = { "1s", "1min", "1h", "1d" };
+const char *const ch_names[PMS_NR_PM] = { "pm1_0", "pm2_5", "pm10" };
+
+// Parse "channel:lo[:hi]"
+bool parse_filter(const char *s, agg_filter *f)
+{
+	const char *colon = std::strchr(s, ':');
+	char *end;
+
+	if (colon == nullptr)
+		return false;
+	for (f->ch = 0; f->ch < PMS_NR_PM; ++f->ch) {
+		if (std::strlen(ch_names[f->ch]) == (size_t)(colon - s) &&
+		    std::strncmp(s, ch_names[f->ch], (size_t)(colon - s)) == 0)
+			break;
+	}
+	if (f->ch == PMS_NR_PM)
+		return false;
+
+	const unsigned long lo = std::strtoul(colon + 1, &end, 0);
+	unsigned long hi = UINT16_MAX;
+
+	if (*end == ':')
+		hi = std::strtoul(end + 1, &end, 0);
+	if (*end != '\0' || lo > hi || hi > UINT16_MAX)
+		return false;
+	f->lo = (uint16_t)lo;
+	f->hi = (uint16_t)hi;
+	return true;
+}
+
+// Parse a bucket width into milliseconds; return -1 if invalid
+int64_t parse_bucket(const char *s)
+{
+	char *end;
+
+	if (std::strcmp(s, "all") == 0)
+		return 0;
+	for (unsigned int r = 0; r < ROLLUP_NR_RES; ++r) {
+		if (std::strcmp(s, res_names[r]) == 0)
+			return rollup_width_ms[r];
+	}
+
+	const long long secs = std::strtoll(s, &end, 0);
+	return (*end == '\0' && secs > 0) ? secs * 1000 : -1;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr,
+		"usage: pms-query [-j threads] [-d device] [-f from] [-u until] "
+		"[-b 1s|1min|1h|1d|secs|all] [-p channel:lo[:hi]] [-g device|none] archive...\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	unsigned int nr_threads = std::max(1u, std::thread::hardware_concurrency());
+	agg_query q;
+	agg_filter f;
+	std::vector<std::unique_ptr<archive_reader>> readers;
+	std::vector<const archive_reader *> archives;
+	agg_stats st;
+	int x;
+
+	q.bucket_ms = rollup_width_ms[ROLLUP_1D];
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'j': nr_threads = (unsigned int)std::max(1L, std::strtol(argv[++x], nullptr, 0)); break;
+		case 'd': q.devices.push_back((uint32_t)std::strtoul(argv[++x], nullptr, 0)); break;
+		case 'f': q.from  = std::strtoll(argv[++x], nullptr, 0) * 1000; break;
+		case 'u': q.until = std::strtoll(argv[++x], nullptr, 0) * 1000; break;
+		case 'b':
+			q.bucket_ms = parse_bucket(argv[++x]);
+			if (q.bucket_ms < 0)
+				usage();
+			break;
+		case 'p':
+			if (!parse_filter(argv[++x], &f))
+				usage();
+			q.filters.push_back(f);
+			break;
+		case 'g':
+			++x;
+			if (std::strcmp(argv[x], "device") == 0)
+				q.by_device = true;
+			else if (std::strcmp(argv[x], "none") == 0)
+				q.by_device = false;
+			else
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	if (x == argc)
+		usage();
+	std::sort(q.devices.begin(), q.devices.end());
+	q.devices.erase(std::unique(q.devices.begin(), q.devices.end()), q.devices.end());
+
+	for (; x < argc; ++x) {
+		readers.emplace_back(new archive_reader);
+		if (!readers.back()->open(argv[x])) {
+			std::fprintf(stderr, "pms-query: %s: %s\n", argv[x], std::strerror(errno));
+			return 1;
+		}
+		archives.push_back(readers.back().get());
+	}
+
+	auto t_begin = std::chrono::steady_clock::now();
+
+	std::printf("ts,device,count,pm1_0_mean,pm1_0_min,pm1_0_max,pm1_0_std,"
+		    "pm2_5_mean,pm2_5_min,pm2_5_max,pm2_5_std,"
+		    "pm10_mean,pm10_min,pm10_max,pm10_std\n");
+	aggregate(archives, q, nr_threads, [](const rollup_row &r) {
+		std::printf("%lld,", (long long)(r.ts_ms / 1000));
+		if (r.device == AGG_ALL_DEVICES)
+			std::printf("all,%" PRIu64, r.count);
+		else
+			std::printf("%u,%" PRIu64, r.device, r.count);
+		for (unsigned int ch = 0; ch < PMS_NR_PM; ++ch)
+			std::printf(",%.2f,%u,%u,%.2f", r.mean(ch), r.min[ch], r.max[ch], r.stddev(ch));
+		std::printf("\n");
+	}, &st);
+	if (std::fflush(stdout) != 0) {
+		std::fprintf(stderr, "pms-query: stdout: %s\n", std::strerror(errno));
+		return 1;
+	}
+
+	std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t_begin;
+	double secs = std::max(dt.count(), 1e-9);
+
+	std::fprintf(stderr,
+		"pms-query: %llu of %llu chunks pruned, %llu samples scanned, %llu matched, "
+		"%llu rows in %.3f s (%.0f samples/s, %u threads, %llu steals)\n",
+		(unsigned long long)st.nr_pruned, (unsigned long long)st.nr_chunks,
+		(unsigned long long)st.nr_scanned, (unsigned long long)st.nr_matched,
+		(unsigned long long)st.nr_rows, secs, st.nr_scanned / secs, nr_threads,
+		(unsigned long long)st.nr_steals);
+	return 0;
+}
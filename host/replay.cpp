@@ -0,0 +1,518 @@
+/**
+ * @file  host/replay.cpp
+ * @brief pms-replay: play captured sensor streams into ptys, for load testing
+ */
+
+/*
+ * Usage: pms-replay [-n devices] [-x speed] [-r rounds] [-w wait_s]
+ *                   [-l list] [-d first_id] capture...
+ *
+ * Each capture is either a raw byte capture (putty.log, with or without
+ * PuTTY's log header) or an archive (see archive.h). Raw captures carry no
+ * timing, so their frames are replayed one per second as the sensor sends
+ * them, each with whatever stray bytes followed it; archives are replayed as
+ * re-encoded PMS5003 frames at their recorded times, one stream per device.
+ *
+ * -n devices (default: one per stream) are simulated, device k playing
+ * stream k modulo the number of streams, each on its own pty; their starts
+ * are spread over one second so that copies of a stream do not all write at
+ * once. The pty paths are printed, and with -l written to a file that
+ * pms-ingest -f accepts, with device identifiers counting from -d (default
+ * 1).
+ *
+ * Time runs -x times faster than recorded (default 1; 0 writes as fast as
+ * the readers take it). Every stream is played -r times (default 1; 0 loops
+ * forever), and replay starts -w seconds (default 2) after the ptys are up.
+ *
+ * Once a second, the write rate, the number of streams the readers are
+ * holding up, and the worst lag behind schedule are printed; a lag that
+ * keeps growing means the reader cannot keep up at that load.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "decode.h"
+
+using namespace pms;
+
+namespace {
+
+/// Time between frames in raw captures, and between rounds
+constexpr int64_t FRAME_PERIOD_MS = 1000;
+
+/// Largest single write, when writing as fast as possible
+constexpr size_t MAX_WRITE = 4096;
+
+/// Longest sleep while some stream is held up, in case no wake-up comes
+constexpr int64_t BLOCKED_POLL_NS = 10 * 1000000;
+
+/// One frame of a stream, and the bytes sent along with it
+struct slice {
+	size_t end;		// Offset past its last byte
+	int64_t t_ms;		// Time from the start of the stream
+};
+
+/// A recorded stream
+struct stream {
+	std::string name;
+	std::vector<uint8_t> bytes;
+	std::vector<slice> slices;
+
+	/// Time between the starts of two rounds
+	int64_t round_ms;
+};
+
+/// One simulated device
+struct device {
+	const stream *src;
+	int master = -1;
+	int slave = -1;
+	std::string path;
+
+	// Position in the stream
+	uint64_t round = 0;
+	size_t next = 0;	// Next slice to send entirely
+	size_t sent = 0;	// Bytes of the current round sent
+
+	int64_t start_ns;	// Start of round 0
+	int64_t blocked_ns = 0;	// When the reader last held it up (0: not held up)
+	bool done = false;
+};
+
+/// Replay-wide counters
+struct replay_stats {
+	uint64_t nr_frames = 0;
+	uint64_t nr_bytes = 0;
+	uint64_t nr_stalls = 0;
+	int64_t max_lag_ns = 0;
+};
+
+volatile std::sig_atomic_t quit = 0;
+
+void on_signal(int)
+{
+	quit = 1;
+}
+
+int64_t clock_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Cut a raw capture into per-frame slices, dropping anything before the first
+bool load_raw(const char *path, const uint8_t *p, size_t len, std::vector<stream> *out)
+{
+	std::vector<size_t> starts;
+	decode_stats st;
+	stream s;
+
+	decode_batch(p, len, len, &st, [&](const pms_frame_t &, size_t off) {
+		starts.push_back(off);
+	});
+	if (starts.empty())
+		return false;
+
+	s.name = path;
+	s.bytes.assign(p + starts.front(), p + len);
+	for (size_t x = 0; x < starts.size(); ++x) {
+		const size_t end = (x + 1 < starts.size()) ? starts[x + 1] : len;
+
+		s.slices.push_back(slice{ end - starts.front(), (int64_t)x * FRAME_PERIOD_MS });
+	}
+	s.round_ms = (int64_t)starts.size() * FRAME_PERIOD_MS;
+	out->push_back(std::move(s));
+	return true;
+}
+
+// Turn every device of an archive into a stream of re-encoded frames
+bool load_archive(const char *path, std::vector<stream> *out)
+{
+	archive_reader ar;
+	const size_t first = out->size();
+	std::unordered_map<uint32_t, size_t> streams;	// device -> index past first
+	std::vector<int64_t> origins;
+
+	if (!ar.open(path))
+		return false;
+	for (uint64_t x = 0; x < ar.header().nr_records; ++x) {
+		const sample &r = ar.records()[x];
+		const auto it = streams.emplace(r.device, origins.size());
+		const size_t k = it.first->second;
+		uint8_t raw[PMS_FRAME_LEN];
+		pms_frame_t f;
+
+		if (it.second) {
+			origins.push_back(r.ts_ms);
+			out->emplace_back();
+			out->back().name = std::string(path) + ":" + std::to_string(r.device);
+		}
+
+		std::memset(&f, 0, sizeof(f));
+		std::memcpy(f.pm_cf1, r.pm_cf1, sizeof(f.pm_cf1));
+		std::memcpy(f.pm_atm, r.pm_atm, sizeof(f.pm_atm));
+		std::memcpy(f.nr_particles, r.nr_particles, sizeof(f.nr_particles));
+		pms_frame_encode(raw, &f);
+
+		stream &s = (*out)[first + k];
+		s.bytes.insert(s.bytes.end(), raw, raw + sizeof(raw));
+		s.slices.push_back(slice{ s.bytes.size(), r.ts_ms - origins[k] });
+	}
+	for (size_t k = first; k < out->size(); ++k)
+		(*out)[k].round_ms = (*out)[k].slices.back().t_ms + FRAME_PERIOD_MS;
+	return out->size() > first;
+}
+
+// Load a capture, telling archives from raw captures by their magic
+bool load(const char *path, std::vector<stream> *out)
+{
+	std::FILE *fp = std::fopen(path, "rb");
+	std::vector<uint8_t> buf;
+	uint8_t tmp[65536];
+	size_t n;
+
+	if (fp == nullptr)
+		return false;
+	while ((n = std::fread(tmp, 1, sizeof(tmp), fp)) > 0)
+		buf.insert(buf.end(), tmp, tmp + n);
+	if (std::ferror(fp)) {
+		std::fclose(fp);
+		return false;
+	}
+	std::fclose(fp);
+
+	if (buf.size() >= sizeof(archive_header) &&
+	    std::memcmp(buf.data(), ARCHIVE_MAGIC, sizeof(archive_header::magic)) == 0)
+		return load_archive(path, out);
+	if (!load_raw(path, buf.data(), buf.size(), out)) {
+		errno = EINVAL;
+		return false;
+	}
+	return true;
+}
+
+// Create a pty in raw mode; the slave side is kept open, so that nothing is
+// echoed or lost while no reader has it open
+bool open_pty(device *d)
+{
+	struct termios tio;
+	const char *name;
+
+	d->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (d->master < 0 || grantpt(d->master) != 0 || unlockpt(d->master) != 0 ||
+	    (name = ptsname(d->master)) == nullptr)
+		return false;
+	d->path = name;
+	d->slave = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (d->slave < 0 || tcgetattr(d->slave, &tio) != 0)
+		return false;
+	cfmakeraw(&tio);
+	return tcsetattr(d->slave, TCSANOW, &tio) == 0;
+}
+
+class replayer {
+public:
+	replayer(std::vector<device> &devs, double speed, uint64_t rounds)
+		: devs_(devs), speed_(speed), rounds_(rounds)
+	{
+	}
+
+	bool run(int64_t start_ns);
+
+private:
+	int64_t due_ns(const device &d, size_t slice) const;
+	bool pump(device &d, int64_t now, int64_t *wake);
+	void report(int64_t now);
+
+	std::vector<device> &devs_;
+	double speed_;
+	uint64_t rounds_;
+	int epfd_ = -1;
+
+	replay_stats total_;
+	replay_stats period_;
+	int64_t period_start_ = 0;
+	int64_t start_ns_ = 0;
+};
+
+// When a slice of the current round is due (speed 0: always)
+int64_t replayer::due_ns(const device &d, size_t slice) const
+{
+	const double t_ms = (double)d.round * (double)d.src->round_ms +
+			    (double)d.src->slices[slice].t_ms;
+
+	return (speed_ > 0.0) ? d.start_ns + (int64_t)(t_ms * 1e6 / speed_) : 0;
+}
+
+// Write whatever is due; return false on a write error
+bool replayer::pump(device &d, int64_t now, int64_t *wake)
+{
+	const stream &s = *d.src;
+
+	while (!d.done) {
+		size_t k = d.next, end;
+
+		if (speed_ > 0.0) {
+			while (k < s.slices.size() && due_ns(d, k) <= now)
+				++k;
+			end = (k > 0) ? s.slices[k - 1].end : 0;
+		} else {
+			end = std::min(s.bytes.size(), d.sent + MAX_WRITE);
+		}
+
+		if (d.sent < end) {
+			const ssize_t n = write(d.master, &s.bytes[d.sent], end - d.sent);
+
+			if (n == 0 || (n < 0 && errno == EAGAIN)) {
+				struct epoll_event ev;
+
+				ev.events   = EPOLLOUT | EPOLLONESHOT;
+				ev.data.u64 = (uint64_t)(&d - devs_.data());
+				epoll_ctl(epfd_, EPOLL_CTL_MOD, d.master, &ev);
+				d.blocked_ns = now;
+				++period_.nr_stalls;
+				break;
+			}
+			if (n < 0)
+				return errno == EINTR;
+			d.sent += (size_t)n;
+			period_.nr_bytes += (uint64_t)n;
+		}
+		while (d.next < s.slices.size() && s.slices[d.next].end <= d.sent) {
+			++d.next;
+			++period_.nr_frames;
+		}
+
+		if (d.next == s.slices.size()) {
+			d.next = 0;
+			d.sent = 0;
+			if (++d.round == rounds_)
+				d.done = true;
+			continue;
+		}
+
+		// Keep writing while behind, until the reader holds us up.
+		const int64_t due = due_ns(d, d.next);
+		if (due > now) {
+			*wake = std::min(*wake, due);
+			break;
+		}
+	}
+
+	// How far behind schedule the unsent part is
+	if (!d.done && speed_ > 0.0 && due_ns(d, d.next) < now)
+		period_.max_lag_ns = std::max(period_.max_lag_ns, now - due_ns(d, d.next));
+	return true;
+}
+
+void replayer::report(int64_t now)
+{
+	const double secs = (double)(now - period_start_) * 1e-9;
+	size_t nr_blocked = 0, nr_done = 0;
+
+	for (const device &d : devs_) {
+		nr_blocked += (d.blocked_ns != 0) ? 1 : 0;
+		nr_done    += d.done ? 1 : 0;
+	}
+	std::fprintf(stderr, "pms-replay: %7.1f s: %.0f frames/s, %.1f KiB/s, %zu/%zu held up, "
+		     "%llu stalls, lag %.1f ms, %zu done\n",
+		     (double)(now - start_ns_) * 1e-9, (double)period_.nr_frames / secs,
+		     (double)period_.nr_bytes / 1024.0 / secs, nr_blocked, devs_.size(),
+		     (unsigned long long)period_.nr_stalls, (double)period_.max_lag_ns * 1e-6,
+		     nr_done);
+
+	total_.nr_frames += period_.nr_frames;
+	total_.nr_bytes  += period_.nr_bytes;
+	total_.nr_stalls += period_.nr_stalls;
+	total_.max_lag_ns = std::max(total_.max_lag_ns, period_.max_lag_ns);
+	period_ = replay_stats();
+	period_start_ = now;
+}
+
+bool replayer::run(int64_t start_ns)
+{
+	struct epoll_event evs[256];
+	bool ok = true;
+
+	epfd_ = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd_ < 0)
+		return false;
+	for (size_t x = 0; x < devs_.size(); ++x) {
+		struct epoll_event ev;
+
+		ev.events   = 0;
+		ev.data.u64 = x;
+		if (epoll_ctl(epfd_, EPOLL_CTL_ADD, devs_[x].master, &ev) != 0)
+			return false;
+	}
+
+	start_ns_ = period_start_ = start_ns;
+	while (!quit) {
+		int64_t now = clock_ns(), wake = now + 1000000000;
+		bool busy = false, left = false;
+
+		for (device &d : devs_) {
+			if (d.done)
+				continue;
+			left = true;
+			// Readers do not always signal room coming back; retry anyway.
+			if (d.blocked_ns != 0 && now - d.blocked_ns < BLOCKED_POLL_NS) {
+				wake = std::min(wake, d.blocked_ns + BLOCKED_POLL_NS);
+				continue;
+			}
+			d.blocked_ns = 0;
+			if (!pump(d, now, &wake)) {
+				std::fprintf(stderr, "pms-replay: %s: %s\n", d.path.c_str(), std::strerror(errno));
+				ok = false;
+				quit = 1;
+				break;
+			}
+			busy |= (speed_ <= 0.0 && d.blocked_ns == 0 && !d.done);
+		}
+		if (!left)
+			break;
+
+		now = clock_ns();
+		if (now - period_start_ >= 1000000000)
+			report(now);
+		wake = std::min(wake, period_start_ + 1000000000);
+
+		const int timeout = busy ? 0 : (int)std::max<int64_t>(0, (wake - now + 999999) / 1000000);
+		const int n = epoll_wait(epfd_, evs, sizeof(evs) / sizeof(evs[0]), timeout);
+
+		for (int x = 0; x < n; ++x)
+			devs_[evs[x].data.u64].blocked_ns = 0;
+	}
+	report(clock_ns());
+	close(epfd_);
+
+	std::fprintf(stderr, "pms-replay: %llu frames, %.1f KiB written, %llu stalls, "
+		     "worst lag %.1f ms\n",
+		     (unsigned long long)total_.nr_frames, (double)total_.nr_bytes / 1024.0,
+		     (unsigned long long)total_.nr_stalls, (double)total_.max_lag_ns * 1e-6);
+	return ok;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr,
+		"usage: pms-replay [-n devices] [-x speed] [-r rounds] [-w wait_s] "
+		"[-l list] [-d first_id] capture...\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	long nr_devices = 0;
+	double speed = 1.0;
+	uint64_t rounds = 1;
+	long wait_s = 2;
+	uint32_t first_id = 1;
+	const char *list_path = nullptr;
+	std::vector<stream> streams;
+	std::vector<device> devs;
+	struct sigaction sa;
+	struct rlimit rl;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'n': nr_devices = std::strtol(argv[++x], nullptr, 0); break;
+		case 'x': speed = std::strtod(argv[++x], nullptr); break;
+		case 'r': rounds = std::strtoull(argv[++x], nullptr, 0); break;
+		case 'w': wait_s = std::strtol(argv[++x], nullptr, 0); break;
+		case 'l': list_path = argv[++x]; break;
+		case 'd': first_id = (uint32_t)std::strtoul(argv[++x], nullptr, 0); break;
+		default:  usage();
+		}
+	}
+	if (x == argc || nr_devices < 0 || speed < 0.0 || wait_s < 0)
+		usage();
+
+	for (; x < argc; ++x) {
+		if (!load(argv[x], &streams)) {
+			std::fprintf(stderr, "pms-replay: %s: %s\n", argv[x],
+				     errno == EINVAL ? "no frames found" : std::strerror(errno));
+			return 1;
+		}
+	}
+	if (nr_devices == 0)
+		nr_devices = (long)streams.size();
+
+	// Two descriptors per device
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	std::FILE *list = nullptr;
+	if (list_path != nullptr && (list = std::fopen(list_path, "w")) == nullptr) {
+		std::fprintf(stderr, "pms-replay: %s: %s\n", list_path, std::strerror(errno));
+		return 1;
+	}
+	devs.resize((size_t)nr_devices);
+	for (size_t k = 0; k < devs.size(); ++k) {
+		device &d = devs[k];
+
+		d.src = &streams[k % streams.size()];
+		if (!open_pty(&d)) {
+			std::fprintf(stderr, "pms-replay: pty %zu: %s\n", k, std::strerror(errno));
+			return 1;
+		}
+		std::printf("%u %s %s\n", first_id + (uint32_t)k, d.path.c_str(), d.src->name.c_str());
+		if (list != nullptr)
+			std::fprintf(list, "%u %s\n", first_id + (uint32_t)k, d.path.c_str());
+	}
+	std::fflush(stdout);
+	if (list != nullptr && std::fclose(list) != 0) {
+		std::fprintf(stderr, "pms-replay: %s: %s\n", list_path, std::strerror(errno));
+		return 1;
+	}
+
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, nullptr);
+	sigaction(SIGTERM, &sa, nullptr);
+
+	// Give readers time to open the ptys; then spread the starts over a
+	// frame period.
+	const int64_t start_ns = clock_ns() + wait_s * 1000000000ll;
+	for (size_t k = 0; k < devs.size(); ++k)
+		devs[k].start_ns = start_ns + (int64_t)(k * FRAME_PERIOD_MS * 1000000 / devs.size());
+	while (!quit && clock_ns() < start_ns)
+		usleep(10000);
+
+	replayer rp(devs, speed, rounds);
+	const bool ok = rp.run(start_ns);
+
+	// Let readers drain what is still queued before the ptys go away.
+	for (long t = 0; !quit && t < wait_s * 100; ++t)
+		usleep(10000);
+	for (device &d : devs) {
+		close(d.master);
+		close(d.slave);
+	}
+	return ok ? 0 : 1;
+}
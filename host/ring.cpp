@@ -0,0 +1,257 @@
+/**
+ * @file  host/ring.cpp
+ * @brief Lock-free fan-out of samples from one producer to many consumers
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ring.h"
+
+namespace pms {
+
+namespace {
+
+// Bytes taken by a ring of the given number of slots
+size_t ring_bytes(uint64_t capacity)
+{
+	return sizeof(ring_header) + (size_t)capacity * sizeof(sample);
+}
+
+// shm_open() names must start with a slash.
+std::string shm_path(const char *name)
+{
+	return (name[0] == '/') ? std::string(name) : "/" + std::string(name);
+}
+
+}	// namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+sample_ring::~sample_ring()
+{
+	close();
+}
+
+bool sample_ring::map(int fd, size_t len, bool writable)
+{
+	void *p = mmap(nullptr, len, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+		       fd < 0 ? (MAP_PRIVATE | MAP_ANONYMOUS) : MAP_SHARED, fd, 0);
+
+	if (p == MAP_FAILED)
+		return false;
+	hdr_     = static_cast<ring_header *>(p);
+	slots_   = reinterpret_cast<sample *>(static_cast<char *>(p) + sizeof(ring_header));
+	map_len_ = len;
+	return true;
+}
+
+// Fill in the header of a freshly mapped (zeroed) ring
+void sample_ring::init(uint64_t capacity)
+{
+	new (hdr_) ring_header;
+	hdr_->version     = RING_VERSION;
+	hdr_->record_size = sizeof(sample);
+	hdr_->capacity    = capacity;
+	hdr_->claimed.store(0, std::memory_order_relaxed);
+	hdr_->published.store(0, std::memory_order_relaxed);
+	mask_ = capacity - 1;
+
+	// Consumers attaching now must not see a half-made header.
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(hdr_->magic, RING_MAGIC, sizeof(hdr_->magic));
+}
+
+bool sample_ring::create(size_t capacity)
+{
+	uint64_t cap = 1;
+
+	if (hdr_ != nullptr || capacity == 0) {
+		errno = EINVAL;
+		return false;
+	}
+	while (cap < capacity)
+		cap <<= 1;
+	if (!map(-1, ring_bytes(cap), true))
+		return false;
+	init(cap);
+	return true;
+}
+
+bool sample_ring::create_shared(const char *name, size_t capacity)
+{
+	const std::string path = shm_path(name);
+	uint64_t cap = 1;
+	int fd;
+
+	if (hdr_ != nullptr || capacity == 0) {
+		errno = EINVAL;
+		return false;
+	}
+	while (cap < capacity)
+		cap <<= 1;
+
+	// A ring left behind by a crash is replaced, not reused.
+	if (shm_unlink(path.c_str()) != 0 && errno != ENOENT)
+		return false;
+	fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, (off_t)ring_bytes(cap)) != 0 || !map(fd, ring_bytes(cap), true)) {
+		const int err = errno;
+
+		::close(fd);
+		shm_unlink(path.c_str());
+		errno = err;
+		return false;
+	}
+	::close(fd);
+	init(cap);
+	shm_name_ = path;
+	return true;
+}
+
+bool sample_ring::open_shared(const char *name)
+{
+	const std::string path = shm_path(name);
+	struct stat st;
+	int fd;
+
+	if (hdr_ != nullptr) {
+		errno = EINVAL;
+		return false;
+	}
+	fd = shm_open(path.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0 || !map(fd, (size_t)st.st_size, false)) {
+		const int err = errno;
+
+		::close(fd);
+		errno = err;
+		return false;
+	}
+	::close(fd);
+
+	const bool valid =
+		map_len_ >= sizeof(ring_header) &&
+		std::memcmp(hdr_->magic, RING_MAGIC, sizeof(hdr_->magic)) == 0 &&
+		hdr_->version == RING_VERSION && hdr_->record_size == sizeof(sample) &&
+		hdr_->capacity != 0 && (hdr_->capacity & (hdr_->capacity - 1)) == 0 &&
+		ring_bytes(hdr_->capacity) <= map_len_;
+
+	if (!valid) {
+		close();
+		errno = EINVAL;
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	mask_ = hdr_->capacity - 1;
+	return true;
+}
+
+void sample_ring::close()
+{
+	if (hdr_ == nullptr)
+		return;
+	munmap(hdr_, map_len_);
+	if (!shm_name_.empty())
+		shm_unlink(shm_name_.c_str());
+	hdr_ = nullptr;
+	slots_ = nullptr;
+	mask_ = 0;
+	map_len_ = 0;
+	shm_name_.clear();
+}
+
+void sample_ring::push(const sample *s, size_t n)
+{
+	const uint64_t cap = mask_ + 1;
+	const uint64_t end = hdr_->published.load(std::memory_order_relaxed) + n;
+
+	// Whatever would be overwritten within this call is skipped.
+	if (n > cap) {
+		s += n - cap;
+		n  = (size_t)cap;
+	}
+	hdr_->claimed.store(end, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	const uint64_t first = (end - n) & mask_;
+	const size_t n1 = (size_t)std::min<uint64_t>(n, cap - first);
+
+	std::memcpy(slots_ + first, s, n1 * sizeof(sample));
+	std::memcpy(slots_, s + n1, (n - n1) * sizeof(sample));
+	hdr_->published.store(end, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+ring_reader::ring_reader(const sample_ring &ring, bool from_oldest)
+	: hdr_(ring.hdr_), slots_(ring.slots_), mask_(ring.mask_)
+{
+	cursor_ = from_oldest ? 0 : hdr_->published.load(std::memory_order_acquire);
+}
+
+const sample *ring_reader::peek(size_t *n, size_t max)
+{
+	const uint64_t head = hdr_->published.load(std::memory_order_acquire);
+	const uint64_t cap = mask_ + 1;
+
+	// Lapped: skip to the oldest sample still kept.
+	if (head - cursor_ > cap) {
+		nr_lost_ += head - cap - cursor_;
+		cursor_ = head - cap;
+	}
+	*n = (size_t)std::min<uint64_t>(std::min<uint64_t>(head - cursor_, cap - (cursor_ & mask_)),
+					 max);
+	return slots_ + (cursor_ & mask_);
+}
+
+size_t ring_reader::consume(size_t n)
+{
+	const uint64_t cap = mask_ + 1;
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	const uint64_t claimed = hdr_->claimed.load(std::memory_order_relaxed);
+	const uint64_t oldest = (claimed > cap) ? claimed - cap : 0;
+	const size_t torn = (oldest > cursor_) ? (size_t)std::min<uint64_t>(n, oldest - cursor_) : 0;
+
+	cursor_  += n;
+	nr_lost_ += torn;
+	nr_read_ += n - torn;
+	return torn;
+}
+
+size_t ring_reader::read(sample *out, size_t max)
+{
+	size_t done = 0, n, torn;
+
+	while (done < max) {
+		const sample *p = peek(&n, max - done);
+
+		if (n == 0)
+			break;
+		std::memcpy(out + done, p, n * sizeof(sample));
+		torn = consume(n);
+		if (torn > 0)
+			std::memmove(out + done, out + done + torn, (n - torn) * sizeof(sample));
+		done += n - torn;
+	}
+	return done;
+}
+
+uint64_t ring_reader::backlog() const
+{
+	return hdr_->published.load(std::memory_order_acquire) - cursor_;
+}
+
+}	// namespace pms
@@ -0,0 +1,203 @@
+/**
+ * @file  host/ring.h
+ * @brief Lock-free fan-out of samples from one producer to many consumers
+ */
+
+/*
+ * A ring holds the latest `capacity' samples, in a power-of-two array of
+ * slots. Its single producer (e.g. pms-ingest, which decodes each frame
+ * once) never waits for anyone: it overwrites the oldest slot whether or not
+ * every consumer got to it. Each consumer keeps its own cursor, which no one
+ * else looks at, and reads slots in place; one that falls more than
+ * `capacity' samples behind skips ahead and counts what it missed, so a slow
+ * consumer costs only itself.
+ *
+ * Shared layout (native byte order, like journals):
+ *
+ *   +----------------------+  offset 0
+ *   | ring_header          |  constants, then the two counters on a cache
+ *   |                      |  line of their own
+ *   +----------------------+  offset sizeof(ring_header)
+ *   | sample[capacity]     |  sample n lives in slot n % capacity
+ *   +----------------------+
+ *
+ * The counters work like a sequence lock over the whole array: the producer
+ * bumps `claimed' before it touches any slot, and `published' once the
+ * samples are in. A consumer reading in place checks `claimed' afterwards;
+ * any sample older than claimed - capacity may have been overwritten while
+ * it was being read, and is reported as lost rather than handed out.
+ *
+ * The ring can live in this process (sample_ring::create()) or in POSIX
+ * shared memory (create_shared() for the producer, open_shared() for
+ * consumers in other processes, which map it read-only).
+ */
+
+#if !defined(EEE192_HOST_RING_H_)
+#define EEE192_HOST_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Magic string at the start of every shared ring
+#define RING_MAGIC		"PMSRING\n"
+
+/// Current ring format revision
+constexpr uint32_t RING_VERSION	= 1;
+
+/// Header of a ring, followed by its slots
+struct ring_header {
+	/// @c RING_MAGIC, without the terminating NUL; set last
+	char     magic[8];
+
+	/// @c RING_VERSION
+	uint32_t version;
+
+	/// Must be equal to @code sizeof(sample) @endcode
+	uint32_t record_size;
+
+	/// Number of slots, a power of two
+	uint64_t capacity;
+
+	/// Number of samples whose slots the producer may be writing to
+	alignas(64) std::atomic<uint64_t> claimed;
+
+	/// Number of samples that may be read
+	std::atomic<uint64_t> published;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+	      "ring counters must be usable across processes");
+static_assert(sizeof(ring_header) % 64 == 0, "slots must start on a cache line");
+
+/// A ring, and its producer side
+class sample_ring {
+public:
+	sample_ring() = default;
+	~sample_ring();
+
+	sample_ring(const sample_ring &) = delete;
+	sample_ring &operator=(const sample_ring &) = delete;
+
+	/**
+	 * Allocate a ring in this process
+	 *
+	 * @param[in]	capacity	Number of slots, rounded up to a power of two
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno)
+	 */
+	bool create(size_t capacity);
+
+	/**
+	 * Create a ring in shared memory, replacing any of the same name
+	 *
+	 * @param[in]	name	Shared memory object (see shm_open(3)); a
+	 *			leading '/' is added if missing
+	 *
+	 * @note
+	 * Consumers still attached to a replaced ring see it stall.
+	 */
+	bool create_shared(const char *name, size_t capacity);
+
+	/// Attach to a ring in shared memory, read-only, as a consumer
+	bool open_shared(const char *name);
+
+	/// Detach; the shared memory object is removed if this process created it
+	void close();
+
+	/// Append one sample (producer only)
+	void push(const sample &s) { push(&s, 1); }
+
+	/// Append samples (producer only); at most the last capacity() are kept
+	void push(const sample *s, size_t n);
+
+	/// Number of slots (0: not open)
+	size_t capacity() const { return hdr_ != nullptr ? (size_t)hdr_->capacity : 0; }
+
+	/// Number of samples pushed so far
+	uint64_t published() const { return hdr_->published.load(std::memory_order_acquire); }
+
+private:
+	friend class ring_reader;
+
+	bool map(int fd, size_t len, bool writable);
+	void init(uint64_t capacity);
+
+	ring_header *hdr_ = nullptr;
+	sample *slots_ = nullptr;
+	uint64_t mask_ = 0;
+	size_t map_len_ = 0;
+
+	// Name of the shared memory object created by this process, if any
+	std::string shm_name_;
+};
+
+/**
+ * Consumer side of a ring, with its own cursor
+ *
+ * @note
+ * Each reader must be used by one thread at a time; any number of readers
+ * may share a ring.
+ */
+class ring_reader {
+public:
+	/**
+	 * @param[in]	ring		Open ring
+	 * @param[in]	from_oldest	Start at the oldest sample kept, rather
+	 *				than at the next one to be pushed
+	 */
+	explicit ring_reader(const sample_ring &ring, bool from_oldest = false);
+
+	/**
+	 * Samples available for reading, in place
+	 *
+	 * @param[out]	n	Number of samples at the returned address, at
+	 *			most @c max (0: none yet)
+	 *
+	 * @note
+	 * The samples stay in the ring, so they may be overwritten while they
+	 * are being read; consume() tells which.
+	 */
+	const sample *peek(size_t *n, size_t max = SIZE_MAX);
+
+	/**
+	 * Move past the first @c n samples of the last peek()
+	 *
+	 * @return	How many of them, from the first, may have been
+	 *		overwritten while they were being read; they count as
+	 *		lost, and whatever was made of them must be discarded
+	 */
+	size_t consume(size_t n);
+
+	/**
+	 * Copy out up to @c max samples, all intact
+	 *
+	 * @return	Number of samples copied (0: none available)
+	 */
+	size_t read(sample *out, size_t max);
+
+	/// Number of samples published but not read yet
+	uint64_t backlog() const;
+
+	/// Number of samples overwritten before this reader got to them
+	uint64_t nr_lost() const { return nr_lost_; }
+
+	/// Number of samples read
+	uint64_t nr_read() const { return nr_read_; }
+
+private:
+	const ring_header *hdr_;
+	const sample *slots_;
+	uint64_t mask_;
+	uint64_t cursor_;
+	uint64_t nr_lost_ = 0;
+	uint64_t nr_read_ = 0;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_RING_H_)
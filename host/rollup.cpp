@@ -0,0 +1,237 @@
+/**
+ * @file  host/rollup.cpp
+ * @brief Incrementally-maintained multi-resolution aggregates of PM samples
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "rollup.h"
+
+namespace pms {
+
+/// Magic string at the start of every saved rollup file
+#define ROLLUP_MAGIC	"PMSROL\r\n"
+
+/// Current rollup file revision
+constexpr uint32_t ROLLUP_VERSION = 1;
+
+/// Expiry is attempted at most this often, in sample time
+constexpr int64_t ROLLUP_EXPIRE_INTERVAL_MS = 10 * 60 * 1000;
+
+/////////////////////////////////////////////////////////////////////////////
+
+double rollup_row::stddev(unsigned int ch) const
+{
+	double m, v;
+
+	if (count == 0)
+		return 0.0;
+	m = mean(ch);
+	v = (double)sum_sq[ch] / count - m*m;
+	return v > 0.0 ? std::sqrt(v) : 0.0;
+}
+
+void rollup_row::merge(const rollup_row &o)
+{
+	if (o.count == 0)
+		return;
+	for (unsigned int x = 0; x < PMS_NR_PM; ++x) {
+		sum[x]    += o.sum[x];
+		sum_sq[x] += o.sum_sq[x];
+		min[x]     = (count == 0) ? o.min[x] : std::min(min[x], o.min[x]);
+		max[x]     = (count == 0) ? o.max[x] : std::max(max[x], o.max[x]);
+	}
+	count += o.count;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+rollup_row &rollup_engine::bucket(rollup_res res, uint32_t device, int64_t ts_ms)
+{
+	const key_t k(device, rollup_bucket_start(ts_ms, rollup_width_ms[res]));
+
+	if (hot_valid_[res] && hot_[res]->first == k)
+		return hot_[res]->second;
+
+	auto it = rows_[res].lower_bound(k);
+	if (it == rows_[res].end() || it->first != k) {
+		rollup_row r{};
+
+		r.device = device;
+		r.ts_ms  = k.second;
+		it = rows_[res].emplace_hint(it, k, r);
+	}
+	hot_[res] = it;
+	hot_valid_[res] = true;
+	return it->second;
+}
+
+void rollup_engine::add(const sample &s)
+{
+	rollup_row one{};
+
+	one.count = 1;
+	for (unsigned int x = 0; x < PMS_NR_PM; ++x) {
+		one.sum[x]    = s.pm_atm[x];
+		one.sum_sq[x] = (uint64_t)s.pm_atm[x] * s.pm_atm[x];
+		one.min[x]    = s.pm_atm[x];
+		one.max[x]    = s.pm_atm[x];
+	}
+
+	watermark_ = std::max(watermark_, s.ts_ms);
+	for (unsigned int r = finest_; r < ROLLUP_NR_RES; ++r) {
+		// Don't resurrect buckets that have already been expired.
+		if (rollup_retention_ms[r] != 0 &&
+		    s.ts_ms < watermark_ - rollup_retention_ms[r])
+			continue;
+		bucket((rollup_res)r, s.device, s.ts_ms).merge(one);
+	}
+
+	if (expired_at_ == INT64_MIN)
+		expired_at_ = watermark_;
+	else if (watermark_ - expired_at_ >= ROLLUP_EXPIRE_INTERVAL_MS)
+		expire();
+}
+
+void rollup_engine::merge(const rollup_engine &o)
+{
+	for (unsigned int r = finest_; r < ROLLUP_NR_RES; ++r) {
+		for (const auto &kv : o.rows_[r])
+			bucket((rollup_res)r, kv.first.first, kv.first.second).merge(kv.second);
+	}
+	watermark_ = std::max(watermark_, o.watermark_);
+}
+
+void rollup_engine::expire()
+{
+	expired_at_ = watermark_;
+	for (unsigned int r = 0; r < ROLLUP_NR_RES; ++r) {
+		const int64_t cutoff = watermark_ - rollup_retention_ms[r];
+
+		if (rollup_retention_ms[r] == 0)
+			continue;
+		for (auto it = rows_[r].begin(); it != rows_[r].end(); ) {
+			if (it->first.second < cutoff)
+				it = rows_[r].erase(it);
+			else
+				++it;
+		}
+		hot_valid_[r] = false;
+	}
+}
+
+size_t rollup_engine::query(std::vector<rollup_row> *out, rollup_res res,
+	uint32_t device, int64_t from, int64_t until) const
+{
+	const level_t &lv = rows_[res];
+	size_t n = 0;
+
+	auto it = lv.lower_bound(key_t(device, rollup_bucket_start(from, rollup_width_ms[res])));
+	for (; it != lv.end() && it->first.first == device && it->first.second < until; ++it) {
+		out->push_back(it->second);
+		++n;
+	}
+	return n;
+}
+
+rollup_res rollup_engine::pick_res(int64_t from, int64_t until, size_t min_rows) const
+{
+	int finest = finest_;
+
+	// A state file written by an ingester has no 1 s buckets, say.
+	while (finest < ROLLUP_NR_RES - 1 && rows_[finest].empty())
+		++finest;
+	for (int r = ROLLUP_NR_RES - 1; r > finest; --r) {
+		const bool retained = rollup_retention_ms[r] == 0 ||
+			from >= watermark_ - rollup_retention_ms[r];
+
+		if (retained && (until - from) / rollup_width_ms[r] >= (int64_t)min_rows)
+			return (rollup_res)r;
+	}
+	return (rollup_res)finest;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool rollup_engine::save(const char *path) const
+{
+	const std::string tmp = std::string(path) + ".tmp";
+	std::FILE *fp = std::fopen(tmp.c_str(), "wb");
+	uint64_t n[ROLLUP_NR_RES];
+	uint32_t hdr[2] = { ROLLUP_VERSION, (uint32_t)sizeof(rollup_row) };
+	bool ok;
+
+	if (fp == nullptr)
+		return false;
+	for (unsigned int r = 0; r < ROLLUP_NR_RES; ++r)
+		n[r] = rows_[r].size();
+
+	ok = std::fwrite(ROLLUP_MAGIC, 8, 1, fp) == 1 &&
+	     std::fwrite(hdr, sizeof(hdr), 1, fp) == 1 &&
+	     std::fwrite(&watermark_, sizeof(watermark_), 1, fp) == 1 &&
+	     std::fwrite(n, sizeof(n), 1, fp) == 1;
+	for (unsigned int r = 0; ok && r < ROLLUP_NR_RES; ++r) {
+		for (const auto &kv : rows_[r]) {
+			if (std::fwrite(&kv.second, sizeof(rollup_row), 1, fp) != 1) {
+				ok = false;
+				break;
+			}
+		}
+	}
+	if (std::fclose(fp) != 0)
+		ok = false;
+	if (ok && std::rename(tmp.c_str(), path) != 0)
+		ok = false;
+	if (!ok) {
+		const int err = errno;
+
+		std::remove(tmp.c_str());
+		errno = err;
+	}
+	return ok;
+}
+
+bool rollup_engine::load(const char *path)
+{
+	std::FILE *fp = std::fopen(path, "rb");
+	char magic[8];
+	uint32_t hdr[2];
+	int64_t wm;
+	uint64_t n[ROLLUP_NR_RES];
+	bool ok;
+
+	if (fp == nullptr)
+		return false;
+	ok = std::fread(magic, sizeof(magic), 1, fp) == 1 &&
+	     std::fread(hdr, sizeof(hdr), 1, fp) == 1 &&
+	     std::fread(&wm, sizeof(wm), 1, fp) == 1 &&
+	     std::fread(n, sizeof(n), 1, fp) == 1 &&
+	     std::memcmp(magic, ROLLUP_MAGIC, sizeof(magic)) == 0 &&
+	     hdr[0] == ROLLUP_VERSION && hdr[1] == sizeof(rollup_row);
+	for (unsigned int r = 0; ok && r < ROLLUP_NR_RES; ++r) {
+		for (uint64_t x = 0; x < n[r]; ++x) {
+			rollup_row row;
+
+			if (std::fread(&row, sizeof(row), 1, fp) != 1) {
+				ok = false;
+				break;
+			}
+			if (r >= finest_)
+				bucket((rollup_res)r, row.device, row.ts_ms).merge(row);
+		}
+	}
+	std::fclose(fp);
+	if (!ok) {
+		errno = EINVAL;
+		return false;
+	}
+	watermark_ = std::max(watermark_, wm);
+	return true;
+}
+
+}	// namespace pms
@@ -0,0 +1,164 @@
+/**
+ * @file  host/rollup.h
+ * @brief Incrementally-maintained multi-resolution aggregates of PM samples
+ */
+
+/*
+ * Every sample updates one bucket at each resolution (1 s, 1 min, 1 h,
+ * 1 day). Buckets hold count/sum/min/max/sum-of-squares per PM channel,
+ * which are all mergeable; hence late or out-of-order samples simply land in
+ * (or re-open) the bucket they belong to, and two engines fed from different
+ * sources can be merged bucket-by-bucket.
+ *
+ * Finer resolutions are only kept for a limited time (see rollup_retention_ms)
+ * so that memory stays bounded on long-running ingesters. An engine may also
+ * leave out the finest ones altogether: two days of 1 s buckets take tens of
+ * megabytes per device, too much for an ingester serving hundreds of them.
+ */
+
+#if !defined(EEE192_HOST_ROLLUP_H_)
+#define EEE192_HOST_ROLLUP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "sample.h"
+
+namespace pms {
+
+/// Available rollup resolutions
+enum rollup_res {
+	ROLLUP_1S = 0,
+	ROLLUP_1MIN,
+	ROLLUP_1H,
+	ROLLUP_1D,
+	ROLLUP_NR_RES
+};
+
+/// Bucket width of each resolution, in milliseconds
+constexpr int64_t rollup_width_ms[ROLLUP_NR_RES] = {
+	1000, 60 * 1000, 3600 * 1000, 86400 * 1000
+};
+
+/// How long buckets of each resolution are kept, in milliseconds (0: forever)
+constexpr int64_t rollup_retention_ms[ROLLUP_NR_RES] = {
+	2 * 86400 * 1000ll,		// 1 s   for 2 days
+	90 * 86400 * 1000ll,		// 1 min for 90 days
+	5 * 366 * 86400 * 1000ll,	// 1 h   for 5 years
+	0				// 1 d   forever
+};
+
+/// Start of the bucket holding ts_ms (rounding towards negative infinity)
+inline int64_t rollup_bucket_start(int64_t ts_ms, int64_t width)
+{
+	const int64_t r = ts_ms % width;
+
+	return ts_ms - (r < 0 ? r + width : r);
+}
+
+/// One bucket of aggregates (atmospheric PM values)
+struct rollup_row {
+	/// Start of the bucket, in milliseconds since the Unix epoch
+	int64_t  ts_ms;
+
+	/// Identifier of the originating board
+	uint32_t device;
+
+	/// Number of samples merged into this bucket
+	uint64_t count;
+
+	/// Per-channel sum
+	uint64_t sum[PMS_NR_PM];
+
+	/// Per-channel sum of squares
+	uint64_t sum_sq[PMS_NR_PM];
+
+	/// Per-channel minimum
+	uint16_t min[PMS_NR_PM];
+
+	/// Per-channel maximum
+	uint16_t max[PMS_NR_PM];
+
+	/// Mean of a channel
+	double mean(unsigned int ch) const { return count ? (double)sum[ch] / count : 0.0; }
+
+	/// Population standard deviation of a channel
+	double stddev(unsigned int ch) const;
+
+	/// Fold another bucket (of the same key) into this one
+	void merge(const rollup_row &o);
+};
+
+/// Multi-resolution rollup engine
+class rollup_engine {
+public:
+	/// Keep every resolution from @c finest up
+	explicit rollup_engine(rollup_res finest = ROLLUP_1S) : finest_(finest) {}
+
+	rollup_engine(const rollup_engine &) = delete;
+	rollup_engine &operator=(const rollup_engine &) = delete;
+
+	/// Add one sample to every resolution kept
+	void add(const sample &s);
+
+	/// Fold all buckets of another engine into this one
+	void merge(const rollup_engine &o);
+
+	/**
+	 * Collect the buckets of one device overlapping [from, until)
+	 *
+	 * @return	Number of rows appended to @c out
+	 */
+	size_t query(std::vector<rollup_row> *out, rollup_res res, uint32_t device,
+		     int64_t from, int64_t until) const;
+
+	/**
+	 * Pick the coarsest resolution that still yields at least @c min_rows
+	 * buckets over [from, until), and that is still retained; failing that,
+	 * the finest one holding any buckets
+	 */
+	rollup_res pick_res(int64_t from, int64_t until, size_t min_rows) const;
+
+	/// Drop buckets that fell out of their retention window
+	void expire();
+
+	/// Number of buckets held at a resolution
+	size_t nr_rows(rollup_res res) const { return rows_[res].size(); }
+
+	/// Latest sample timestamp seen so far
+	int64_t watermark() const { return watermark_; }
+
+	/**
+	 * Save all buckets to a file, or load (and merge) them back
+	 *
+	 * The file is written anew and renamed over @c path, so that it is never
+	 * left half-written. Loading skips resolutions that are not kept.
+	 *
+	 * @return	@c true on success, @c false otherwise (see @c errno)
+	 */
+	bool save(const char *path) const;
+	bool load(const char *path);
+
+private:
+	typedef std::pair<uint32_t, int64_t> key_t;	// (device, bucket start)
+	typedef std::map<key_t, rollup_row> level_t;
+
+	rollup_row &bucket(rollup_res res, uint32_t device, int64_t ts_ms);
+
+	rollup_res finest_;
+	level_t rows_[ROLLUP_NR_RES];
+
+	// Last bucket touched at each resolution; in-order data hits it.
+	level_t::iterator hot_[ROLLUP_NR_RES];
+	bool hot_valid_[ROLLUP_NR_RES] = {};
+
+	int64_t watermark_ = INT64_MIN;
+	int64_t expired_at_ = INT64_MIN;
+};
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_ROLLUP_H_)
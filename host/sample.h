@@ -0,0 +1,101 @@
+/**
+ * @file  host/sample.h
+ * @brief Fixed-size record for one decoded PM reading, shared by the host tools
+ */
+
+#if !defined(EEE192_HOST_SAMPLE_H_)
+#define EEE192_HOST_SAMPLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "../pms.h"
+
+namespace pms {
+
+/// Sample flag: @c pm_cf1 is valid
+constexpr uint16_t SAMPLE_FLAG_CF1		= 0x0001;
+
+/// Sample flag: @c nr_particles is valid
+constexpr uint16_t SAMPLE_FLAG_COUNTS		= 0x0002;
+
+/// Sample flag: decoded from a complete frame with a verified checksum
+constexpr uint16_t SAMPLE_FLAG_CHECKED		= 0x0004;
+
+/// Sample flag: the timestamp was synthesized rather than captured
+constexpr uint16_t SAMPLE_FLAG_TS_SYNTH		= 0x0008;
+
+/// Sample flag: readings were corrected by a calibration curve
+constexpr uint16_t SAMPLE_FLAG_CALIBRATED	= 0x0010;
+
+/// Sample flag: the timestamp was taken by the board, and mapped to wall-clock time
+constexpr uint16_t SAMPLE_FLAG_TS_DEVICE	= 0x0020;
+
+/// Mask of all flags meaning "this came from a full frame"
+constexpr uint16_t SAMPLE_FLAG_FULL_FRAME	=
+	SAMPLE_FLAG_CF1 | SAMPLE_FLAG_COUNTS | SAMPLE_FLAG_CHECKED;
+
+/**
+ * One decoded reading
+ *
+ * @note
+ * This is written verbatim into archives, so its layout must not change
+ * without bumping @c ARCHIVE_VERSION (see archive.h).
+ */
+struct sample {
+	/// Wall-clock time, in milliseconds since the Unix epoch
+	int64_t  ts_ms;
+
+	/// Identifier of the originating board
+	uint32_t device;
+
+	/// Bitmask of @code SAMPLE_FLAG_* @endcode values
+	uint16_t flags;
+
+	/// Mass concentrations (CF=1), in ug/m3
+	uint16_t pm_cf1[PMS_NR_PM];
+
+	/// Mass concentrations (atmospheric environment), in ug/m3
+	uint16_t pm_atm[PMS_NR_PM];
+
+	/// Particle counts per 0.1L of air
+	uint16_t nr_particles[PMS_NR_BINS];
+
+	/// Reserved; always zero
+	uint16_t reserved;
+};
+static_assert(sizeof(sample) == 40, "sample layout is part of the archive format");
+
+/// Fill in a sample from a decoded frame
+inline void sample_from_frame(sample *s, const pms_frame_t *f)
+{
+	std::memcpy(s->pm_cf1, f->pm_cf1, sizeof(s->pm_cf1));
+	std::memcpy(s->pm_atm, f->pm_atm, sizeof(s->pm_atm));
+	std::memcpy(s->nr_particles, f->nr_particles, sizeof(s->nr_particles));
+	s->flags |= SAMPLE_FLAG_FULL_FRAME;
+}
+
+/**
+ * Content fingerprint of a sample, ignoring its timestamp
+ *
+ * @note
+ * This is used to recognize the same reading captured more than once.
+ */
+inline uint64_t sample_fingerprint(const sample *s)
+{
+	// FNV-1a over the measured values
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(s->pm_cf1);
+	const size_t len = offsetof(sample, reserved) - offsetof(sample, pm_cf1);
+	uint64_t h = 0xcbf29ce484222325ull;
+
+	for (size_t x = 0; x < len; ++x) {
+		h ^= p[x];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_SAMPLE_H_)
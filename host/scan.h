@@ -0,0 +1,100 @@
+/**
+ * @file  host/scan.h
+ * @brief Allocation-free helpers for scanning text in place
+ *
+ * All routines take a cursor by reference and advance it only on success,
+ * so that callers can try alternatives without backing up.
+ */
+
+#if !defined(EEE192_HOST_SCAN_H_)
+#define EEE192_HOST_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace pms {
+namespace scan {
+
+/// Find the end of the line starting at @c p (exclusive of any CR/LF)
+inline const char *line_end(const char *p, const char *end)
+{
+	const char *nl = static_cast<const char *>(std::memchr(p, '\n', (size_t)(end - p)));
+
+	return nl != nullptr ? nl : end;
+}
+
+/// Match a literal prefix
+inline bool lit(const char *&p, const char *end, const char *s, size_t n)
+{
+	if ((size_t)(end - p) < n || std::memcmp(p, s, n) != 0)
+		return false;
+	p += n;
+	return true;
+}
+
+/// Skip over spaces and tabs
+inline void skip_ws(const char *&p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+}
+
+/// Skip up to and including the next occurrence of @c c
+inline bool skip_past(const char *&p, const char *end, char c)
+{
+	const char *q = static_cast<const char *>(std::memchr(p, c, (size_t)(end - p)));
+
+	if (q == nullptr)
+		return false;
+	p = q + 1;
+	return true;
+}
+
+/// Parse an unsigned decimal integer of at most nine digits
+inline bool dec(const char *&p, const char *end, uint32_t *v)
+{
+	const char *q = p;
+	uint32_t r = 0;
+
+	while (q < end && (unsigned)(*q - '0') < 10 && (q - p) < 9)
+		r = r*10 + (uint32_t)(*q++ - '0');
+	if (q == p)
+		return false;
+	*v = r;
+	p = q;
+	return true;
+}
+
+/// Value of a hexadecimal digit, or -1 if @c c is not one
+inline int hex_digit(char c)
+{
+	if ((unsigned)(c - '0') < 10)
+		return c - '0';
+	c |= 0x20;
+	if ((unsigned)(c - 'a') < 6)
+		return c - 'a' + 10;
+	return -1;
+}
+
+/// Parse exactly @c n bytes written as pairs of hexadecimal digits
+inline bool hex_bytes(const char *&p, const char *end, uint8_t *out, size_t n)
+{
+	if ((size_t)(end - p) < 2*n)
+		return false;
+	for (size_t x = 0; x < n; ++x) {
+		int hi = hex_digit(p[2*x]);
+		int lo = hex_digit(p[2*x + 1]);
+
+		if (hi < 0 || lo < 0)
+			return false;
+		out[x] = (uint8_t)((hi << 4) | lo);
+	}
+	p += 2*n;
+	return true;
+}
+
+}	// namespace scan
+}	// namespace pms
+
+#endif	// !defined(EEE192_HOST_SCAN_H_)
@@ -0,0 +1,163 @@
+/**
+ * @file  host/tap.cpp
+ * @brief pms-tap: follow the samples pms-ingest shares in a ring
+ */
+
+/*
+ * Usage: pms-tap [-d device] [-n count] [-s new|oldest] ring
+ *
+ * Attaches to the ring that pms-ingest -r publishes (see ring.h) and prints
+ * its samples as CSV, with atmospheric concentrations, as they come in:
+ *
+ *   ts_ms,device,pm1_0,pm2_5,pm10
+ *
+ * Samples are formatted straight from the ring, without copying them out;
+ * any that were overwritten meanwhile are dropped. With -d, only one device
+ * is printed. Reading starts with the next sample pushed, or with -s oldest
+ * at the oldest one still kept, and stops after -n samples (default: on
+ * SIGINT or SIGTERM). Samples lost to falling behind (e.g. to a slow pipe)
+ * are counted on stderr; pms-ingest is never held up.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "ring.h"
+
+using namespace pms;
+
+namespace {
+
+/// Largest number of samples formatted at once
+constexpr size_t TAP_BATCH = 256;
+
+/// Longest line printed, with its terminating NUL
+constexpr size_t TAP_LINE_MAX = 64;
+
+/// Time between polls of an idle ring
+constexpr long TAP_IDLE_NS = 10 * 1000000;
+
+volatile std::sig_atomic_t quit = 0;
+
+void on_signal(int)
+{
+	quit = 1;
+}
+
+void usage(void)
+{
+	std::fprintf(stderr, "usage: pms-tap [-d device] [-n count] [-s new|oldest] ring\n");
+	std::exit(2);
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	static char buf[TAP_BATCH * TAP_LINE_MAX];
+	size_t ends[TAP_BATCH];
+	const char *ring_name;
+	uint32_t device = 0;
+	bool any_device = true;
+	bool from_oldest = false;
+	uint64_t nr_left = UINT64_MAX;
+	uint64_t nr_lost = 0;
+	sample_ring ring;
+	struct sigaction sa;
+	int x;
+
+	for (x = 1; x < argc && argv[x][0] == '-' && argv[x][1] != '\0'; ++x) {
+		if (argv[x][2] != '\0' || x + 1 >= argc)
+			usage();
+		switch (argv[x][1]) {
+		case 'd':
+			device = (uint32_t)std::strtoul(argv[++x], nullptr, 0);
+			any_device = false;
+			break;
+		case 'n': nr_left = std::strtoull(argv[++x], nullptr, 0); break;
+		case 's':
+			++x;
+			if (std::strcmp(argv[x], "oldest") == 0)
+				from_oldest = true;
+			else if (std::strcmp(argv[x], "new") != 0)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	if (x + 1 != argc || nr_left == 0)
+		usage();
+	ring_name = argv[x];
+
+	if (!ring.open_shared(ring_name)) {
+		std::fprintf(stderr, "pms-tap: %s: %s\n", ring_name, std::strerror(errno));
+		return 1;
+	}
+
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, nullptr);
+	sigaction(SIGTERM, &sa, nullptr);
+
+	ring_reader reader(ring, from_oldest);
+
+	std::printf("ts_ms,device,pm1_0,pm2_5,pm10\n");
+	while (!quit && nr_left > 0) {
+		size_t n, len = 0;
+		const sample *p = reader.peek(&n, TAP_BATCH);
+
+		if (n == 0) {
+			const struct timespec idle = { 0, TAP_IDLE_NS };
+
+			if (std::fflush(stdout) != 0)
+				break;
+			nanosleep(&idle, nullptr);
+			continue;
+		}
+
+		// Format in place, one end offset per sample, even those not
+		// printed, so that torn ones can be cut off afterwards.
+		for (size_t k = 0; k < n; ++k) {
+			const sample &s = p[k];
+
+			if (any_device || s.device == device) {
+				const int r = std::snprintf(buf + len, TAP_LINE_MAX, "%lld,%u,%u,%u,%u\n",
+							    (long long)s.ts_ms, s.device, s.pm_atm[0],
+							    s.pm_atm[1], s.pm_atm[2]);
+
+				len += (r > 0) ? std::min((size_t)r, TAP_LINE_MAX - 1) : 0;
+			}
+			ends[k] = len;
+		}
+
+		const size_t torn = reader.consume(n);
+		const size_t begin = (torn > 0) ? ends[torn - 1] : 0;
+		size_t end = begin;
+
+		// Stop at the last line asked for.
+		for (size_t k = torn; k < n && nr_left > 0; ++k) {
+			nr_left -= (ends[k] != end);
+			end = ends[k];
+		}
+		if (std::fwrite(buf + begin, 1, end - begin, stdout) != end - begin)
+			break;
+
+		if (reader.nr_lost() != nr_lost) {
+			std::fprintf(stderr, "pms-tap: %llu samples lost\n",
+				     (unsigned long long)(reader.nr_lost() - nr_lost));
+			nr_lost = reader.nr_lost();
+		}
+	}
+
+	if (std::fflush(stdout) != 0 || std::ferror(stdout)) {
+		std::fprintf(stderr, "pms-tap: stdout: %s\n", std::strerror(errno));
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file  host/trace.cpp
+ * @brief pms-trace: format trace dumps sent by the firmware
+ */
+
+/*
+ * Usage: pms-trace [capture...]
+ *
+ * The board sends a dump of its trace ring (see ../trace.h) when it
+ * receives 't' over the debugger UART, in the middle of whatever else it is
+ * forwarding; e.g.
+ *
+ *   cat /dev/ttyACM0 > capture & printf t > /dev/ttyACM0
+ *
+ * Every dump found in the captures (standard input by default) is printed
+ * as one line per event: time since the first event of the dump and since
+ * the previous one, in microseconds, then the event name and arguments.
+ * Timestamps wrap around every few minutes on the board; a dump is assumed
+ * to span less than that.
+ */
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../trace.h"
+
+namespace {
+
+struct event_desc {
+	const char *name;
+	const char *arg0;
+	const char *arg1;
+};
+
+#define TRACE_EV_DESC_(id, name, arg0, arg1)	{ name, arg0, arg1 },
+const event_desc events[TRACE_NR_EVENTS] = {
+	TRACE_EVENTS(TRACE_EV_DESC_)
+};
+#undef TRACE_EV_DESC_
+
+constexpr size_t HDR_SIZE = 16;
+constexpr size_t REC_SIZE = 12;
+
+static_assert(sizeof(trace_dump_hdr_t) == HDR_SIZE, "dump header layout");
+static_assert(sizeof(trace_rec_t) == REC_SIZE, "trace record layout");
+
+inline uint16_t load16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t load32(const uint8_t *p)
+{
+	return (uint32_t)load16(p) | ((uint32_t)load16(p + 2) << 16);
+}
+
+void print_event(const uint8_t *rec, double t_us, double dt_us)
+{
+	const uint16_t id = load16(rec + 4);
+	const uint16_t arg0 = load16(rec + 6);
+	const uint32_t arg1 = load32(rec + 8);
+
+	std::printf("%12.1f %+10.1f  ", t_us, dt_us);
+	if (id >= TRACE_NR_EVENTS) {
+		std::printf("ev#%u %u %lu\n", id, arg0, (unsigned long)arg1);
+		return;
+	}
+	// Arguments start in a column of their own.
+	int pad = 10 - (int)std::strlen(events[id].name);
+
+	std::printf("%s", events[id].name);
+	if (events[id].arg0[0] != '\0') {
+		std::printf("%*s%s=%u", pad, "", events[id].arg0, arg0);
+		pad = 1;
+	}
+	if (events[id].arg1[0] != '\0')
+		std::printf("%*s%s=%lu", pad, "", events[id].arg1, (unsigned long)arg1);
+	std::printf("\n");
+}
+
+// Print the dump at p, if complete; return the number of bytes it spans
+size_t print_dump(const uint8_t *p, size_t len, unsigned int nr_dump)
+{
+	if (len < HDR_SIZE)
+		return 0;
+
+	const uint8_t version = p[4], rec_size = p[5];
+	const uint16_t nr_recs = load16(p + 6);
+	const uint32_t nr_lost = load32(p + 8);
+	const uint16_t per_us = load16(p + 12);
+	const size_t size = HDR_SIZE + (size_t)nr_recs * rec_size;
+
+	if (version != TRACE_DUMP_VERSION || rec_size < REC_SIZE || per_us == 0) {
+		std::fprintf(stderr, "pms-trace: dump %u: unsupported version %u\n", nr_dump, version);
+		return 4;
+	}
+	if (size > len) {
+		std::fprintf(stderr, "pms-trace: dump %u: truncated\n", nr_dump);
+		return len;
+	}
+
+	std::printf("# dump %u: %u events, %lu lost\n", nr_dump, nr_recs, (unsigned long)nr_lost);
+	const uint8_t *rec = p + HDR_SIZE;
+	uint32_t prev = nr_recs > 0 ? load32(rec) : 0;
+	uint64_t elapsed = 0;
+
+	for (uint16_t x = 0; x < nr_recs; ++x, rec += rec_size) {
+		const uint32_t delta = load32(rec) - prev;	// Wrap-around intentional
+
+		elapsed += delta;
+		prev = load32(rec);
+		print_event(rec, (double)elapsed / per_us, (double)delta / per_us);
+	}
+	return size;
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	std::vector<uint8_t> buf;
+	unsigned int nr_dump = 0;
+	int x = 1;
+
+	do {
+		const char *path = x < argc ? argv[x] : nullptr;
+		std::FILE *fp = path != nullptr ? std::fopen(path, "rb") : stdin;
+		uint8_t chunk[65536];
+		size_t n;
+
+		if (fp == nullptr) {
+			std::fprintf(stderr, "pms-trace: %s: %s\n", path, std::strerror(errno));
+			return 1;
+		}
+		buf.clear();
+		while ((n = std::fread(chunk, 1, sizeof(chunk), fp)) > 0)
+			buf.insert(buf.end(), chunk, chunk + n);
+		if (std::ferror(fp)) {
+			std::fprintf(stderr, "pms-trace: %s: %s\n", path != nullptr ? path : "-",
+				     std::strerror(errno));
+			return 1;
+		}
+		if (fp != stdin)
+			std::fclose(fp);
+
+		// Dumps are interleaved with whatever else the board sends.
+		for (size_t pos = 0; pos + 4 <= buf.size(); ) {
+			const void *m = std::memchr(buf.data() + pos, TRACE_DUMP_MAGIC[0],
+						    buf.size() - pos - 3);
+
+			if (m == nullptr)
+				break;
+			pos = (const uint8_t *)m - buf.data();
+			if (std::memcmp(buf.data() + pos, TRACE_DUMP_MAGIC, 4) != 0) {
+				++pos;
+				continue;
+			}
+			const size_t size = print_dump(buf.data() + pos, buf.size() - pos, ++nr_dump);
+
+			pos += size > 0 ? size : buf.size() - pos;
+		}
+	} while (++x < argc);
+
+	if (nr_dump == 0) {
+		std::fprintf(stderr, "pms-trace: no trace dump found\n");
+		return 1;
+	}
+	return 0;
+}
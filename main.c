@@ -9,10 +9,18 @@
 // Common include for the XC32 compiler
 #include <xc.h>
 #include <string.h>
-#include <stdio.h>
 #include <stdbool.h>
 
 #include "platform.h"
+#include "aqi.h"
+#include "dash.h"
+#include "fmt.h"
+#include "hampel.h"
+#include "pms.h"
+#include "report.h"
+#include "selftest.h"
+#include "stamp.h"
+#include "trace.h"
 
 /////////////////////////////////////////////////////////////////////////////
 
@@ -38,8 +46,178 @@ static const char banner_msg[] =
 "\r\n"
 "Data: ";
 
-static const char ESC_SEQ_KEYP_LINE[] = "\033[12;1H\033[0K";
-static const char ESC_SEQ_IDLE_INF[]  = "\033[20;1H";
+#define ESC_SEQ_KEYP_LINE	"\033[12;1H\033[0K"
+#define ESC_SEQ_IDLE_INF	"\033[20;1H"
+
+/*
+ * Dashboard
+ * 
+ * Instead of forwarding frames, the latest (filtered) readings can be shown
+ * as a live view for a plain serial terminal, below the banner; see dash.h.
+ * The labels go out once, with the banner, and then only the characters
+ * that changed, every PROG_DASH_MS. The cursor is parked on the idle line
+ * after each update.
+ */
+#define PROG_DASH_MS			250
+
+static const char dash_screen[] =
+ESC_SEQ_KEYP_LINE "Live readings; 'd' to forward frames instead"
+"\033[13;3HFrames\033[13;22HBad\033[13;36HClamped\033[13;56HUp\033[13;73Hs"
+"\033[14;9H  PM1.0  PM2.5   PM10"
+"\033[15;3HCF=1\033[15;31Hug/m3"
+"\033[16;3HAtm.\033[16;31Hug/m3"
+"\033[17;3HAQI"
+"\033[18;9H   >0.3   >0.5   >1.0   >2.5   >5.0    >10 um"
+"\033[19;3HCount\033[19;52Hper 0.1L"
+ESC_SEQ_IDLE_INF;
+
+/// Dashboard fields, in dash_layout[] order
+enum prog_dash_field_type {
+	PROG_DASH_FRAMES,
+	PROG_DASH_BAD,
+	PROG_DASH_CLAMPED,
+	PROG_DASH_UPTIME,
+	PROG_DASH_CF1,					// PMS_NR_PM fields
+	PROG_DASH_ATM = PROG_DASH_CF1 + PMS_NR_PM,	// PMS_NR_PM fields
+	PROG_DASH_AQI = PROG_DASH_ATM + PMS_NR_PM,
+	PROG_DASH_CATEGORY,
+	PROG_DASH_COUNT,				// PMS_NR_BINS fields
+	PROG_DASH_NR_FIELDS = PROG_DASH_COUNT + PMS_NR_BINS
+};
+
+static const dash_field_t dash_layout[PROG_DASH_NR_FIELDS] = {
+	[PROG_DASH_FRAMES]   = { 13, 10, 10, DASH_ALIGN_RIGHT },
+	[PROG_DASH_BAD]      = { 13, 26,  8, DASH_ALIGN_RIGHT },
+	[PROG_DASH_CLAMPED]  = { 13, 44,  8, DASH_ALIGN_RIGHT },
+	[PROG_DASH_UPTIME]   = { 13, 59, 13, DASH_ALIGN_RIGHT },
+	[PROG_DASH_CF1 + 0]  = { 15,  9,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_CF1 + 1]  = { 15, 16,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_CF1 + 2]  = { 15, 23,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_ATM + 0]  = { 16,  9,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_ATM + 1]  = { 16, 16,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_ATM + 2]  = { 16, 23,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_AQI]      = { 17,  9,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_CATEGORY] = { 17, 18, 22, DASH_ALIGN_LEFT  },
+	[PROG_DASH_COUNT + 0] = { 19,  9,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_COUNT + 1] = { 19, 16,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_COUNT + 2] = { 19, 23,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_COUNT + 3] = { 19, 30,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_COUNT + 4] = { 19, 37,  7, DASH_ALIGN_RIGHT },
+	[PROG_DASH_COUNT + 5] = { 19, 44,  7, DASH_ALIGN_RIGHT },
+};
+
+static const char *const aqi_cat_names[AQI_NR_CATS] = {
+	[AQI_CAT_GOOD]           = "Good",
+	[AQI_CAT_MODERATE]       = "Moderate",
+	[AQI_CAT_USG]            = "Unhealthy (sensitive)",
+	[AQI_CAT_UNHEALTHY]      = "Unhealthy",
+	[AQI_CAT_VERY_UNHEALTHY] = "Very unhealthy",
+	[AQI_CAT_HAZARDOUS]      = "Hazardous",
+};
+
+#if PROG_DASH_NR_FIELDS > DASH_MAX_FIELDS
+#error "Too many dashboard fields"
+#endif
+
+/*
+ * Change-only reporting
+ * 
+ * If enabled (by default when PROG_CHANGES_ONLY_DEFAULT is set; 'c' toggles
+ * it at run time), PMS frames are decoded on the board and only forwarded when
+ * they differ meaningfully from the last one sent (see report.h); the host
+ * tools cope with any frame rate. Otherwise, received bytes are forwarded
+ * as they came in, but for spikes (see below).
+ * 
+ * Bands are per channel: PM (CF=1) and PM (atmospheric) in ug/m3, then
+ * particle counts per 0.1L; relative bands are in 1/1024ths.
+ * 
+ * Each frame forwarded this way, and each raw chunk that completes one, is
+ * followed by an AQI record (see aqi.h), then by its timestamp record.
+ */
+#define PROG_CHANGES_ONLY_DEFAULT	1
+
+static const report_cfg_t report_cfg = {
+	.abs_band = {  1,  1,  1,  1,  1,  1,  30,  30,  30,  30,  30,  30 },
+	.rel_band = { 51, 51, 51, 51, 51, 51, 102, 102, 102, 102, 102, 102 },
+	.heartbeat_ms = 30000,
+};
+
+/*
+ * Frame timestamps
+ * 
+ * The receiver latches the time at which the first byte of each chunk came
+ * in. The sensor sends a frame back to back, so a frame that ends at byte x
+ * of a chunk began PMS_FRAME_LEN - 1 bytes earlier, PROG_PM_BYTE_NS apart
+ * (10 bits at 9600 bps); normally, that is the very byte latched. Each frame
+ * forwarded in change-only mode, and each raw chunk that completes one, is
+ * followed by a record of when the (last) frame began (see stamp.h), which
+ * the host maps to wall-clock time.
+ */
+#define PROG_PM_BYTE_NS			1041667
+
+/*
+ * Spike rejection
+ * 
+ * PM readings go through a sliding Hampel filter (see hampel.h) before
+ * anything else sees them: outliers beyond 3 standard deviations of the
+ * window (but at least 10 ug/m3 or 25% of its median) are replaced by the
+ * median. Forwarded frames carry the clamped readings, and the flag
+ * AQI_FLAG_CLAMPED in the AQI record that follows. In raw mode, the bytes
+ * of a frame still being received are held back (at most PMS_FRAME_LEN - 1
+ * of them, until the parser completes or rejects it), so that a clamped
+ * frame is always re-encoded before any of it is forwarded.
+ */
+static const hampel_cfg_t hampel_cfg = {
+	.k = 3 * HAMPEL_K_ONE,
+	.abs_band = 10,
+	.rel_band = HAMPEL_REL_ONE / 4,
+};
+
+/*
+ * Transmit batching
+ * 
+ * Whatever is to be forwarded (frames, or raw chunks) is queued into a
+ * batch, which goes out as a single scatter-gather transmission once it
+ * holds PROG_TX_BATCH_FRAMES entries, or once its oldest entry has waited
+ * PROG_TX_BATCH_MS. Two batches are kept, so that one can be filled while
+ * the other is on the wire.
+ * 
+ * NOTE: PROG_TX_BATCH_FRAMES must not exceed the fragment limit of
+ *       platform_usart_cdc_tx_async() (32).
+ */
+#define PROG_TX_BATCH_FRAMES		8
+#define PROG_TX_BATCH_MS		50
+#define PROG_PM_RX_LEN			64	// Largest chunk received from the sensor
+#define PROG_TX_SLOT_LEN		(PROG_PM_RX_LEN + PMS_FRAME_LEN)	// Largest entry (a raw chunk)
+
+/*
+ * AQI indicator
+ * 
+ * Every PROG_LED_PERIOD_MS, the LED blinks once per AQI category, from
+ * once (good) to six times (hazardous); it stays off until a frame has been
+ * decoded.
+ */
+#define PROG_LED_PERIOD_MS		4000
+#define PROG_LED_BLINK_MS		400
+#define PROG_LED_ON_MS			150
+
+/*
+ * Performance levels
+ * 
+ * The board idles at PLATFORM_PERF_LOW; while there is bulk work to do (a
+ * trace dump or a report to produce and send, the self-test running, or a
+ * batch that is half full or more), it is held at PLATFORM_PERF_HIGH, and
+ * for PROG_PERF_HOLD_MS afterwards, so that bursts in quick succession do
+ * not each cost a pair of switches.
+ */
+#define PROG_PERF_HOLD_MS		100
+
+#if PROG_TX_BATCH_FRAMES > 32
+#error "PROG_TX_BATCH_FRAMES exceeds the USART fragment limit"
+#endif
+#if PMS_FRAME_LEN + AQI_RECORD_LEN + STAMP_RECORD_LEN > PROG_TX_SLOT_LEN
+#error "A reported frame and its records do not fit in a batch entry"
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -49,14 +227,23 @@ typedef struct prog_state_type
 	// Flags for this program
 #define PROG_FLAG_BANNER_PENDING        0x0001	// Waiting to transmit the banner
 #define PROG_FLAG_UPDATE_PENDING        0x0002	// Waiting to transmit updates
-#define PROG_FLAG_pm_UPDATE_PENDING	0x0004	// Waiting to transmit updates
+#define PROG_FLAG_CHANGES_ONLY		0x0008	// Forward only frames worth reporting
+#define PROG_FLAG_TRACE_PENDING		0x0010	// Waiting to transmit the trace
+#define PROG_FLAG_TRACE_SENDING		0x0020	// Trace is being transmitted
+#define PROG_FLAG_MEM_PENDING		0x0040	// Waiting to transmit the RAM report
+#define PROG_FLAG_SELFTEST		0x0080	// Generated frames are being injected
+#define PROG_FLAG_SELFTEST_PENDING	0x0100	// Waiting to transmit the self-test report
+#define PROG_FLAG_PERF_PENDING		0x0200	// Waiting to transmit the performance-level report
+#define PROG_FLAG_BOOT_PENDING		0x0400	// Waiting to transmit the boot report
+#define PROG_FLAG_DASHBOARD		0x0800	// Show readings instead of forwarding frames
+#define PROG_FLAG_FILTER_RESET		0x1000	// Forget the self-test's frames once received
 #define PROG_FLAG_GEN_COMPLETE      0x8000	// Message generation has been done, but transmission has not occurred
     
 	uint16_t flags;
 	
 	// Transmit stuff
 	platform_usart_tx_bufdesc_t tx_desc[4];
-	char tx_buf[64];
+	char tx_buf[256];
 	uint16_t tx_blen;
 	
 	// Receiver stuff
@@ -67,10 +254,491 @@ typedef struct prog_state_type
     // Receive from pm
     platform_usart_rx_async_desc_t pm_rx_desc;
     uint16_t pm_rx_desc_blen;
-    char pm_rx_desc_buf[64];
+    char pm_rx_desc_buf[PROG_PM_RX_LEN];
     
+	// Raw mode: the chunk being forwarded, after the bytes held back from
+	// the previous ones (those of the frame the parser is assembling)
+	char raw_buf[PROG_TX_SLOT_LEN];
+	uint16_t raw_held;
+	
+	// Change-only reporting, after spike rejection
+	pms_parser_t pm_parser;
+	hampel_state_t hampel;
+	report_state_t report;
+	
+	// AQI of the latest frame, and its indicator
+	aqi_t aqi;
+	bool aqi_valid;
+	bool led_on;
+	
+	// When the first frame was decoded, in milliseconds since boot
+	uint32_t first_frame_ms;
+	
+	// When the latest frame began, in microseconds since boot
+	uint64_t frame_us;
+	
+	// Latest frame (filtered), and the dashboard showing it
+	pms_frame_t frame;
+	dash_t dash;
+	uint32_t dash_ms;
+	
+	// Transmit batching; batch[tx_fill] is the one being filled
+	struct {
+		platform_usart_tx_bufdesc_t desc[PROG_TX_BATCH_FRAMES];
+		char buf[PROG_TX_BATCH_FRAMES][PROG_TX_SLOT_LEN];
+		uint16_t nr;
+		uint32_t first_ms;	// When the first entry was queued
+	} tx_batch[2];
+	uint8_t tx_fill;
+	uint32_t nr_tx_batches;
+	uint32_t nr_tx_dropped;
+	
+	// Trace dump being transmitted
+	trace_dump_hdr_t trace_hdr;
+	
+	// Peak occupancy of receive buffers and transmit batches
+	uint16_t peak_rx;
+	uint16_t peak_pm_rx;
+	uint16_t peak_tx_batch;
+	
+	// Self-test, and the counters as they were when it started
+	selftest_t selftest;
+	uint32_t selftest_ms;		// Duration, once stopped
+	uint32_t selftest_decoded;
+	uint32_t selftest_rejected;
+	uint32_t selftest_dropped;
+	uint32_t selftest_sent;
+	
 } prog_state_t;
 
+// Milliseconds since platform_init(), wrapping around after ~49 days
+static uint32_t prog_now_ms(void)
+{
+	platform_timespec_t t;
+	
+	platform_tick_count(&t);
+	return (t.nr_sec * 1000) + (t.nr_nsec / 1000000);
+}
+
+// Next free entry of the batch being filled, or NULL if it is full
+static char *prog_batch_slot(prog_state_t *ps)
+{
+	uint16_t nr = ps->tx_batch[ps->tx_fill].nr;
+	
+	return (nr < PROG_TX_BATCH_FRAMES) ? ps->tx_batch[ps->tx_fill].buf[nr] : NULL;
+}
+
+// Queue the entry last returned by prog_batch_slot()
+static void prog_batch_commit(prog_state_t *ps, uint16_t len)
+{
+	uint16_t nr = ps->tx_batch[ps->tx_fill].nr;
+	
+	if (nr == 0)
+		ps->tx_batch[ps->tx_fill].first_ms = prog_now_ms();
+	ps->tx_batch[ps->tx_fill].desc[nr].buf = ps->tx_batch[ps->tx_fill].buf[nr];
+	ps->tx_batch[ps->tx_fill].desc[nr].len = len;
+	ps->tx_batch[ps->tx_fill].nr = nr + 1;
+	if (nr + 1 > ps->peak_tx_batch)
+		ps->peak_tx_batch = nr + 1;
+	trace_event(TRACE_EV_TX_QUEUE, nr + 1, len);
+}
+
+/*
+ * Send the batch being filled, if it is due and the link is free
+ * 
+ * NOTE: The other batch is the one last sent; once the link is free, it is
+ *       no longer needed and becomes the one being filled.
+ */
+static void prog_batch_flush(prog_state_t *ps)
+{
+	uint16_t nr = ps->tx_batch[ps->tx_fill].nr;
+	uint32_t age;
+	
+	if (nr == 0)
+		return;
+	age = prog_now_ms() - ps->tx_batch[ps->tx_fill].first_ms;
+	if (nr < PROG_TX_BATCH_FRAMES && age < PROG_TX_BATCH_MS)
+		return;
+	if (platform_usart_cdc_tx_busy())
+		return;
+	if (!platform_usart_cdc_tx_async(ps->tx_batch[ps->tx_fill].desc, nr))
+		return;
+	
+	trace_event(TRACE_EV_TX_SEND, nr, age);
+	if ((ps->flags & PROG_FLAG_SELFTEST) != 0) {
+		uint32_t now = platform_tick_hrraw();
+		uint16_t x;
+		
+		for (x = 0; x < nr; ++x) {
+			if (ps->tx_batch[ps->tx_fill].desc[x].len >= PMS_FRAME_LEN &&
+			    selftest_account(&ps->selftest,
+					     (const uint8_t *)ps->tx_batch[ps->tx_fill].buf[x], now))
+				++ps->selftest_sent;
+		}
+	}
+	++ps->nr_tx_batches;
+	ps->tx_fill ^= 1;
+	ps->tx_batch[ps->tx_fill].nr = 0;
+}
+
+// When a frame ending at byte x of the received chunk began, in microseconds since boot
+static uint64_t prog_frame_us(const prog_state_t *ps, uint16_t x)
+{
+	platform_timespec_t t = ps->pm_rx_desc.ts_first;
+	uint64_t us = ((uint64_t)t.nr_sec * 1000000) + (t.nr_nsec / 1000);
+	int32_t back_us = (((int32_t)PMS_FRAME_LEN - 1) - x) * (PROG_PM_BYTE_NS / 1000);
+	
+	if (back_us > 0 && us < (uint64_t)back_us)
+		return 0;
+	return us - back_us;
+}
+
+/*
+ * Run received PMS bytes through the decoder, updating the AQI, and (in
+ * change-only mode) queueing the frames worth reporting, or (in raw mode)
+ * appending them to raw_buf, clamping spikes there; return the number of
+ * frames decoded, and whether any was clamped
+ * 
+ * NOTE: If the batch is full, frames are dropped before the deadband sees
+ *       them, so that it stays measured from the last frame actually sent.
+ */
+static uint16_t prog_filter_frames(prog_state_t *ps, bool *any_clamped)
+{
+	const bool raw = (ps->flags & (PROG_FLAG_CHANGES_ONLY | PROG_FLAG_DASHBOARD)) == 0;
+	pms_frame_t frame;
+	uint16_t x, nr = 0;
+	char *slot;
+	bool send, clamped;
+	
+	*any_clamped = false;
+	if (raw)
+		memcpy(ps->raw_buf + ps->raw_held, ps->pm_rx_desc_buf, ps->pm_rx_desc_blen);
+	else
+		ps->raw_held = 0;
+	for (x = 0; x < ps->pm_rx_desc_blen; ++x) {
+		if (!pms_parser_push(&ps->pm_parser, (uint8_t)ps->pm_rx_desc_buf[x], &frame))
+			continue;
+		ps->frame_us = prog_frame_us(ps, x);
+		++nr;
+		clamped = hampel_apply(&ps->hampel, &hampel_cfg, &frame);
+		if (clamped)
+			trace_event(TRACE_EV_CLAMP, frame.pm_atm[1], ps->hampel.nr_clamped);
+		aqi_from_frame(&ps->aqi, &frame);
+		if (clamped)
+			ps->aqi.flags |= AQI_FLAG_CLAMPED;
+		if (ps->first_frame_ms == 0)
+			ps->first_frame_ms = prog_now_ms();
+		ps->aqi_valid = true;
+		ps->frame = frame;
+		*any_clamped = *any_clamped || clamped;
+		// Only a frame begun before raw mode was entered is not all there.
+		if (raw && clamped && ps->raw_held + x + 1 >= PMS_FRAME_LEN)
+			pms_frame_encode((uint8_t *)ps->raw_buf + ps->raw_held + x + 1 - PMS_FRAME_LEN,
+					 &frame);
+		if ((ps->flags & PROG_FLAG_CHANGES_ONLY) == 0)
+			continue;
+		if ((ps->flags & PROG_FLAG_DASHBOARD) != 0)
+			continue;
+		
+		if ((slot = prog_batch_slot(ps)) == NULL) {
+			trace_event(TRACE_EV_TX_DROP, 0, ++ps->nr_tx_dropped);
+			continue;
+		}
+		send = report_check(&ps->report, &report_cfg, &frame, prog_now_ms());
+		trace_event(TRACE_EV_FRAME, frame.pm_atm[1], send);
+		if (!send)
+			continue;
+		if (clamped)
+			pms_frame_encode((uint8_t *)slot, &frame);
+		else
+			memcpy(slot, ps->pm_parser.buf, PMS_FRAME_LEN);
+		aqi_record_encode((uint8_t *)slot + PMS_FRAME_LEN, &ps->aqi);
+		stamp_record_encode((uint8_t *)slot + PMS_FRAME_LEN + AQI_RECORD_LEN, ps->frame_us);
+		prog_batch_commit(ps, PMS_FRAME_LEN + AQI_RECORD_LEN + STAMP_RECORD_LEN);
+	}
+	return nr;
+}
+
+/*
+ * Forget the frames seen so far: restart spike rejection, change-only
+ * reporting and the AQI (and with it the LED), as after a self-test, whose
+ * generated readings would otherwise linger in the median window and AQI
+ */
+static void prog_filter_reset(prog_state_t *ps)
+{
+	hampel_init(&ps->hampel);
+	report_init(&ps->report);
+	ps->aqi_valid = false;
+}
+
+// Render one dashboard field into tx_buf, after n bytes; return the new length
+static uint16_t prog_dash_field(prog_state_t *ps, uint16_t n, uint8_t id, const char *text)
+{
+	return n + dash_field(&ps->dash, &dash_layout[id], id, text,
+			      ps->tx_buf + n, (uint16_t)(sizeof(ps->tx_buf) - n));
+}
+
+// Render the dashboard changes into tx_buf; return its length
+static uint16_t prog_dash_render(prog_state_t *ps)
+{
+	char text[DASH_MAX_WIDTH + 1];
+	uint16_t n = 0;
+	uint8_t x;
+	fmt_t f;
+	
+	dash_begin(&ps->dash);
+	fmt_init(&f, text, sizeof(text));
+	fmt_u32(&f, ps->pm_parser.nr_frames);
+	n = prog_dash_field(ps, n, PROG_DASH_FRAMES, text);
+	fmt_init(&f, text, sizeof(text));
+	fmt_u32(&f, ps->pm_parser.nr_bad_checksum);
+	n = prog_dash_field(ps, n, PROG_DASH_BAD, text);
+	fmt_init(&f, text, sizeof(text));
+	fmt_u32(&f, ps->hampel.nr_clamped);
+	n = prog_dash_field(ps, n, PROG_DASH_CLAMPED, text);
+	fmt_init(&f, text, sizeof(text));
+	fmt_u32(&f, prog_now_ms() / 1000);
+	n = prog_dash_field(ps, n, PROG_DASH_UPTIME, text);
+	if (!ps->aqi_valid)
+		return n;
+	
+	for (x = 0; x < PMS_NR_PM; ++x) {
+		fmt_init(&f, text, sizeof(text));
+		fmt_u32(&f, ps->frame.pm_cf1[x]);
+		n = prog_dash_field(ps, n, PROG_DASH_CF1 + x, text);
+		fmt_init(&f, text, sizeof(text));
+		fmt_u32(&f, ps->frame.pm_atm[x]);
+		n = prog_dash_field(ps, n, PROG_DASH_ATM + x, text);
+	}
+	fmt_init(&f, text, sizeof(text));
+	fmt_u32(&f, ps->aqi.aqi);
+	n = prog_dash_field(ps, n, PROG_DASH_AQI, text);
+	n = prog_dash_field(ps, n, PROG_DASH_CATEGORY, aqi_cat_names[ps->aqi.category]);
+	for (x = 0; x < PMS_NR_BINS; ++x) {
+		fmt_init(&f, text, sizeof(text));
+		fmt_u32(&f, ps->frame.nr_particles[x]);
+		n = prog_dash_field(ps, n, PROG_DASH_COUNT + x, text);
+	}
+	return n;
+}
+
+// Describe RAM usage into tx_buf; return its length
+static uint16_t prog_mem_report(prog_state_t *ps)
+{
+	platform_ram_info_t ram;
+	fmt_t f;
+	
+	platform_ram_info(&ram);
+	fmt_init(&f, ps->tx_buf, sizeof(ps->tx_buf));
+	if (ram.stack_avail != 0) {
+		fmt_lit(&f, "\r\nstack: ");
+		fmt_u32(&f, ram.stack_peak);
+		fmt_lit(&f, " of ");
+		fmt_u32(&f, ram.stack_avail);
+		fmt_lit(&f, " bytes at peak\r\n");
+	} else {
+		fmt_lit(&f, "\r\nstack: not measured\r\n");
+	}
+	fmt_lit(&f, "ram: prog ");
+	fmt_u32(&f, sizeof(*ps));
+	fmt_lit(&f, " (stack), trace ");
+	fmt_u32(&f, trace_ram_size());
+	fmt_lit(&f, ", usart ");
+	fmt_u32(&f, ram.usart);
+	fmt_lit(&f, ", pm_usart ");
+	fmt_u32(&f, ram.pm_usart);
+	fmt_lit(&f, ", systick ");
+	fmt_u32(&f, ram.systick);
+	fmt_lit(&f, ", gpio ");
+	fmt_u32(&f, ram.gpio);
+	fmt_lit(&f, ", power ");
+	fmt_u32(&f, ram.power);
+	fmt_lit(&f, "\r\npeak: rx ");
+	fmt_u32(&f, ps->peak_rx);
+	fmt_char(&f, '/');
+	fmt_u32(&f, sizeof(ps->rx_desc_buf));
+	fmt_lit(&f, ", pm rx ");
+	fmt_u32(&f, ps->peak_pm_rx);
+	fmt_char(&f, '/');
+	fmt_u32(&f, sizeof(ps->pm_rx_desc_buf));
+	fmt_lit(&f, ", tx batch ");
+	fmt_u32(&f, ps->peak_tx_batch);
+	fmt_char(&f, '/');
+	fmt_u32(&f, PROG_TX_BATCH_FRAMES);
+	fmt_lit(&f, " (");
+	fmt_u32(&f, ps->nr_tx_dropped);
+	fmt_lit(&f, " dropped)\r\n");
+	return f.len;
+}
+
+// Describe the time spent at each performance level into tx_buf; return its length
+static uint16_t prog_perf_report(prog_state_t *ps)
+{
+	platform_perf_stats_t st;
+	uint32_t total;
+	fmt_t f;
+	
+	platform_perf_stats(&st);
+	total = st.ms[PLATFORM_PERF_LOW] + st.ms[PLATFORM_PERF_HIGH];
+	if (total == 0)
+		total = 1;
+	fmt_init(&f, ps->tx_buf, sizeof(ps->tx_buf));
+	fmt_lit(&f, "\r\nperf: low ");
+	fmt_u32(&f, st.ms[PLATFORM_PERF_LOW]);
+	fmt_lit(&f, " ms, high ");
+	fmt_u32(&f, st.ms[PLATFORM_PERF_HIGH]);
+	fmt_lit(&f, " ms (");
+	fmt_fixed(&f, (int32_t)(((uint64_t)st.ms[PLATFORM_PERF_HIGH] * 1000) / total), 1);
+	fmt_lit(&f, "%), ");
+	fmt_u32(&f, st.nr_switches);
+	fmt_lit(&f, " switches\r\n");
+	return f.len;
+}
+
+// Describe the boot-time profile into tx_buf; return its length
+static uint16_t prog_boot_report(prog_state_t *ps)
+{
+	static const char *const stage_names[PLATFORM_NR_BOOT] = {
+		[PLATFORM_BOOT_CLOCK_REQ]  = "clk req",
+		[PLATFORM_BOOT_PERIPH]     = "periph",
+		[PLATFORM_BOOT_CLOCK_WAIT] = "clk wait",
+		[PLATFORM_BOOT_CLOCK_DFLL] = "dfll",
+		[PLATFORM_BOOT_STACK]      = "stack",
+		[PLATFORM_BOOT_DONE]       = "irq",
+	};
+	platform_boot_info_t boot;
+	uint32_t prev = 0;
+	uint8_t x;
+	fmt_t f;
+	
+	platform_boot_info(&boot);
+	fmt_init(&f, ps->tx_buf, sizeof(ps->tx_buf));
+	fmt_lit(&f, "\r\nboot: reset cause 0x");
+	fmt_hex(&f, boot.rcause, 2);
+	fmt_char(&f, ',');
+	for (x = 0; x < PLATFORM_NR_BOOT; ++x) {
+		fmt_char(&f, ' ');
+		fmt_str(&f, stage_names[x]);
+		fmt_char(&f, ' ');
+		fmt_u32(&f, boot.stage_us[x] - prev);
+		prev = boot.stage_us[x];
+	}
+	fmt_lit(&f, " us, total ");
+	fmt_u32(&f, prev);
+	fmt_lit(&f, " us\r\n");
+	if (ps->first_frame_ms != 0) {
+		fmt_lit(&f, "first frame: ");
+		fmt_u32(&f, ps->first_frame_ms);
+		fmt_lit(&f, " ms\r\n");
+	}
+	return f.len;
+}
+
+// Hold the high performance level while there is bulk work to do
+static void prog_perf_update(prog_state_t *ps)
+{
+	const uint16_t bulk = PROG_FLAG_TRACE_PENDING | PROG_FLAG_TRACE_SENDING |
+		PROG_FLAG_MEM_PENDING | PROG_FLAG_SELFTEST |
+		PROG_FLAG_SELFTEST_PENDING | PROG_FLAG_PERF_PENDING |
+		PROG_FLAG_BOOT_PENDING;
+	
+	if ((ps->flags & bulk) != 0 ||
+	    ps->tx_batch[ps->tx_fill].nr >= (PROG_TX_BATCH_FRAMES / 2))
+		platform_perf_boost(PROG_PERF_HOLD_MS);
+}
+
+// Drive the LED as an AQI category indicator
+static void prog_led_update(prog_state_t *ps)
+{
+	uint32_t phase = prog_now_ms() % PROG_LED_PERIOD_MS;
+	bool on = false;
+	
+	if (ps->aqi_valid && (phase / PROG_LED_BLINK_MS) <= ps->aqi.category)
+		on = (phase % PROG_LED_BLINK_MS) < PROG_LED_ON_MS;
+	
+	if (on != ps->led_on) {
+		platform_gpo_modify(on ? PLATFORM_GPO_LED_ONBOARD : 0,
+				    on ? 0 : PLATFORM_GPO_LED_ONBOARD);
+		ps->led_on = on;
+	}
+}
+
+/*
+ * Start or stop the self-test
+ * 
+ * The argument is "<rate>[/<percent damaged>]" to start (or restart), and
+ * empty to stop and report.
+ */
+static void prog_selftest_command(prog_state_t *ps, const char *arg, uint16_t len)
+{
+	uint32_t rate = 0, pct = 0, *v = &rate;
+	uint16_t x;
+	
+	for (x = 0; x < len; ++x) {
+		if (arg[x] >= '0' && arg[x] <= '9' && *v < 1000000)
+			*v = (*v * 10) + (uint32_t)(arg[x] - '0');
+		else if (arg[x] == '/')
+			v = &pct;
+		else
+			break;
+	}
+	
+	if (rate == 0) {
+		if ((ps->flags & PROG_FLAG_SELFTEST) != 0) {
+			ps->selftest_ms = prog_now_ms() - ps->selftest.start_ms;
+			ps->flags &= ~PROG_FLAG_SELFTEST;
+			ps->flags |= PROG_FLAG_SELFTEST_PENDING | PROG_FLAG_FILTER_RESET;
+		}
+		return;
+	}
+	
+	selftest_start(&ps->selftest, rate, (uint8_t)((pct > 100) ? 100 : pct), prog_now_ms());
+	ps->selftest_decoded  = ps->pm_parser.nr_frames;
+	ps->selftest_rejected = ps->pm_parser.nr_bad_checksum;
+	ps->selftest_dropped  = ps->nr_tx_dropped;
+	ps->selftest_sent     = 0;
+	ps->flags |= PROG_FLAG_SELFTEST;
+}
+
+// Describe the last self-test into tx_buf; return its length
+static uint16_t prog_selftest_report(prog_state_t *ps)
+{
+	const selftest_t *st = &ps->selftest;
+	uint32_t ms = (ps->selftest_ms != 0) ? ps->selftest_ms : 1;
+	fmt_t f;
+	
+	fmt_init(&f, ps->tx_buf, sizeof(ps->tx_buf));
+	fmt_lit(&f, "\r\nselftest: ");
+	fmt_u32(&f, st->nr_frames);
+	fmt_lit(&f, " frames (");
+	fmt_u32(&f, st->nr_corrupt);
+	fmt_lit(&f, " damaged) in ");
+	fmt_u32(&f, ps->selftest_ms);
+	fmt_lit(&f, " ms, ");
+	fmt_u32(&f, (uint32_t)(((uint64_t)st->nr_frames * 1000) / ms));
+	fmt_lit(&f, "/s of ");
+	fmt_u32(&f, st->rate);
+	fmt_lit(&f, "/s\r\npipeline: ");
+	fmt_u32(&f, ps->pm_parser.nr_frames - ps->selftest_decoded);
+	fmt_lit(&f, " decoded, ");
+	fmt_u32(&f, ps->pm_parser.nr_bad_checksum - ps->selftest_rejected);
+	fmt_lit(&f, " rejected, ");
+	fmt_u32(&f, ps->selftest_sent);
+	fmt_lit(&f, " sent, ");
+	fmt_u32(&f, ps->nr_tx_dropped - ps->selftest_dropped);
+	fmt_lit(&f, " dropped\r\n");
+	if (st->nr_latency != 0) {
+		fmt_lit(&f, "latency: ");
+		fmt_u32(&f, st->latency_min / PLATFORM_TICK_HRRAW_PER_US);
+		fmt_char(&f, '/');
+		fmt_u32(&f, (uint32_t)(st->latency_sum / st->nr_latency / PLATFORM_TICK_HRRAW_PER_US));
+		fmt_char(&f, '/');
+		fmt_u32(&f, st->latency_max / PLATFORM_TICK_HRRAW_PER_US);
+		fmt_lit(&f, " us min/avg/max\r\n");
+	}
+	return f.len;
+}
+
 /*
  * Initialize the main program state
  * 
@@ -82,6 +750,7 @@ static void prog_setup(prog_state_t *ps)
 	memset(ps, 0, sizeof(*ps));
 	
 	platform_init();
+	trace_init();
 	
     // SERCOM3 - Keyb + PIC32
     
@@ -96,6 +765,13 @@ static void prog_setup(prog_state_t *ps)
     ps->pm_rx_desc.max_len = sizeof(ps->pm_rx_desc_buf);
     
     pm_platform_usart_cdc_rx_async(&ps->pm_rx_desc);
+    
+	pms_parser_init(&ps->pm_parser);
+	hampel_init(&ps->hampel);
+	report_init(&ps->report);
+#if PROG_CHANGES_ONLY_DEFAULT
+	ps->flags |= PROG_FLAG_CHANGES_ONLY;
+#endif
 	return;
 }
 
@@ -116,7 +792,7 @@ static void prog_loop_one(prog_state_t *ps)
 	// Something happened to the pushbutton?
 	if ((a = platform_pb_get_event()) != 0) {
 		if ((a & PLATFORM_PB_ONBOARD_PRESS) != 0) {
-			// Print out the banner
+			// Print out the banner (and repaint the dashboard, if shown)
 			ps->flags |= PROG_FLAG_BANNER_PENDING;
 		}
 		a = 0;
@@ -136,44 +812,251 @@ static void prog_loop_one(prog_state_t *ps)
 			// Message has not been generated.
 			ps->tx_desc[0].buf = banner_msg;
 			ps->tx_desc[0].len = sizeof(banner_msg)-1;
+			ps->tx_desc[1].buf = dash_screen;
+			ps->tx_desc[1].len = sizeof(dash_screen)-1;
 			ps->flags |= PROG_FLAG_GEN_COMPLETE;
 		}
 		
-		if (platform_usart_cdc_tx_async(&ps->tx_desc[0], 1)) {
+		if (platform_usart_cdc_tx_async(&ps->tx_desc[0],
+				((ps->flags & PROG_FLAG_DASHBOARD) != 0) ? 2 : 1)) {
 			ps->flags &= ~(PROG_FLAG_BANNER_PENDING | PROG_FLAG_GEN_COMPLETE);
+			dash_invalidate(&ps->dash);
 		}
 	} while (0);
 	
-    // Something from the SERCOM0 UART?
-	if (ps->pm_rx_desc.compl_type == PLATFORM_USART_RX_COMPL_DATA) {
-        PORT_SEC_REGS->GROUP[0].PORT_OUTSET = (1 << 15);
-        ps->flags |= PROG_FLAG_pm_UPDATE_PENDING;
-        ps->pm_rx_desc_blen = ps->pm_rx_desc.compl_info.data_len;
-    }
-    
-    // Process any pending pm update flags
-    do {
-		if ((ps->flags & PROG_FLAG_pm_UPDATE_PENDING) == 0)
+	/*
+	 * Something from the SERCOM3 UART?
+	 * 
+	 * - 't' requests a trace dump
+	 * - 'm' requests a RAM report
+	 * - 's' starts or stops the self-test (see prog_selftest_command())
+	 * - 'p' requests a report of the time spent at each performance level
+	 * - 'b' requests the boot-time profile
+	 * - 'd' switches between the dashboard and forwarding frames
+	 * - 'c' switches between change-only and raw forwarding
+	 */
+	if (ps->rx_desc.compl_type == PLATFORM_USART_RX_COMPL_DATA) {
+		const char *cmd;
+		
+		ps->rx_desc_blen = ps->rx_desc.compl_info.data_len;
+		if (ps->rx_desc_blen > ps->peak_rx)
+			ps->peak_rx = ps->rx_desc_blen;
+		trace_event(TRACE_EV_CDC_RX, ps->rx_desc_blen, (uint8_t)ps->rx_desc_buf[0]);
+		if (memchr(ps->rx_desc_buf, 't', ps->rx_desc_blen) != NULL)
+			ps->flags |= PROG_FLAG_TRACE_PENDING;
+		if (memchr(ps->rx_desc_buf, 'm', ps->rx_desc_blen) != NULL)
+			ps->flags |= PROG_FLAG_MEM_PENDING;
+		if (memchr(ps->rx_desc_buf, 'p', ps->rx_desc_blen) != NULL)
+			ps->flags |= PROG_FLAG_PERF_PENDING;
+		if (memchr(ps->rx_desc_buf, 'b', ps->rx_desc_blen) != NULL)
+			ps->flags |= PROG_FLAG_BOOT_PENDING;
+		if (memchr(ps->rx_desc_buf, 'd', ps->rx_desc_blen) != NULL) {
+			ps->flags ^= PROG_FLAG_DASHBOARD;
+			ps->flags |= PROG_FLAG_BANNER_PENDING;
+		}
+		if (memchr(ps->rx_desc_buf, 'c', ps->rx_desc_blen) != NULL)
+			ps->flags ^= PROG_FLAG_CHANGES_ONLY;
+		if ((cmd = memchr(ps->rx_desc_buf, 's', ps->rx_desc_blen)) != NULL) {
+			++cmd;
+			prog_selftest_command(ps, cmd,
+				ps->rx_desc_blen - (uint16_t)(cmd - ps->rx_desc_buf));
+		}
+		
+		ps->rx_desc.compl_type = PLATFORM_USART_RX_COMPL_NONE;
+		platform_usart_cdc_rx_async(&ps->rx_desc);
+	}
+	prog_perf_update(ps);
+	
+	// Update the dashboard (after the banner has drawn its labels)
+	do {
+		uint16_t n;
+		
+		if ((ps->flags & PROG_FLAG_DASHBOARD) == 0)
+			break;
+		
+		if ((ps->flags & PROG_FLAG_BANNER_PENDING) != 0)
+			break;
+		
+		if ((uint32_t)(prog_now_ms() - ps->dash_ms) < PROG_DASH_MS)
 			break;
 		
 		if (platform_usart_cdc_tx_busy())
 			break;
 		
-		if ((ps->flags & PROG_FLAG_GEN_COMPLETE) == 0) {
-            PORT_SEC_REGS->GROUP[0].PORT_OUTCLR = (1 << 15);
-            
-            
-			ps->tx_desc[0].buf = ps->pm_rx_desc_buf;
-			ps->tx_desc[0].len = ps->pm_rx_desc_blen;
+		ps->dash_ms = prog_now_ms();
+		if ((n = prog_dash_render(ps)) == 0)
+			break;
+		
+		// Park the cursor out of the way.
+		if (n + sizeof(ESC_SEQ_IDLE_INF) - 1 <= sizeof(ps->tx_buf)) {
+			memcpy(ps->tx_buf + n, ESC_SEQ_IDLE_INF, sizeof(ESC_SEQ_IDLE_INF) - 1);
+			n += sizeof(ESC_SEQ_IDLE_INF) - 1;
+		}
+		ps->tx_desc[0].buf = ps->tx_buf;
+		ps->tx_desc[0].len = n;
+		if (!platform_usart_cdc_tx_async(&ps->tx_desc[0], 1))
+			dash_invalidate(&ps->dash);
+	} while (0);
+	
+	// Send the trace (after the banner, before any other update)
+	do {
+		const trace_rec_t *frag[2];
+		uint16_t len[2];
+		
+		if ((ps->flags & (PROG_FLAG_TRACE_PENDING | PROG_FLAG_TRACE_SENDING)) == 0)
+			break;
+		
+		if (platform_usart_cdc_tx_busy())
+			break;
+		
+		if ((ps->flags & PROG_FLAG_TRACE_SENDING) != 0) {
+			// Done; the ring may be written again.
+			ps->flags &= ~PROG_FLAG_TRACE_SENDING;
+			trace_thaw();
+			trace_event(TRACE_EV_DUMP, ps->trace_hdr.nr_recs, 0);
+			break;
 		}
 		
-		if (platform_usart_cdc_tx_async(&ps->tx_desc, 1)) {
-			ps->pm_rx_desc.compl_type = PLATFORM_USART_RX_COMPL_NONE;
-			pm_platform_usart_cdc_rx_async(&ps->pm_rx_desc);
-			ps->flags &= ~(PROG_FLAG_pm_UPDATE_PENDING | PROG_FLAG_GEN_COMPLETE);
+		trace_freeze(&ps->trace_hdr, frag, len);
+		ps->tx_desc[0].buf = (const char *)&ps->trace_hdr;
+		ps->tx_desc[0].len = sizeof(ps->trace_hdr);
+		ps->tx_desc[1].buf = (const char *)frag[0];
+		ps->tx_desc[1].len = len[0];
+		ps->tx_desc[2].buf = (const char *)frag[1];
+		ps->tx_desc[2].len = len[1];
+		if (platform_usart_cdc_tx_async(&ps->tx_desc[0], 3)) {
+			ps->flags &= ~PROG_FLAG_TRACE_PENDING;
+			ps->flags |= PROG_FLAG_TRACE_SENDING;
 		}
 	} while (0);
 	
+	// Send the RAM report
+	do {
+		if ((ps->flags & PROG_FLAG_MEM_PENDING) == 0)
+			break;
+		
+		if (platform_usart_cdc_tx_busy())
+			break;
+		
+		ps->tx_desc[0].buf = ps->tx_buf;
+		ps->tx_desc[0].len = prog_mem_report(ps);
+		if (platform_usart_cdc_tx_async(&ps->tx_desc[0], 1))
+			ps->flags &= ~PROG_FLAG_MEM_PENDING;
+	} while (0);
+	
+	// Send the self-test report
+	do {
+		if ((ps->flags & PROG_FLAG_SELFTEST_PENDING) == 0)
+			break;
+		
+		if (platform_usart_cdc_tx_busy())
+			break;
+		
+		ps->tx_desc[0].buf = ps->tx_buf;
+		ps->tx_desc[0].len = prog_selftest_report(ps);
+		if (platform_usart_cdc_tx_async(&ps->tx_desc[0], 1))
+			ps->flags &= ~PROG_FLAG_SELFTEST_PENDING;
+	} while (0);
+	
+	// Send the performance-level report
+	do {
+		if ((ps->flags & PROG_FLAG_PERF_PENDING) == 0)
+			break;
+		
+		if (platform_usart_cdc_tx_busy())
+			break;
+		
+		ps->tx_desc[0].buf = ps->tx_buf;
+		ps->tx_desc[0].len = prog_perf_report(ps);
+		if (platform_usart_cdc_tx_async(&ps->tx_desc[0], 1))
+			ps->flags &= ~PROG_FLAG_PERF_PENDING;
+	} while (0);
+	
+	// Send the boot report
+	do {
+		if ((ps->flags & PROG_FLAG_BOOT_PENDING) == 0)
+			break;
+		
+		if (platform_usart_cdc_tx_busy())
+			break;
+		
+		ps->tx_desc[0].buf = ps->tx_buf;
+		ps->tx_desc[0].len = prog_boot_report(ps);
+		if (platform_usart_cdc_tx_async(&ps->tx_desc[0], 1))
+			ps->flags &= ~PROG_FLAG_BOOT_PENDING;
+	} while (0);
+	
+	// Self-test: feed whatever is due to the SERCOM0 receiver
+	if ((ps->flags & PROG_FLAG_SELFTEST) != 0) {
+		const uint8_t *p;
+		uint16_t len, n;
+		
+		do {
+			p = selftest_pending(&ps->selftest, prog_now_ms(), &len);
+			n = pm_platform_usart_rx_inject((const char *)p, len);
+			selftest_consume(&ps->selftest, n, platform_tick_hrraw());
+		} while (n != 0 && n == len);
+	}
+	
+    // Something from the SERCOM0 UART?
+	if (ps->pm_rx_desc.compl_type == PLATFORM_USART_RX_COMPL_DATA) {
+        char *slot;
+        uint16_t nr_frames;
+        bool clamped;
+        
+        ps->pm_rx_desc_blen = ps->pm_rx_desc.compl_info.data_len;
+        if (ps->pm_rx_desc_blen > ps->peak_pm_rx)
+            ps->peak_pm_rx = ps->pm_rx_desc_blen;
+        trace_event(TRACE_EV_PM_RX, ps->pm_rx_desc_blen, 0);
+        nr_frames = prog_filter_frames(ps, &clamped);
+        
+        // The last injected bytes came in with this chunk, if still in flight.
+        if ((ps->flags & PROG_FLAG_FILTER_RESET) != 0) {
+            prog_filter_reset(ps);
+            ps->flags &= ~PROG_FLAG_FILTER_RESET;
+        }
+        if ((ps->flags & (PROG_FLAG_CHANGES_ONLY | PROG_FLAG_DASHBOARD)) == 0) {
+            // Raw mode: forward the (clamped) bytes, but for those of a frame
+            // not complete yet, then the AQI and when the last frame began
+            uint16_t len = ps->raw_held + ps->pm_rx_desc_blen;
+            uint16_t held = (ps->pm_parser.idx < len) ? ps->pm_parser.idx : len;
+            
+            if (len == held) {
+                // Nothing to send yet
+            } else if ((slot = prog_batch_slot(ps)) != NULL) {
+                memcpy(slot, ps->raw_buf, len - held);
+                prog_batch_commit(ps, len - held);
+            } else {
+                trace_event(TRACE_EV_TX_DROP, 0, ++ps->nr_tx_dropped);
+            }
+            memmove(ps->raw_buf, ps->raw_buf + len - held, held);
+            ps->raw_held = held;
+            if (nr_frames == 0) {
+                // No frame ended in this chunk
+            } else if ((slot = prog_batch_slot(ps)) != NULL) {
+                aqi_t aqi = ps->aqi;
+                
+                if (clamped)
+                    aqi.flags |= AQI_FLAG_CLAMPED;
+                aqi_record_encode((uint8_t *)slot, &aqi);
+                stamp_record_encode((uint8_t *)slot + AQI_RECORD_LEN, ps->frame_us);
+                prog_batch_commit(ps, AQI_RECORD_LEN + STAMP_RECORD_LEN);
+            } else {
+                trace_event(TRACE_EV_TX_DROP, 0, ++ps->nr_tx_dropped);
+            }
+        }
+        
+        // Everything was copied out; receive the next bytes right away.
+        ps->pm_rx_desc.compl_type = PLATFORM_USART_RX_COMPL_NONE;
+        pm_platform_usart_cdc_rx_async(&ps->pm_rx_desc);
+    }
+    
+    // Send out queued updates, if due
+    prog_batch_flush(ps);
+    
+    // Show the AQI category
+    prog_led_update(ps);
+	
 	// Done
 	return;
 }
@@ -51,17 +51,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=main.c platform/gpio.c platform/pm_usart.c platform/systick.c platform/usart.c
+SOURCEFILES_QUOTED_IF_SPACED=main.c platform/gpio.c platform/pm_usart.c platform/systick.c platform/usart.c pms.c report.c trace.c platform/mem.c selftest.c aqi.c platform/power.c hampel.c dash.c fmt.c stamp.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/main.o ${OBJECTDIR}/platform/gpio.o ${OBJECTDIR}/platform/pm_usart.o ${OBJECTDIR}/platform/systick.o ${OBJECTDIR}/platform/usart.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/main.o.d ${OBJECTDIR}/platform/gpio.o.d ${OBJECTDIR}/platform/pm_usart.o.d ${OBJECTDIR}/platform/systick.o.d ${OBJECTDIR}/platform/usart.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/main.o ${OBJECTDIR}/platform/gpio.o ${OBJECTDIR}/platform/pm_usart.o ${OBJECTDIR}/platform/systick.o ${OBJECTDIR}/platform/usart.o ${OBJECTDIR}/pms.o ${OBJECTDIR}/report.o ${OBJECTDIR}/trace.o ${OBJECTDIR}/platform/mem.o ${OBJECTDIR}/selftest.o ${OBJECTDIR}/aqi.o ${OBJECTDIR}/platform/power.o ${OBJECTDIR}/hampel.o ${OBJECTDIR}/dash.o ${OBJECTDIR}/fmt.o ${OBJECTDIR}/stamp.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/main.o.d ${OBJECTDIR}/platform/gpio.o.d ${OBJECTDIR}/platform/pm_usart.o.d ${OBJECTDIR}/platform/systick.o.d ${OBJECTDIR}/platform/usart.o.d ${OBJECTDIR}/pms.o.d ${OBJECTDIR}/report.o.d ${OBJECTDIR}/trace.o.d ${OBJECTDIR}/platform/mem.o.d ${OBJECTDIR}/selftest.o.d ${OBJECTDIR}/aqi.o.d ${OBJECTDIR}/platform/power.o.d ${OBJECTDIR}/hampel.o.d ${OBJECTDIR}/dash.o.d ${OBJECTDIR}/fmt.o.d ${OBJECTDIR}/stamp.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/main.o ${OBJECTDIR}/platform/gpio.o ${OBJECTDIR}/platform/pm_usart.o ${OBJECTDIR}/platform/systick.o ${OBJECTDIR}/platform/usart.o
+OBJECTFILES=${OBJECTDIR}/main.o ${OBJECTDIR}/platform/gpio.o ${OBJECTDIR}/platform/pm_usart.o ${OBJECTDIR}/platform/systick.o ${OBJECTDIR}/platform/usart.o ${OBJECTDIR}/pms.o ${OBJECTDIR}/report.o ${OBJECTDIR}/trace.o ${OBJECTDIR}/platform/mem.o ${OBJECTDIR}/selftest.o ${OBJECTDIR}/aqi.o ${OBJECTDIR}/platform/power.o ${OBJECTDIR}/hampel.o ${OBJECTDIR}/dash.o ${OBJECTDIR}/fmt.o ${OBJECTDIR}/stamp.o
 
 # Source Files
-SOURCEFILES=main.c platform/gpio.c platform/pm_usart.c platform/systick.c platform/usart.c
+SOURCEFILES=main.c platform/gpio.c platform/pm_usart.c platform/systick.c platform/usart.c pms.c report.c trace.c platform/mem.c selftest.c aqi.c platform/power.c hampel.c dash.c fmt.c stamp.c
 
 # Pack Options 
 PACK_COMMON_OPTIONS=-I "${CMSIS_DIR}/CMSIS/Core/Include"
@@ -134,6 +134,73 @@ ${OBJECTDIR}/platform/usart.o: platform/usart.c  .generated_files/flags/default/
 	@${RM} ${OBJECTDIR}/platform/usart.o 
 	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/platform/usart.o.d" -o ${OBJECTDIR}/platform/usart.o platform/usart.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
 	
+${OBJECTDIR}/pms.o: pms.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/pms.o.d 
+	@${RM} ${OBJECTDIR}/pms.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/pms.o.d" -o ${OBJECTDIR}/pms.o pms.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/report.o: report.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/report.o.d 
+	@${RM} ${OBJECTDIR}/report.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/report.o.d" -o ${OBJECTDIR}/report.o report.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/trace.o: trace.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/trace.o.d 
+	@${RM} ${OBJECTDIR}/trace.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/trace.o.d" -o ${OBJECTDIR}/trace.o trace.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/platform/mem.o: platform/mem.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}/platform" 
+	@${RM} ${OBJECTDIR}/platform/mem.o.d 
+	@${RM} ${OBJECTDIR}/platform/mem.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/platform/mem.o.d" -o ${OBJECTDIR}/platform/mem.o platform/mem.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/selftest.o: selftest.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/selftest.o.d 
+	@${RM} ${OBJECTDIR}/selftest.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/selftest.o.d" -o ${OBJECTDIR}/selftest.o selftest.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/aqi.o: aqi.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/aqi.o.d 
+	@${RM} ${OBJECTDIR}/aqi.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/aqi.o.d" -o ${OBJECTDIR}/aqi.o aqi.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/platform/power.o: platform/power.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}/platform" 
+	@${RM} ${OBJECTDIR}/platform/power.o.d 
+	@${RM} ${OBJECTDIR}/platform/power.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/platform/power.o.d" -o ${OBJECTDIR}/platform/power.o platform/power.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/hampel.o: hampel.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/hampel.o.d 
+	@${RM} ${OBJECTDIR}/hampel.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/hampel.o.d" -o ${OBJECTDIR}/hampel.o hampel.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/dash.o: dash.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/dash.o.d 
+	@${RM} ${OBJECTDIR}/dash.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/dash.o.d" -o ${OBJECTDIR}/dash.o dash.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/fmt.o: fmt.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/fmt.o.d 
+	@${RM} ${OBJECTDIR}/fmt.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/fmt.o.d" -o ${OBJECTDIR}/fmt.o fmt.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/stamp.o: stamp.c  .generated_files/flags/default/f54533a455c7dc4a1e81c6d7c22abb15c1657cc5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/stamp.o.d 
+	@${RM} ${OBJECTDIR}/stamp.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG   -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/stamp.o.d" -o ${OBJECTDIR}/stamp.o stamp.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+
 else
 ${OBJECTDIR}/main.o: main.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
 	@${MKDIR} "${OBJECTDIR}" 
@@ -165,6 +232,73 @@ ${OBJECTDIR}/platform/usart.o: platform/usart.c  .generated_files/flags/default/
 	@${RM} ${OBJECTDIR}/platform/usart.o 
 	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/platform/usart.o.d" -o ${OBJECTDIR}/platform/usart.o platform/usart.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
 	
+${OBJECTDIR}/pms.o: pms.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/pms.o.d 
+	@${RM} ${OBJECTDIR}/pms.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/pms.o.d" -o ${OBJECTDIR}/pms.o pms.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/report.o: report.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/report.o.d 
+	@${RM} ${OBJECTDIR}/report.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/report.o.d" -o ${OBJECTDIR}/report.o report.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/trace.o: trace.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/trace.o.d 
+	@${RM} ${OBJECTDIR}/trace.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/trace.o.d" -o ${OBJECTDIR}/trace.o trace.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/platform/mem.o: platform/mem.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}/platform" 
+	@${RM} ${OBJECTDIR}/platform/mem.o.d 
+	@${RM} ${OBJECTDIR}/platform/mem.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/platform/mem.o.d" -o ${OBJECTDIR}/platform/mem.o platform/mem.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/selftest.o: selftest.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/selftest.o.d 
+	@${RM} ${OBJECTDIR}/selftest.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/selftest.o.d" -o ${OBJECTDIR}/selftest.o selftest.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/aqi.o: aqi.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/aqi.o.d 
+	@${RM} ${OBJECTDIR}/aqi.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/aqi.o.d" -o ${OBJECTDIR}/aqi.o aqi.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/platform/power.o: platform/power.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}/platform" 
+	@${RM} ${OBJECTDIR}/platform/power.o.d 
+	@${RM} ${OBJECTDIR}/platform/power.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/platform/power.o.d" -o ${OBJECTDIR}/platform/power.o platform/power.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/hampel.o: hampel.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/hampel.o.d 
+	@${RM} ${OBJECTDIR}/hampel.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/hampel.o.d" -o ${OBJECTDIR}/hampel.o hampel.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/dash.o: dash.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/dash.o.d 
+	@${RM} ${OBJECTDIR}/dash.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/dash.o.d" -o ${OBJECTDIR}/dash.o dash.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/fmt.o: fmt.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/fmt.o.d 
+	@${RM} ${OBJECTDIR}/fmt.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/fmt.o.d" -o ${OBJECTDIR}/fmt.o fmt.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+${OBJECTDIR}/stamp.o: stamp.c  .generated_files/flags/default/e24609afc9773a8202b8f298292a567eda1b85c .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/stamp.o.d 
+	@${RM} ${OBJECTDIR}/stamp.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/stamp.o.d" -o ${OBJECTDIR}/stamp.o stamp.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}/PIC32CM-LS00" ${PACK_COMMON_OPTIONS} 
+	
+
 endif
 
 # ------------------------------------------------------------------------------------
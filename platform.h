@@ -22,6 +22,41 @@ extern "C" {
 /// Initialize the platform, including any hardware peripherals.
 void platform_init(void);
 
+/// Stages of @c platform_init(), in the order they complete
+#define PLATFORM_BOOT_CLOCK_REQ		0	///< PL2 and VDDPLL requested, GCLK_GEN2 up
+#define PLATFORM_BOOT_PERIPH		1	///< EVSYS, EIC, buttons, LED and SERCOMs set up
+#define PLATFORM_BOOT_CLOCK_WAIT	2	///< PL2 and VDDPLL ready
+#define PLATFORM_BOOT_CLOCK_DFLL	3	///< DFLL48M running; CPU at 24 MHz
+#define PLATFORM_BOOT_STACK		4	///< Stack painted
+#define PLATFORM_BOOT_DONE		5	///< EIC and interrupts enabled
+#define PLATFORM_NR_BOOT		6
+
+/// Reset causes (bits of @c platform_boot_info_t::rcause)
+#define PLATFORM_RESET_POR		0x01	///< Power-on
+#define PLATFORM_RESET_BODCORE		0x02	///< Brown-out, core supply
+#define PLATFORM_RESET_BODVDD		0x04	///< Brown-out, I/O supply
+#define PLATFORM_RESET_EXT		0x10	///< External reset pin
+#define PLATFORM_RESET_WDT		0x20	///< Watchdog
+#define PLATFORM_RESET_SYST		0x40	///< Software (e.g. debugger)
+
+/// Boot-time profile
+typedef struct platform_boot_info_type {
+	/// Cause of the last reset (@code PLATFORM_RESET_* @endcode)
+	uint8_t rcause;
+	
+	/**
+	 * End of each stage, in microseconds since @c platform_init() was called
+	 * 
+	 * @note
+	 * Time spent between reset and @c platform_init() (C runtime startup) is
+	 * not included.
+	 */
+	uint32_t stage_us[PLATFORM_NR_BOOT];
+} platform_boot_info_t;
+
+/// Get the boot-time profile of the last @c platform_init()
+void platform_boot_info(platform_boot_info_t *info);
+
 /**
  * Do one loop of events processing for the platform
  * 
@@ -118,6 +153,20 @@ void platform_tick_count(platform_timespec_t *tick);
  */
 void platform_tick_hrcount(platform_timespec_t *tick);
 
+/// Number of @c platform_tick_hrraw() counts per microsecond
+#define PLATFORM_TICK_HRRAW_PER_US	12
+
+/**
+ * Raw, free-running version of @c platform_tick_hrcount()
+ * 
+ * @note
+ * This is much cheaper to read than a timespec, and is meant for timestamping
+ * events; it wraps around every ~358 seconds.
+ * 
+ * @return	Counts since @c platform_init() was called
+ */
+uint32_t platform_tick_hrraw(void);
+
 /**
  * Get the difference between two ticks
  * 
@@ -171,6 +220,17 @@ typedef struct platform_usart_rx_desc_type
 		 */
 		uint16_t data_len;
 	} compl_info;
+	
+	/**
+	 * Time at which the first byte was received
+	 * 
+	 * @note
+	 * This member is valid only if @code compl_type == PLATFORM_USART_RX_COMPL_DATA @endcode
+	 * and @code compl_info.data_len > 0 @endcode. Bytes are picked up by
+	 * @c platform_do_loop_one(), so this is late by however long the loop
+	 * took to come around.
+	 */
+	volatile platform_timespec_t ts_first;
 } platform_usart_rx_async_desc_t;
 
 /// Descriptor for a transmission fragment
@@ -225,6 +285,107 @@ void platform_usart_cdc_rx_abort(void);
 /// Check whether a reception is on-going
 bool platform_usart_cdc_rx_busy(void);
 
+/**
+ * Enqueue a request for data reception from the PM sensor (SERCOM0)
+ * 
+ * @note
+ * This behaves like @c platform_usart_cdc_rx_async().
+ */
+bool pm_platform_usart_cdc_rx_async(platform_usart_rx_async_desc_t *desc);
+
+/// Abort an ongoing reception from the PM sensor
+void pm_platform_usart_cdc_rx_abort(void);
+
+/// Check whether a reception from the PM sensor is on-going
+bool pm_platform_usart_cdc_rx_busy(void);
+
+/**
+ * Feed bytes to the PM sensor receiver, as if they came off the wire
+ * 
+ * @note
+ * This is meant for self-testing. Bytes are only taken while a reception is
+ * on-going, and up to the end of its buffer; the usual idle timeout then
+ * applies from the last byte injected.
+ * 
+ * @p	buf	Bytes to inject
+ * @p	len	Number of bytes
+ * 
+ * @return	Number of bytes taken
+ */
+uint16_t pm_platform_usart_rx_inject(const char *buf, uint16_t len);
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// RAM usage, in bytes
+typedef struct platform_ram_info_type {
+	/**
+	 * Space between the end of static data and the initial stack pointer
+	 * 
+	 * @note
+	 * This is zero if the linker did not provide the end of static data; the
+	 * stack is then not measured either.
+	 */
+	uint32_t stack_avail;
+	
+	/// Deepest the stack has been since @c platform_init() was called
+	uint32_t stack_peak;
+	
+	/// Static state of each platform component
+	uint16_t gpio;
+	uint16_t systick;
+	uint16_t usart;
+	uint16_t pm_usart;
+	uint16_t power;
+} platform_ram_info_t;
+
+/**
+ * Measure RAM usage
+ * 
+ * @note
+ * The unused part of the stack is painted during @c platform_init(); finding
+ * the peak scans it, so this is meant to be called on request only.
+ */
+void platform_ram_info(platform_ram_info_t *info);
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Idle level: PL0, with the CPU on OSC16M at 4 MHz
+#define PLATFORM_PERF_LOW	0
+
+/// Burst level: PL2, with the CPU on DFLL48M/2 at 24 MHz
+#define PLATFORM_PERF_HIGH	1
+
+/// Number of performance levels
+#define PLATFORM_NR_PERF	2
+
+/**
+ * Run at @c PLATFORM_PERF_HIGH for at least the given time from now
+ * 
+ * @note
+ * The switch, if any, happens right away; a later call may extend the boost
+ * but never shortens it. Switching takes a few tens of microseconds, during
+ * which @c platform_tick_hrcount() does not advance. Once the boost is over,
+ * the event loop steps back down to @c PLATFORM_PERF_LOW.
+ * 
+ * @p	ms	Minimum duration, in milliseconds
+ */
+void platform_perf_boost(uint32_t ms);
+
+/// Return the current performance level (@code PLATFORM_PERF_* @endcode)
+uint8_t platform_perf_level(void);
+
+/// Time spent at each performance level
+typedef struct platform_perf_stats_type {
+	/// Milliseconds spent at each level since @c platform_init() was called
+	uint32_t ms[PLATFORM_NR_PERF];
+	
+	/// Number of level switches
+	uint32_t nr_switches;
+} platform_perf_stats_t;
+
+/// Get the time spent at each performance level, up to now
+void platform_perf_stats(platform_perf_stats_t *stats);
+
 //////////////////////////////////////////////////////////////////////////////
 
 #ifdef __cplusplus
@@ -14,7 +14,8 @@
  * -- Mode: Secure, NONSEC disabled
  * 
  * New clock configuration:
- * -- GCLK_GEN0: 24 MHz (DFLL48M [48 MHz], with /2 prescaler)
+ * -- GCLK_GEN0: 24 MHz (DFLL48M [48 MHz], with /2 prescaler) at PL2, or
+ *               4 MHz (OSC16M @ 4 MHz) at PL0; see platform/power.c
  * -- GCLK_GEN2: 4 MHz  (OSC16M @ 4 MHz, no additional prescaler)
  * 
  * HW configuration for the corresponding Curiosity Nano+ Touch Evaluation
@@ -31,6 +32,11 @@
 #include "../platform.h"
 
 // Initializers defined in other platform/*.c files
+extern void platform_mem_init(void);
+extern void platform_power_init_start(void);
+extern void platform_power_init_wait(void);
+extern void platform_power_init_finish(void);
+extern void platform_power_tick_handler(const platform_timespec_t *tick);
 extern void platform_systick_init(void);
 
 extern void platform_usart_init(void);
@@ -41,83 +47,9 @@ extern void pm_platform_usart_tick_handler(const platform_timespec_t *tick);
 
 /////////////////////////////////////////////////////////////////////////////
 
-// Enable higher frequencies for higher performance
-static void raise_perf_level(void)
-{
-	uint32_t tmp_reg = 0;
-	
-	/*
-	 * The chip starts in PL0, which emphasizes energy efficiency over
-	 * performance. However, we need the latter for the clock frequency
-	 * we will be using (~24 MHz); hence, switch to PL2 before continuing.
-	 */
-	PM_REGS->PM_INTFLAG = 0x01;
-	PM_REGS->PM_PLCFG = 0x02;
-	while ((PM_REGS->PM_INTFLAG & 0x01) == 0)
-		asm("nop");
-	PM_REGS->PM_INTFLAG = 0x01;
-	
-	/*
-	 * Power up the 48MHz DFPLL.
-	 * 
-	 * On the Curiosity Nano Board, VDDPLL has a 1.1uF capacitance
-	 * connected in parallel. Assuming a ~20% error, we have
-	 * STARTUP >= (1.32uF)/(1uF) = 1.32; as this is not an integer, choose
-	 * the next HIGHER value.
-	 */
-	NVMCTRL_SEC_REGS->NVMCTRL_CTRLB = (2 << 1) ;
-	SUPC_REGS->SUPC_VREGPLL = 0x00000302;
-	while ((SUPC_REGS->SUPC_STATUS & (1 << 18)) == 0)
-		asm("nop");
-	
-	/*
-	 * Configure the 48MHz DFPLL.
-	 * 
-	 * Start with disabling ONDEMAND...
-	 */
-	OSCCTRL_REGS->OSCCTRL_DFLLCTRL = 0x0000;
-	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
-		asm("nop");
-	
-	/*
-	 * ... then writing the calibration values (which MUST be done as a
-	 * single write, hence the use of a temporary variable)...
-	 */
-	tmp_reg  = *((uint32_t*)0x00806020);
-	tmp_reg &= ((uint32_t)(0b111111) << 25);
-	tmp_reg >>= 15;
-	tmp_reg |= ((512 << 0) & 0x000003ff);
-	OSCCTRL_REGS->OSCCTRL_DFLLVAL = tmp_reg;
-	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
-		asm("nop");
-	
-	// ... then enabling ...
-	OSCCTRL_REGS->OSCCTRL_DFLLCTRL |= 0x0002;
-	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
-		asm("nop");
-	
-	// ... then restoring ONDEMAND.
-//	OSCCTRL_REGS->OSCCTRL_DFLLCTRL |= 0x0080;
-//	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
-//		asm("nop");
-	
-	/*
-	 * Configure GCLK_GEN2 as described; this one will become the main
-	 * clock for slow/medium-speed peripherals, as GCLK_GEN0 will be
-	 * stepped up for 24 MHz operation.
-	 */
-	GCLK_REGS->GCLK_GENCTRL[2] = 0x00000105;
-	while ((GCLK_REGS->GCLK_SYNCBUSY & (1 << 4)) != 0)
-		asm("nop");
-	
-	// Switch over GCLK_GEN0 to DFLL48M, with DIV=2 to get 24 MHz.
-	GCLK_REGS->GCLK_GENCTRL[0] = 0x00020107;
-	while ((GCLK_REGS->GCLK_SYNCBUSY & (1 << 2)) != 0)
-		asm("nop");
-	
-	// Done. We're now at 24 MHz.
-	return;
-}
+// End of each stage of platform_init(), in platform_tick_hrraw() counts
+static uint32_t boot_mark[PLATFORM_NR_BOOT];
+static uint8_t boot_rcause;
 
 /*
  * Configure the EIC peripheral
@@ -254,6 +186,7 @@ void platform_gpo_modify(uint16_t set, uint16_t clr)
  * (IRQ) handler is thus named EIC_EXTINT_2_Handler.
  */
 static volatile uint16_t pb_press_mask = 0;
+const uint16_t platform_gpio_ram = sizeof(pb_press_mask) + sizeof(boot_mark) + sizeof(boot_rcause);
 void __attribute__((used, interrupt())) EIC_EXTINT_2_Handler(void)
 {
 	pb_press_mask &= ~PLATFORM_PB_ONBOARD_MASK;
@@ -336,8 +269,21 @@ static void NVIC_init(void)
 // Initialize the platform
 void platform_init(void)
 {
-	// Raise the power level
-	raise_perf_level();
+	/*
+	 * SysTick goes first, at the reset clock, so that every stage can be
+	 * timed; it is re-derived when GCLK_GEN0 is switched over.
+	 */
+	boot_rcause = RSTC_REGS->RSTC_RCAUSE;
+	platform_systick_init();
+	
+	/*
+	 * Raise the power level; the event loop lowers it again when idle.
+	 * 
+	 * The performance level and the PLL regulator take a while to become
+	 * ready; everything that only needs GCLK_GEN2 is set up meanwhile.
+	 */
+	platform_power_init_start();
+	boot_mark[PLATFORM_BOOT_CLOCK_REQ] = platform_tick_hrraw();
 	
 	// Early initialization
 	EVSYS_init();
@@ -348,14 +294,36 @@ void platform_init(void)
 	GPO_init();
 	platform_usart_init();
     pm_platform_usart_init();
+	boot_mark[PLATFORM_BOOT_PERIPH] = platform_tick_hrraw();
+	
+	platform_power_init_wait();
+	boot_mark[PLATFORM_BOOT_CLOCK_WAIT] = platform_tick_hrraw();
+	platform_power_init_finish();
+	boot_mark[PLATFORM_BOOT_CLOCK_DFLL] = platform_tick_hrraw();
+	
+	/*
+	 * Paint the stack while it is at its shallowest (and once at full
+	 * speed, as this touches most of RAM)
+	 */
+	platform_mem_init();
+	boot_mark[PLATFORM_BOOT_STACK] = platform_tick_hrraw();
 	
 	// Late initialization
 	EIC_init_late();
-	platform_systick_init();
 	NVIC_init();
+	boot_mark[PLATFORM_BOOT_DONE] = platform_tick_hrraw();
 	return;
 }
 
+void platform_boot_info(platform_boot_info_t *info)
+{
+	uint8_t x;
+	
+	info->rcause = boot_rcause;
+	for (x = 0; x < PLATFORM_NR_BOOT; ++x)
+		info->stage_us[x] = boot_mark[x] / PLATFORM_TICK_HRRAW_PER_US;
+}
+
 // Do a single event loop
 void platform_do_loop_one(void)
 {
@@ -370,4 +338,5 @@ void platform_do_loop_one(void)
     
 	platform_usart_tick_handler(&tick);
 	pm_platform_usart_tick_handler(&tick);
+	platform_power_tick_handler(&tick);
 }
@@ -0,0 +1,92 @@
+/**
+ * @file platform/mem.c
+ * @brief Platform-support routines, RAM accounting component
+ */
+
+/*
+ * The stack grows down from the initial stack pointer (the first entry of
+ * the vector table) towards the end of static data. Everything below the
+ * stack pointer is painted with a known pattern at boot; the deepest the
+ * stack went is then where the pattern was first overwritten.
+ * 
+ * NOTE: This file does not deal directly with hardware configuration.
+ */
+
+// Common include for the XC32 compiler
+#include <xc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../platform.h"
+
+// Functions "exported" by this file
+void platform_mem_init(void);
+
+// Static-state sizes "exported" by other platform/*.c files
+extern const uint16_t platform_gpio_ram;
+extern const uint16_t platform_systick_ram;
+extern const uint16_t platform_usart_ram;
+extern const uint16_t pm_platform_usart_ram;
+extern const uint16_t platform_power_ram;
+
+/*
+ * End of static data, as provided by the linker
+ * 
+ * NOTE: This is weak, so that a linker script without it yields NULL
+ *       instead of a link error.
+ */
+extern uint32_t _end[] __attribute__((weak));
+
+/////////////////////////////////////////////////////////////////////////////
+
+/// Pattern painted over the unused stack
+#define STACK_PAINT	0xA5A5A5A5u
+
+/// Words left alone just below the stack pointer while painting
+#define STACK_PAINT_MARGIN	16
+
+// Bounds of the stack area, as 32-bit words
+static uint32_t *stack_top(void)
+{
+	return (uint32_t *)(uintptr_t)(*(const uint32_t *)(uintptr_t)(SCB->VTOR));
+}
+static uint32_t *stack_bottom(void)
+{
+	return (uint32_t *)(((uintptr_t)_end + 3) & ~(uintptr_t)3);
+}
+
+// Paint the unused part of the stack
+void platform_mem_init(void)
+{
+	volatile uint32_t here = 0;
+	uint32_t *p = stack_bottom();
+	uint32_t *end = (uint32_t *)&here - STACK_PAINT_MARGIN;
+	
+	if (_end == NULL)
+		return;
+	while (p < end)
+		*p++ = STACK_PAINT;
+	return;
+}
+
+void platform_ram_info(platform_ram_info_t *info)
+{
+	const uint32_t *p = stack_bottom();
+	const uint32_t *top = stack_top();
+	
+	memset(info, 0, sizeof(*info));
+	info->gpio     = platform_gpio_ram;
+	info->systick  = platform_systick_ram;
+	info->usart    = platform_usart_ram;
+	info->pm_usart = pm_platform_usart_ram;
+	info->power    = platform_power_ram;
+	
+	if (_end == NULL || p >= top)
+		return;
+	while (p < top && *p == STACK_PAINT)
+		++p;
+	info->stack_avail = (uint32_t)((uintptr_t)top - (uintptr_t)stack_bottom());
+	info->stack_peak  = (uint32_t)((uintptr_t)top - (uintptr_t)p);
+	return;
+}
@@ -73,6 +73,7 @@ typedef struct ctx_usart_type {
 	
 } pm_ctx_usart_t;
 static pm_ctx_usart_t pm_ctx_uart;
+const uint16_t pm_platform_usart_ram = sizeof(pm_ctx_uart);
 
 // Configure USART
 void pm_platform_usart_init(void){
@@ -228,6 +229,8 @@ static void pm_usart_tick_handler_common(
 
 		if ((status & 0x8003) == 0x8000) {
 			// No errors detected
+			if (ctx->rx.idx == 0)
+				ctx->rx.desc->ts_first = *tick;
 			ctx->rx.desc->buf[ctx->rx.idx++] = data;
 			ctx->rx.ts_idle = *tick;
 		}
@@ -299,3 +302,27 @@ void pm_platform_usart_cdc_rx_abort(void)
 {
 	pm_usart_rx_abort_helper(&pm_ctx_uart);
 }
+uint16_t pm_platform_usart_rx_inject(const char *buf, uint16_t len)
+{
+	pm_ctx_usart_t *ctx = &pm_ctx_uart;
+	platform_timespec_t ts;
+	uint16_t n = 0;
+	
+	if (ctx->rx.desc == NULL)
+		// Nowhere to store any data
+		return 0;
+	
+	if (ctx->rx.idx == 0 && len > 0) {
+		platform_tick_hrcount(&ts);
+		ctx->rx.desc->ts_first = ts;
+	}
+	while (n < len && ctx->rx.idx < ctx->rx.desc->max_len)
+		ctx->rx.desc->buf[ctx->rx.idx++] = buf[n++];
+	platform_tick_hrcount(&ctx->rx.ts_idle);
+	
+	if (ctx->rx.idx >= ctx->rx.desc->max_len) {
+		// Buffer completely filled
+		pm_usart_rx_abort_helper(ctx);
+	}
+	return n;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file platform/power.c
+ * @brief Platform-support routines, performance-level component
+ */
+
+/*
+ * Two operating points are used:
+ *
+ * -- PLATFORM_PERF_LOW:  PL0, GCLK_GEN0 from OSC16M @ 4 MHz, DFLL48M and
+ *                        its regulator off, no flash wait states
+ * -- PLATFORM_PERF_HIGH: PL2, GCLK_GEN0 from DFLL48M/2 @ 24 MHz, two flash
+ *                        wait states
+ *
+ * GCLK_GEN2 stays on OSC16M @ 4 MHz throughout, and is what the SERCOMs are
+ * clocked from; their baud settings therefore need no change. SysTick follows
+ * GCLK_GEN0, and is re-derived on every switch.
+ *
+ * Switching up raises the performance level before the clock, and switching
+ * down lowers the clock before the performance level, so that the core is
+ * never clocked faster than its level allows.
+ */
+
+// Common include for the XC32 compiler
+#include <xc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../platform.h"
+
+// Functions "exported" by this file
+void platform_power_init_start(void);
+void platform_power_init_wait(void);
+void platform_power_init_finish(void);
+void platform_power_tick_handler(const platform_timespec_t *tick);
+
+// Defined in platform/systick.c
+extern void platform_systick_suspend(void);
+extern void platform_systick_resume(uint32_t counts_per_us);
+
+/////////////////////////////////////////////////////////////////////////////
+
+/// SysTick counts per microsecond at each level
+static const uint8_t perf_systick_per_us[PLATFORM_NR_PERF] = {
+	[PLATFORM_PERF_LOW]  = 4/2,
+	[PLATFORM_PERF_HIGH] = 24/2
+};
+
+static struct {
+	// Current level
+	uint8_t level;
+
+	// Stay at PLATFORM_PERF_HIGH until this time, in milliseconds
+	uint32_t boost_until;
+
+	// Whether boost_until is meaningful
+	bool boosted;
+
+	// Time of the last switch (or query), in milliseconds
+	uint32_t since;
+
+	// Accumulated statistics
+	platform_perf_stats_t stats;
+} power;
+const uint16_t platform_power_ram = sizeof(power);
+
+// Current time, in milliseconds
+static uint32_t power_now_ms(void)
+{
+	platform_timespec_t t;
+
+	platform_tick_count(&t);
+	return (t.nr_sec * 1000) + (t.nr_nsec / 1000000);	// Wrap-around intentional
+}
+
+// Charge the time since the last call to the current level
+static void power_account(uint32_t now)
+{
+	power.stats.ms[power.level] += (now - power.since);
+	power.since = now;
+}
+
+// Switch the performance level to PL0 or PL2
+static void power_set_plcfg(uint8_t plsel)
+{
+	PM_REGS->PM_INTFLAG = 0x01;
+	PM_REGS->PM_PLCFG = plsel;
+	while ((PM_REGS->PM_INTFLAG & 0x01) == 0)
+		asm("nop");
+	PM_REGS->PM_INTFLAG = 0x01;
+}
+
+// Power up the DFLL48M (which must have been configured before)
+static void power_dfll_on(void)
+{
+	SUPC_REGS->SUPC_VREGPLL = 0x00000302;
+	while ((SUPC_REGS->SUPC_STATUS & (1 << 18)) == 0)
+		asm("nop");
+
+	OSCCTRL_REGS->OSCCTRL_DFLLCTRL |= 0x0002;
+	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
+		asm("nop");
+}
+
+// Step up to PLATFORM_PERF_HIGH
+static void power_step_up(void)
+{
+	power_set_plcfg(0x02);
+	power_dfll_on();
+	NVMCTRL_SEC_REGS->NVMCTRL_CTRLB = (2 << 1);
+
+	platform_systick_suspend();
+	GCLK_REGS->GCLK_GENCTRL[0] = 0x00020107;
+	while ((GCLK_REGS->GCLK_SYNCBUSY & (1 << 2)) != 0)
+		asm("nop");
+	platform_systick_resume(perf_systick_per_us[PLATFORM_PERF_HIGH]);
+}
+
+// Step down to PLATFORM_PERF_LOW
+static void power_step_down(void)
+{
+	platform_systick_suspend();
+	GCLK_REGS->GCLK_GENCTRL[0] = 0x00000105;
+	while ((GCLK_REGS->GCLK_SYNCBUSY & (1 << 2)) != 0)
+		asm("nop");
+	platform_systick_resume(perf_systick_per_us[PLATFORM_PERF_LOW]);
+
+	NVMCTRL_SEC_REGS->NVMCTRL_CTRLB = (0 << 1);
+	OSCCTRL_REGS->OSCCTRL_DFLLCTRL &= ~0x0002;
+	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
+		asm("nop");
+	SUPC_REGS->SUPC_VREGPLL = 0x00000300;
+	power_set_plcfg(0x00);
+}
+
+// Switch levels, keeping the statistics
+static void power_switch(uint8_t level)
+{
+	if (level == power.level)
+		return;
+
+	power_account(power_now_ms());
+	if (level == PLATFORM_PERF_HIGH)
+		power_step_up();
+	else
+		power_step_down();
+	power.level = level;
+	++power.stats.nr_switches;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Initial clock configuration, in three steps so that the waits for the
+ * performance level and the PLL regulator overlap with the setup of the
+ * peripherals (which only use GCLK_GEN2) in between:
+ *
+ * - platform_power_init_start() requests PL2 and powers up VDDPLL,
+ * - platform_power_init_wait() waits for both to be ready,
+ * - platform_power_init_finish() starts the DFLL48M and switches GCLK_GEN0
+ *   over, leaving the chip at PLATFORM_PERF_HIGH.
+ *
+ * SysTick must be running (at the reset clock) by then.
+ */
+void platform_power_init_start(void)
+{
+	memset(&power, 0, sizeof(power));
+	power.level = PLATFORM_PERF_LOW;
+
+	/*
+	 * The chip starts in PL0, which emphasizes energy efficiency over
+	 * performance. However, we need the latter for the clock frequency
+	 * we will be using (~24 MHz); hence, request PL2 now.
+	 *
+	 * Initialization runs at full speed; the first pass through the event
+	 * loop steps down, unless a boost has been requested by then.
+	 */
+	PM_REGS->PM_INTFLAG = 0x01;
+	PM_REGS->PM_PLCFG = 0x02;
+
+	/*
+	 * Power up the 48MHz DFPLL.
+	 *
+	 * On the Curiosity Nano Board, VDDPLL has a 1.1uF capacitance
+	 * connected in parallel. Assuming a ~20% error, we have
+	 * STARTUP >= (1.32uF)/(1uF) = 1.32; as this is not an integer, choose
+	 * the next HIGHER value.
+	 */
+	NVMCTRL_SEC_REGS->NVMCTRL_CTRLB = (2 << 1) ;
+	SUPC_REGS->SUPC_VREGPLL = 0x00000302;
+
+	/*
+	 * Configure GCLK_GEN2 as described; this one will become the main
+	 * clock for slow/medium-speed peripherals, as GCLK_GEN0 will be
+	 * stepped up and down. OSC16M is already running, so this is quick.
+	 */
+	GCLK_REGS->GCLK_GENCTRL[2] = 0x00000105;
+	while ((GCLK_REGS->GCLK_SYNCBUSY & (1 << 4)) != 0)
+		asm("nop");
+}
+
+void platform_power_init_wait(void)
+{
+	while ((PM_REGS->PM_INTFLAG & 0x01) == 0)
+		asm("nop");
+	PM_REGS->PM_INTFLAG = 0x01;
+	while ((SUPC_REGS->SUPC_STATUS & (1 << 18)) == 0)
+		asm("nop");
+}
+
+void platform_power_init_finish(void)
+{
+	uint32_t tmp_reg = 0;
+
+	/*
+	 * Configure the 48MHz DFPLL.
+	 *
+	 * Start with disabling ONDEMAND...
+	 */
+	OSCCTRL_REGS->OSCCTRL_DFLLCTRL = 0x0000;
+	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
+		asm("nop");
+
+	/*
+	 * ... then writing the calibration values (which MUST be done as a
+	 * single write, hence the use of a temporary variable)...
+	 *
+	 * NOTE: DFLLVAL is kept while the DFLL48M is disabled, so this is not
+	 *       repeated on every switch to PLATFORM_PERF_HIGH.
+	 */
+	tmp_reg  = *((uint32_t*)0x00806020);
+	tmp_reg &= ((uint32_t)(0b111111) << 25);
+	tmp_reg >>= 15;
+	tmp_reg |= ((512 << 0) & 0x000003ff);
+	OSCCTRL_REGS->OSCCTRL_DFLLVAL = tmp_reg;
+	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
+		asm("nop");
+
+	// ... then enabling.
+	OSCCTRL_REGS->OSCCTRL_DFLLCTRL |= 0x0002;
+	while ((OSCCTRL_REGS->OSCCTRL_STATUS & (1 << 24)) == 0)
+		asm("nop");
+
+	// Switch over GCLK_GEN0 to DFLL48M, with DIV=2 to get 24 MHz.
+	platform_systick_suspend();
+	GCLK_REGS->GCLK_GENCTRL[0] = 0x00020107;
+	while ((GCLK_REGS->GCLK_SYNCBUSY & (1 << 2)) != 0)
+		asm("nop");
+	platform_systick_resume(perf_systick_per_us[PLATFORM_PERF_HIGH]);
+
+	// Done. We're now at 24 MHz; the time so far was spent at 4 MHz.
+	power_account(power_now_ms());
+	power.level = PLATFORM_PERF_HIGH;
+	return;
+}
+
+// Step down once no boost is in effect
+void platform_power_tick_handler(const platform_timespec_t *tick)
+{
+	uint32_t now = (tick->nr_sec * 1000) + (tick->nr_nsec / 1000000);
+
+	if (power.boosted && (int32_t)(now - power.boost_until) < 0)
+		return;
+	power.boosted = false;
+	power_switch(PLATFORM_PERF_LOW);
+}
+
+void platform_perf_boost(uint32_t ms)
+{
+	uint32_t now = power_now_ms();
+	uint32_t until = now + ms;	// Wrap-around intentional
+
+	if (!power.boosted || (int32_t)(until - power.boost_until) > 0)
+		power.boost_until = until;
+	power.boosted = true;
+	power_switch(PLATFORM_PERF_HIGH);
+}
+
+uint8_t platform_perf_level(void)
+{
+	return power.level;
+}
+
+void platform_perf_stats(platform_perf_stats_t *stats)
+{
+	power_account(power_now_ms());
+	*stats = power.stats;
+}
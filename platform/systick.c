@@ -14,7 +14,8 @@
  * -- Mode: Secure, NONSEC disabled
  * 
  * New clock configuration:
- * -- GCLK_GEN0: 24 MHz (DFLL48M [48 MHz], with /2 prescaler)
+ * -- GCLK_GEN0: 24 MHz (DFLL48M [48 MHz], with /2 prescaler) at PL2, or
+ *               4 MHz (OSC16M @ 4 MHz) at PL0; see platform/power.c
  * -- GCLK_GEN2: 4 MHz  (OSC16M @ 4 MHz, no additional prescaler)
  * 
  * NOTE: This file does not deal directly with hardware configuration.
@@ -64,6 +65,22 @@ int platform_timespec_compare(const platform_timespec_t *lhs,
 // SysTick handling
 static volatile platform_timespec_t ts_wall = PLATFORM_TIMESPEC_ZERO;
 static volatile uint32_t ts_wall_cookie = 0;
+static volatile uint32_t ts_raw = 0;
+
+/*
+ * SysTick counts at a rate that follows GCLK_GEN0, so the reload value is
+ * re-derived on every clock switch to keep the tick period constant. Counts
+ * are scaled to PLATFORM_TICK_HRRAW_PER_US before use, so that only the
+ * resolution of the high-resolution readings depends on the clock.
+ * 
+ * SysTick is started first thing in platform_init(), at the reset clock
+ * (OSC16M @ 4 MHz), so that initialization itself can be timed.
+ */
+static volatile uint32_t systick_reload = (4/2) * PLATFORM_TICK_PERIOD_US;
+static volatile uint32_t systick_scale = PLATFORM_TICK_HRRAW_PER_US / (4/2);
+const uint16_t platform_systick_ram = sizeof(ts_wall) + sizeof(ts_wall_cookie) + sizeof(ts_raw) +
+	sizeof(systick_reload) + sizeof(systick_scale);
+
 void __attribute__((used, interrupt())) SysTick_Handler(void)
 {
 	platform_timespec_t t = ts_wall;
@@ -76,13 +93,13 @@ void __attribute__((used, interrupt())) SysTick_Handler(void)
 	
 	++ts_wall_cookie;	// Wrap-around intentional
 	ts_wall = t;
+	ts_raw += PLATFORM_TICK_HRRAW_PER_US * PLATFORM_TICK_PERIOD_US;	// Wrap-around intentional
 	++ts_wall_cookie;	// Wrap-around intentional
 	
 	// Reset before returning.
 	SysTick->VAL  = 0x00158158;	// Any value will clear
 	return;
 }
-#define SYSTICK_RELOAD_VAL ((24/2)*PLATFORM_TICK_PERIOD_US)
 void platform_systick_init(void)
 {
 	/*
@@ -93,11 +110,51 @@ void platform_systick_init(void)
 	 * - Clear (VAL)
 	 * - Program CTRL
 	 */
-	SysTick->LOAD = SYSTICK_RELOAD_VAL;
+	SysTick->LOAD = systick_reload;
 	SysTick->VAL  = 0x00158158;	// Any value will clear
 	SysTick->CTRL = 0x00000007;
 	return;
 }
+
+/*
+ * Bracket a change of GCLK_GEN0; for use by platform/power.c only.
+ * 
+ * The part of the current period that has elapsed is folded into the wall
+ * clock before the counter is stopped, and a fresh period is started at the
+ * new rate afterwards. Time spent in between (waiting for oscillators) is
+ * not counted.
+ */
+void platform_systick_suspend(void)
+{
+	platform_timespec_t t;
+	uint32_t s;
+	
+	__disable_irq();
+	s = (systick_reload - SysTick->VAL) * systick_scale;
+	SysTick->CTRL = 0x00000000;
+	
+	t = ts_wall;
+	t.nr_nsec += (1000 * s)/PLATFORM_TICK_HRRAW_PER_US;
+	while (t.nr_nsec >= 1000000000) {
+		t.nr_nsec -= 1000000000;
+		++t.nr_sec;	// Wrap-around intentional
+	}
+	++ts_wall_cookie;	// Wrap-around intentional
+	ts_wall = t;
+	ts_raw += s;		// Wrap-around intentional
+	++ts_wall_cookie;	// Wrap-around intentional
+	__enable_irq();
+}
+void platform_systick_resume(uint32_t counts_per_us)
+{
+	__disable_irq();
+	systick_scale  = PLATFORM_TICK_HRRAW_PER_US / counts_per_us;
+	systick_reload = counts_per_us * PLATFORM_TICK_PERIOD_US;
+	SysTick->LOAD  = systick_reload;
+	SysTick->VAL   = 0x00158158;	// Any value will clear
+	SysTick->CTRL  = 0x00000007;
+	__enable_irq();
+}
 void platform_tick_count(platform_timespec_t *tick)
 {
 	uint32_t cookie;
@@ -111,10 +168,15 @@ void platform_tick_count(platform_timespec_t *tick)
 void platform_tick_hrcount(platform_timespec_t *tick)
 {
 	platform_timespec_t t;
-	uint32_t s = SYSTICK_RELOAD_VAL - SysTick->VAL;
+	uint32_t cookie, s;
 	
-	platform_tick_count(&t);
-	t.nr_nsec += (1000 * s)/12;
+	// The count must belong to the same period as the wall clock.
+	do {
+		cookie = ts_wall_cookie;
+		t = ts_wall;
+		s = (systick_reload - SysTick->VAL) * systick_scale;
+	} while (ts_wall_cookie != cookie);
+	t.nr_nsec += (1000 * s)/PLATFORM_TICK_HRRAW_PER_US;
 	while (t.nr_nsec >= 1000000000) {
 		t.nr_nsec -= 1000000000;
 		++t.nr_sec;	// Wrap-around intentional
@@ -122,6 +184,16 @@ void platform_tick_hrcount(platform_timespec_t *tick)
 	
 	*tick = t;
 }
+uint32_t platform_tick_hrraw(void)
+{
+	uint32_t cookie, t;
+	
+	do {
+		cookie = ts_wall_cookie;
+		t = ts_raw + (systick_reload - SysTick->VAL) * systick_scale;
+	} while (ts_wall_cookie != cookie);
+	return t;
+}
 
 // Difference between two ticks
 void platform_tick_delta(
@@ -74,6 +74,7 @@ typedef struct ctx_usart_type {
 	
 } ctx_usart_t;
 static ctx_usart_t ctx_uart;
+const uint16_t platform_usart_ram = sizeof(ctx_uart);
 
 // Configure USART
 void platform_usart_init(void){
@@ -175,8 +176,9 @@ void platform_usart_init(void){
     PORT_SEC_REGS->GROUP[1].PORT_DIRCLR = (1 << 8) | (1 << 9);
     
 	PORT_SEC_REGS->GROUP[1].PORT_PINCFG[8] = 0x03;
+	PORT_SEC_REGS->GROUP[1].PORT_PINCFG[9] = 0x03;
     
-	PORT_SEC_REGS->GROUP[1].PORT_PMUX[4] = 0x3;
+	PORT_SEC_REGS->GROUP[1].PORT_PMUX[4] = 0x33;
     
     // Last: enable the peripheral, after resetting the state machine
 	UART_REGS->SERCOM_CTRLA |= (0x1 << 1);
@@ -208,6 +210,50 @@ static void usart_tick_handler_common(
 	uint8_t  data   = 0x00;
 	platform_timespec_t ts_delta;
 	
+	// RX handling
+	if ((ctx->regs->SERCOM_INTFLAG & (1 << 2)) != 0) {
+		/*
+		 * There are unread data
+		 * 
+		 * To enable readout of error conditions, STATUS must be read
+		 * before reading DATA.
+		 * 
+		 * NOTE: Piggyback on Bit 15, as it is undefined for this
+		 *       platform.
+		 */
+		status = ctx->regs->SERCOM_STATUS | 0x8000;
+		data   = (uint8_t)(ctx->regs->SERCOM_DATA);
+	}
+	do {
+		if (ctx->rx.desc == NULL) {
+			// Nowhere to store any read data
+			break;
+		}
+
+		if ((status & 0x8003) == 0x8000) {
+			// No errors detected
+			if (ctx->rx.idx == 0)
+				ctx->rx.desc->ts_first = *tick;
+			ctx->rx.desc->buf[ctx->rx.idx++] = data;
+			ctx->rx.ts_idle = *tick;
+		}
+		ctx->regs->SERCOM_STATUS |= (status & 0x00F7);
+
+		// Some housekeeping
+		if (ctx->rx.idx >= ctx->rx.desc->max_len) {
+			// Buffer completely filled
+			usart_rx_abort_helper(ctx);
+			break;
+		} else if (ctx->rx.idx > 0) {
+			platform_tick_delta(&ts_delta, tick, &ctx->rx.ts_idle);
+			if (platform_timespec_compare(&ts_delta, &ctx->cfg.ts_idle_timeout) >= 0) {
+				// IDLE timeout
+				usart_rx_abort_helper(ctx);
+				break;
+			}
+		}
+	} while (0);
+	
 	// TX handling
 	if ((ctx->regs->SERCOM_INTFLAG & (1 << 0)) != 0) {
 		if (ctx->tx.len > 0) {
@@ -0,0 +1,178 @@
+/**
+ * @file  pms.c
+ * @brief Frame decoding for the Plantower PMS5003-family particulate sensors
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pms.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Read a big-endian 16-bit field
+static uint16_t rd_be16(const uint8_t *p)
+{
+	return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+// Write a big-endian 16-bit field
+static void wr_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+// Sum all bytes preceding the checksum field
+uint16_t pms_frame_checksum(const uint8_t *raw)
+{
+	uint16_t sum = 0;
+	unsigned int x;
+
+	for (x = 0; x < (PMS_FRAME_LEN - 2); ++x)
+		sum += raw[x];
+	return sum;
+}
+
+// Validate, then decode a raw frame
+bool pms_frame_decode(pms_frame_t *frame, const uint8_t *raw)
+{
+	unsigned int x;
+
+	if (raw[0] != PMS_FRAME_START_1 || raw[1] != PMS_FRAME_START_2)
+		return false;
+	else if (rd_be16(&raw[2]) != PMS_FRAME_DATA_LEN)
+		return false;
+	else if (rd_be16(&raw[PMS_FRAME_LEN - 2]) != pms_frame_checksum(raw))
+		return false;
+
+	if (frame == NULL)
+		return true;
+
+	for (x = 0; x < PMS_NR_PM; ++x) {
+		frame->pm_cf1[x] = rd_be16(&raw[4 + 2*x]);
+		frame->pm_atm[x] = rd_be16(&raw[10 + 2*x]);
+	}
+	for (x = 0; x < PMS_NR_BINS; ++x)
+		frame->nr_particles[x] = rd_be16(&raw[16 + 2*x]);
+	frame->version = raw[28];
+	frame->error   = raw[29];
+	return true;
+}
+
+// Encode a frame, then checksum it
+void pms_frame_encode(uint8_t *raw, const pms_frame_t *frame)
+{
+	unsigned int x;
+
+	raw[0] = PMS_FRAME_START_1;
+	raw[1] = PMS_FRAME_START_2;
+	wr_be16(&raw[2], PMS_FRAME_DATA_LEN);
+	for (x = 0; x < PMS_NR_PM; ++x) {
+		wr_be16(&raw[4 + 2*x], frame->pm_cf1[x]);
+		wr_be16(&raw[10 + 2*x], frame->pm_atm[x]);
+	}
+	for (x = 0; x < PMS_NR_BINS; ++x)
+		wr_be16(&raw[16 + 2*x], frame->nr_particles[x]);
+	raw[28] = frame->version;
+	raw[29] = frame->error;
+	wr_be16(&raw[PMS_FRAME_LEN - 2], pms_frame_checksum(raw));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Reset a parser
+void pms_parser_init(pms_parser_t *p)
+{
+	memset(p, 0, sizeof(*p));
+}
+
+// Discard bytes at the start of the parser buffer
+static void pms_parser_discard(pms_parser_t *p, unsigned int n)
+{
+	p->idx -= n;
+	memmove(p->buf, &p->buf[n], p->idx);
+	p->nr_skipped += n;
+	p->gap += n;
+}
+
+/*
+ * Drop a rejected candidate, keeping whatever follows its first byte that
+ * might still be the start of a frame.
+ *
+ * NOTE: Each call drops at least one byte and looks at most at
+ *       PMS_FRAME_LEN of them, so the work per received byte stays bounded
+ *       however noisy the link is.
+ */
+static void pms_parser_resync(pms_parser_t *p)
+{
+	unsigned int x;
+
+	for (;;) {
+		for (x = 1; x < p->idx; ++x) {
+			if (p->buf[x] == PMS_FRAME_START_1 &&
+			    (x + 1 == p->idx || p->buf[x + 1] == PMS_FRAME_START_2))
+				break;
+		}
+		pms_parser_discard(p, x);
+
+		// The new candidate may already reveal a bogus length.
+		if (p->idx < 4 || rd_be16(&p->buf[2]) == PMS_FRAME_DATA_LEN)
+			break;
+	}
+}
+
+// Feed one byte to a parser
+bool pms_parser_push(pms_parser_t *p, uint8_t c, pms_frame_t *frame)
+{
+	// Hunt for the start characters first.
+	if (p->idx == 0) {
+		if (c == PMS_FRAME_START_1) {
+			p->buf[p->idx++] = c;
+		} else {
+			++p->nr_skipped;
+			++p->gap;
+		}
+		return false;
+	} else if (p->idx == 1) {
+		if (c == PMS_FRAME_START_2) {
+			p->buf[p->idx++] = c;
+		} else {
+			// A repeated 0x42 might still be the real start.
+			p->buf[p->idx++] = c;
+			pms_parser_resync(p);
+		}
+		return false;
+	}
+
+	p->buf[p->idx++] = c;
+
+	// Reject a bogus length as soon as it is known.
+	if (p->idx == 4 && rd_be16(&p->buf[2]) != PMS_FRAME_DATA_LEN) {
+		pms_parser_resync(p);
+		return false;
+	}
+
+	if (p->idx < PMS_FRAME_LEN)
+		return false;
+
+	// Complete frame
+	if (!pms_frame_decode(frame, p->buf)) {
+		++p->nr_bad_checksum;
+		pms_parser_resync(p);
+		return false;
+	}
+	p->idx = 0;
+	++p->nr_frames;
+	if (p->gap > 0) {
+		++p->nr_resyncs;
+		if (p->gap > p->max_gap)
+			p->max_gap = p->gap;
+		p->gap = 0;
+	}
+	return true;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file  pms.h
+ * @brief Frame decoding for the Plantower PMS5003-family particulate sensors
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       decoder can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * Frame layout (all multi-byte fields are big-endian), per the datasheet:
+ *
+ *   Offset  Size  Contents
+ *   ------  ----  -----------------------------------------------------
+ *        0     2  Start characters, 0x42 0x4D ("BM")
+ *        2     2  Frame length (2*13 + 2 = 28)
+ *        4     6  PM1.0, PM2.5, PM10 in ug/m3 (CF=1, standard particle)
+ *       10     6  PM1.0, PM2.5, PM10 in ug/m3 (atmospheric environment)
+ *       16    12  Particle counts in 0.1L of air, beyond 0.3/0.5/1.0/2.5/
+ *                 5.0/10 um
+ *       28     2  Version number, error code
+ *       30     2  Checksum (sum of bytes 0..29)
+ */
+
+#if !defined(EEE192_PMS_H_)
+#define EEE192_PMS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Total number of bytes in one frame, including the start characters
+#define PMS_FRAME_LEN		32
+
+/// First start character
+#define PMS_FRAME_START_1	0x42
+
+/// Second start character
+#define PMS_FRAME_START_2	0x4D
+
+/// Expected value of the frame-length field
+#define PMS_FRAME_DATA_LEN	(PMS_FRAME_LEN - 4)
+
+/// Index of PM1.0 within the @c pm_* arrays
+#define PMS_PM1_0	0
+
+/// Index of PM2.5 within the @c pm_* arrays
+#define PMS_PM2_5	1
+
+/// Index of PM10 within the @c pm_* arrays
+#define PMS_PM10	2
+
+/// Number of mass-concentration channels
+#define PMS_NR_PM	3
+
+/// Number of particle-count bins
+#define PMS_NR_BINS	6
+
+/// A decoded frame
+typedef struct pms_frame_type {
+	/// Mass concentrations (CF=1), in ug/m3
+	uint16_t pm_cf1[PMS_NR_PM];
+
+	/// Mass concentrations (atmospheric environment), in ug/m3
+	uint16_t pm_atm[PMS_NR_PM];
+
+	/// Particle counts per 0.1L of air
+	uint16_t nr_particles[PMS_NR_BINS];
+
+	/// Sensor version number
+	uint8_t version;
+
+	/// Sensor error code
+	uint8_t error;
+} pms_frame_t;
+
+/**
+ * Compute the checksum of a raw frame
+ *
+ * @param[in]	raw	Raw frame, at least @c PMS_FRAME_LEN bytes
+ *
+ * @return	The sum of all bytes preceding the checksum field
+ */
+uint16_t pms_frame_checksum(const uint8_t *raw);
+
+/**
+ * Validate and decode a raw frame
+ *
+ * @param[out]	frame	Decoded frame; may be @c NULL if only validation is
+ *			desired
+ * @param[in]	raw	Raw frame, at least @c PMS_FRAME_LEN bytes
+ *
+ * @return	@c true if the start characters, length and checksum are all
+ *		valid, @c false otherwise (@c frame is left untouched)
+ */
+bool pms_frame_decode(pms_frame_t *frame, const uint8_t *raw);
+
+/**
+ * Encode a frame, checksum included
+ *
+ * @param[out]	raw	Raw frame, @c PMS_FRAME_LEN bytes
+ * @param[in]	frame	Frame to encode
+ */
+void pms_frame_encode(uint8_t *raw, const pms_frame_t *frame);
+
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Byte-at-a-time frame parser
+ *
+ * @note
+ * The parser is meant to be fed from arbitrarily-sized reads; it carries any
+ * partial frame over to the next call.
+ *
+ * @note
+ * When a candidate frame is rejected, the bytes already buffered are searched
+ * for the next pair of start characters, so that a corrupted, truncated or
+ * shifted frame never costs the frame that follows it. Lock is thus regained
+ * at the first intact frame after an impairment, i.e. at most
+ * @code PMS_FRAME_LEN - 1 @endcode bytes after the last damaged byte, using
+ * constant work per received byte.
+ */
+typedef struct pms_parser_type {
+	/// Raw bytes of the frame being assembled
+	uint8_t buf[PMS_FRAME_LEN];
+
+	/// Number of valid bytes in @c buf
+	uint8_t idx;
+
+	/// Number of valid frames seen so far
+	uint32_t nr_frames;
+
+	/// Number of frames rejected due to a checksum mismatch
+	uint32_t nr_bad_checksum;
+
+	/// Number of bytes discarded while searching for a frame
+	uint32_t nr_skipped;
+
+	/// Number of times lock was regained after discarding bytes
+	uint32_t nr_resyncs;
+
+	/// Number of bytes discarded since the last valid frame
+	uint32_t gap;
+
+	/// Largest number of bytes discarded between two valid frames
+	uint32_t max_gap;
+} pms_parser_t;
+
+/// Reset a parser, including its counters
+void pms_parser_init(pms_parser_t *p);
+
+/**
+ * Feed one byte to a parser
+ *
+ * @param[in,out]	p	Parser
+ * @param[in]		c	Received byte
+ * @param[out]		frame	Decoded frame, if one was completed; may be
+ *				@c NULL
+ *
+ * @return	@c true if @c c completed a valid frame, @c false otherwise
+ *
+ * @note
+ * On a @c true return, the raw frame is available in @c p->buf until the
+ * next call.
+ */
+bool pms_parser_push(pms_parser_t *p, uint8_t c, pms_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_PMS_H_)
@@ -0,0 +1,68 @@
+/**
+ * @file  report.c
+ * @brief Change-only (deadband) reporting of decoded PMS frames
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "report.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Gather all channels of a frame, in report_cfg_t order
+static void report_channels(uint16_t *v, const pms_frame_t *frame)
+{
+	unsigned int x;
+
+	for (x = 0; x < PMS_NR_PM; ++x) {
+		v[x]             = frame->pm_cf1[x];
+		v[PMS_NR_PM + x] = frame->pm_atm[x];
+	}
+	for (x = 0; x < PMS_NR_BINS; ++x)
+		v[2*PMS_NR_PM + x] = frame->nr_particles[x];
+}
+
+void report_init(report_state_t *st)
+{
+	memset(st, 0, sizeof(*st));
+}
+
+bool report_check(report_state_t *st, const report_cfg_t *cfg,
+		  const pms_frame_t *frame, uint32_t now_ms)
+{
+	uint16_t v[REPORT_NR_CHANNELS];
+	bool send = false;
+	unsigned int x;
+
+	report_channels(v, frame);
+	if (!st->primed || frame->error != st->last_error)
+		send = true;
+	else if (cfg->heartbeat_ms != 0 && (uint32_t)(now_ms - st->last_ms) >= cfg->heartbeat_ms)
+		send = true;
+
+	for (x = 0; x < REPORT_NR_CHANNELS && !send; ++x) {
+		uint32_t band = ((uint32_t)st->last[x] * cfg->rel_band[x]) / REPORT_REL_ONE;
+		uint16_t delta = v[x] > st->last[x] ? v[x] - st->last[x] : st->last[x] - v[x];
+
+		if (band < cfg->abs_band[x])
+			band = cfg->abs_band[x];
+		if (delta > band)
+			send = true;
+	}
+
+	if (!send) {
+		++st->nr_suppressed;
+		return false;
+	}
+	memcpy(st->last, v, sizeof(st->last));
+	st->last_error = frame->error;
+	st->last_ms    = now_ms;
+	st->primed     = true;
+	++st->nr_reported;
+	return true;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file  report.h
+ * @brief Change-only (deadband) reporting of decoded PMS frames
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       logic can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * A frame is worth reporting if any channel moved by more than its band
+ * since the last *reported* frame, so that a slow drift still gets through
+ * once it adds up. The band of a channel is the larger of an absolute
+ * amount (which keeps noise around zero quiet) and a fraction of the last
+ * reported value (which scales with the reading). A frame is also reported
+ * when the sensor's error code changes, and when nothing was reported for
+ * the heartbeat interval, so that silence on the link always means trouble.
+ */
+
+#if !defined(EEE192_REPORT_H_)
+#define EEE192_REPORT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pms.h"
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Number of channels compared: PM (CF=1), PM (atmospheric), then counts
+#define REPORT_NR_CHANNELS	(2 * PMS_NR_PM + PMS_NR_BINS)
+
+/// Denominator of relative bands
+#define REPORT_REL_ONE		1024
+
+/// Deadband configuration
+typedef struct report_cfg_type {
+	/// Smallest change worth reporting, per channel, in the channel's units
+	uint16_t abs_band[REPORT_NR_CHANNELS];
+
+	/**
+	 * Smallest relative change worth reporting, per channel, in
+	 * @code 1/REPORT_REL_ONE @endcode of the last reported value
+	 */
+	uint16_t rel_band[REPORT_NR_CHANNELS];
+
+	/// Longest time without a report, in milliseconds (0: unlimited)
+	uint32_t heartbeat_ms;
+} report_cfg_t;
+
+/// Deadband state
+typedef struct report_state_type {
+	/// Channel values of the last reported frame
+	uint16_t last[REPORT_NR_CHANNELS];
+
+	/// Error code of the last reported frame
+	uint8_t last_error;
+
+	/// Whether any frame was reported yet
+	bool primed;
+
+	/// Time of the last report, in milliseconds
+	uint32_t last_ms;
+
+	/// Number of frames reported
+	uint32_t nr_reported;
+
+	/// Number of frames held back
+	uint32_t nr_suppressed;
+} report_state_t;
+
+/// Reset the deadband state, including its counters
+void report_init(report_state_t *st);
+
+/**
+ * Decide whether a frame is worth reporting
+ *
+ * @param[in,out]	st	State; updated only if @c true is returned
+ * @param[in]		cfg	Configuration
+ * @param[in]		frame	Decoded frame
+ * @param[in]		now_ms	Current time, in milliseconds (may wrap)
+ *
+ * @return	@c true if the frame should be sent, @c false otherwise
+ */
+bool report_check(report_state_t *st, const report_cfg_t *cfg,
+		  const pms_frame_t *frame, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_REPORT_H_)
@@ -0,0 +1,143 @@
+/**
+ * @file  selftest.c
+ * @brief Synthetic PMS frame generator for self-testing the firmware
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "selftest.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+/// Version byte marking generated frames
+#define SELFTEST_VERSION	0x5E
+
+// Write a big-endian 16-bit field
+static void wr_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+// xorshift32; never returns zero for a non-zero state
+static uint32_t selftest_rand(selftest_t *st)
+{
+	uint32_t x = st->rng;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	st->rng = x;
+	return x;
+}
+
+// Build the next frame (damaged or not) into st->buf
+static void selftest_build(selftest_t *st)
+{
+	uint8_t *f = st->buf;
+	uint16_t v = (uint16_t)((st->seq * 37u) % 500u);
+	unsigned int x, noise = 0;
+	uint32_t r;
+
+	// Noise goes ahead of the frame proper; decided up front.
+	r = selftest_rand(st);
+	if ((r % 100u) < st->corrupt_pct && ((r >> 8) % 3u) == 2) {
+		noise = 1 + ((r >> 16) % 8u);
+		for (x = 0; x < noise; ++x)
+			f[x] = (x == noise - 1) ? PMS_FRAME_START_1 : (uint8_t)selftest_rand(st);
+		f += noise;
+	}
+
+	f[0] = PMS_FRAME_START_1;
+	f[1] = PMS_FRAME_START_2;
+	wr_be16(&f[2], PMS_FRAME_DATA_LEN);
+	for (x = 0; x < PMS_NR_PM; ++x) {
+		wr_be16(&f[4 + 2*x], (uint16_t)(v + x));
+		wr_be16(&f[10 + 2*x], (uint16_t)(v + x));
+	}
+	for (x = 0; x < PMS_NR_BINS - 1; ++x)
+		wr_be16(&f[16 + 2*x], (uint16_t)(v * (PMS_NR_BINS - x)));
+	wr_be16(&f[26], st->seq);
+	f[28] = SELFTEST_VERSION;
+	f[29] = 0;
+	wr_be16(&f[30], pms_frame_checksum(f));
+	st->len = (uint8_t)(noise + PMS_FRAME_LEN);
+	st->idx = 0;
+
+	if ((r % 100u) >= st->corrupt_pct) {
+		return;
+	} else if (((r >> 8) % 3u) == 0) {
+		// Flipped payload byte
+		f[4 + (selftest_rand(st) % (PMS_FRAME_LEN - 6))] ^= 0x10;
+	} else if (((r >> 8) % 3u) == 1) {
+		// Truncation
+		st->len = (uint8_t)(5 + (selftest_rand(st) % (PMS_FRAME_LEN - 5)));
+	}
+	++st->nr_corrupt;
+}
+
+void selftest_start(selftest_t *st, uint32_t rate, uint8_t corrupt_pct, uint32_t now_ms)
+{
+	memset(st, 0, sizeof(*st));
+	st->rate        = rate;
+	st->corrupt_pct = (corrupt_pct > 100) ? 100 : corrupt_pct;
+	st->start_ms    = now_ms;
+	st->rng         = 0x2545F491u;
+}
+
+const uint8_t *selftest_pending(selftest_t *st, uint32_t now_ms, uint16_t *len)
+{
+	uint64_t due = ((uint64_t)st->rate * (uint32_t)(now_ms - st->start_ms)) / 1000u;
+
+	if (st->idx == st->len) {
+		// Nothing in progress; start the next frame if it is due.
+		if (st->rate == 0 || st->nr_frames >= due) {
+			*len = 0;
+			return st->buf;
+		}
+		selftest_build(st);
+	}
+	*len = (uint16_t)(st->len - st->idx);
+	return &st->buf[st->idx];
+}
+
+void selftest_consume(selftest_t *st, uint16_t n, uint32_t stamp)
+{
+	if (n > (uint16_t)(st->len - st->idx))
+		n = (uint16_t)(st->len - st->idx);
+	st->idx = (uint8_t)(st->idx + n);
+	if (n == 0 || st->idx != st->len)
+		return;
+
+	st->stamp[st->seq % SELFTEST_NR_STAMPS] = stamp;
+	++st->seq;
+	++st->nr_frames;
+}
+
+bool selftest_account(selftest_t *st, const uint8_t *raw, uint32_t stamp)
+{
+	uint16_t seq;
+	uint32_t d;
+
+	if (raw[28] != SELFTEST_VERSION || !pms_frame_decode(NULL, raw))
+		return false;
+
+	// Frames older than the stamp window are counted, but not timed.
+	seq = (uint16_t)((raw[26] << 8) | raw[27]);
+	if ((uint16_t)(st->seq - seq) > SELFTEST_NR_STAMPS)
+		return true;
+
+	d = stamp - st->stamp[seq % SELFTEST_NR_STAMPS];
+	if (st->nr_latency == 0 || d < st->latency_min)
+		st->latency_min = d;
+	if (d > st->latency_max)
+		st->latency_max = d;
+	st->latency_sum += d;
+	++st->nr_latency;
+	return true;
+}
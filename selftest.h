@@ -0,0 +1,128 @@
+/**
+ * @file  selftest.h
+ * @brief Synthetic PMS frame generator for self-testing the firmware
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       generator can be compiled into both the firmware and the host-side
+ *       tools under host/.
+ */
+
+/*
+ * Frames are produced at a configured rate, paced against the caller's
+ * clock, and handed out byte runs at a time; whatever the receive path
+ * could not take is offered again later, so a slow consumer shows up as a
+ * lower achieved rate rather than as lost bytes.
+ *
+ * A configurable share of frames is damaged, in one of three ways: a
+ * flipped payload byte (bad checksum), truncation (the next frame follows
+ * right away), or a few noise bytes (including start characters) ahead of
+ * an intact frame. Readings jump from frame to frame by more than the
+ * deadband of report.h, so that every intact frame is worth reporting.
+ *
+ * Each frame carries a sequence number in its last particle-count bin, so
+ * that the time at which it went into the receive path can be looked up
+ * when it comes out of the pipeline.
+ */
+
+#if !defined(EEE192_SELFTEST_H_)
+#define EEE192_SELFTEST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pms.h"
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Number of in-flight frames whose injection time is remembered
+#define SELFTEST_NR_STAMPS	32
+
+/// Generator state
+typedef struct selftest_type {
+	/// Frames per second
+	uint32_t rate;
+
+	/// Share of damaged frames, in percent
+	uint8_t corrupt_pct;
+
+	/// Time at which generation started, in milliseconds
+	uint32_t start_ms;
+
+	/// Bytes of the frame being handed out
+	uint8_t buf[PMS_FRAME_LEN + 8];
+	uint8_t len;
+	uint8_t idx;
+
+	/// Sequence number of the frame being handed out
+	uint16_t seq;
+
+	/// Pseudo-random state
+	uint32_t rng;
+
+	/// When each in-flight frame was fully handed out, by sequence number
+	uint32_t stamp[SELFTEST_NR_STAMPS];
+
+	/// Number of frames fully handed out
+	uint32_t nr_frames;
+
+	/// Number of those that were damaged
+	uint32_t nr_corrupt;
+
+	/// Latency statistics, in the caller's stamp units
+	uint32_t nr_latency;
+	uint32_t latency_min;
+	uint32_t latency_max;
+	uint64_t latency_sum;
+} selftest_t;
+
+/**
+ * Start generating
+ *
+ * @param[out]	st		State
+ * @param[in]	rate		Frames per second
+ * @param[in]	corrupt_pct	Share of damaged frames, in percent
+ * @param[in]	now_ms		Current time, in milliseconds (may wrap)
+ */
+void selftest_start(selftest_t *st, uint32_t rate, uint8_t corrupt_pct, uint32_t now_ms);
+
+/**
+ * Get the bytes due for injection
+ *
+ * @param[in,out]	st	State
+ * @param[in]		now_ms	Current time, in milliseconds
+ * @param[out]		len	Number of bytes available
+ *
+ * @return	The bytes to inject, of which as many as possible should be
+ *		passed to selftest_consume()
+ */
+const uint8_t *selftest_pending(selftest_t *st, uint32_t now_ms, uint16_t *len);
+
+/**
+ * Mark bytes from selftest_pending() as injected
+ *
+ * @param[in,out]	st	State
+ * @param[in]		n	Number of bytes taken by the receive path
+ * @param[in]		stamp	Current time, in any free-running unit
+ */
+void selftest_consume(selftest_t *st, uint16_t n, uint32_t stamp);
+
+/**
+ * Account for a generated frame leaving the pipeline
+ *
+ * @param[in,out]	st	State
+ * @param[in]		raw	Raw frame, @c PMS_FRAME_LEN bytes
+ * @param[in]		stamp	Current time, in the unit given to
+ *				selftest_consume()
+ *
+ * @return	@c true if the frame was one of the generator's, @c false
+ *		otherwise
+ */
+bool selftest_account(selftest_t *st, const uint8_t *raw, uint32_t stamp);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_SELFTEST_H_)
@@ -0,0 +1,54 @@
+/**
+ * @file  stamp.c
+ * @brief Device-clock timestamps of PMS frames, as records sent after them
+ *
+ * NOTE: This file does not deal with hardware configuration, and must stay
+ *       buildable with a hosted compiler.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stamp.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+static uint16_t stamp_record_checksum(const uint8_t *raw)
+{
+	uint16_t sum = 0;
+	unsigned int x;
+
+	for (x = 0; x < (STAMP_RECORD_LEN - 2); ++x)
+		sum += raw[x];
+	return sum;
+}
+
+void stamp_record_encode(uint8_t *raw, uint64_t us)
+{
+	uint16_t sum;
+	unsigned int x;
+
+	raw[0] = STAMP_RECORD_START_1;
+	raw[1] = STAMP_RECORD_START_2;
+	for (x = 0; x < 6; ++x)
+		raw[2 + x] = (uint8_t)(us >> (8 * (5 - x)));
+	sum = stamp_record_checksum(raw);
+	raw[8] = (uint8_t)(sum >> 8);
+	raw[9] = (uint8_t)sum;
+}
+
+bool stamp_record_decode(uint64_t *us, const uint8_t *raw)
+{
+	uint64_t v = 0;
+	unsigned int x;
+
+	if (raw[0] != STAMP_RECORD_START_1 || raw[1] != STAMP_RECORD_START_2)
+		return false;
+	else if ((uint16_t)((raw[8] << 8) | raw[9]) != stamp_record_checksum(raw))
+		return false;
+
+	for (x = 0; x < 6; ++x)
+		v = (v << 8) | raw[2 + x];
+	*us = v;
+	return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file  stamp.h
+ * @brief Device-clock timestamps of PMS frames, as records sent after them
+ *
+ * NOTE: This module does not touch any hardware, so that the exact same
+ *       record format can be compiled into both the firmware and the
+ *       host-side tools under host/.
+ */
+
+/*
+ * The firmware latches its high-resolution clock (platform_tick_hrcount())
+ * when the first byte of a PMS frame comes in, and sends it after the frame
+ * (and its AQI record, if any) as a record of its own:
+ *
+ *   Offset  Size  Contents
+ *   ------  ----  -----------------------------------------------------
+ *        0     2  Start characters, 0x42 0x54 ("BT")
+ *        2     6  Microseconds since boot, at the first byte of the frame
+ *        8     2  Checksum (sum of bytes 0..7)
+ *
+ * Multi-byte fields are big-endian, as in PMS frames. A record refers to the
+ * last frame before it, and starts at most STAMP_RECORD_MAX_LAG bytes after
+ * the end of that frame; a frame followed by another frame first has no
+ * record. The 48-bit count does not wrap around for almost nine years, so a
+ * count going backwards means the board was reset.
+ *
+ * The device clock runs off the board's oscillator, so it drifts away from
+ * wall-clock time; the host maps it back (see host/clocksync.h).
+ */
+
+#if !defined(EEE192_STAMP_H_)
+#define EEE192_STAMP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Total number of bytes in one timestamp record
+#define STAMP_RECORD_LEN	10
+
+/// First start character of a timestamp record
+#define STAMP_RECORD_START_1	0x42
+
+/// Second start character of a timestamp record
+#define STAMP_RECORD_START_2	0x54
+
+/// Largest number of bytes between the end of a frame and its record
+#define STAMP_RECORD_MAX_LAG	64
+
+/// Largest device time that can be sent, in microseconds
+#define STAMP_US_MAX		0xFFFFFFFFFFFFull
+
+/// Build a timestamp record, @c STAMP_RECORD_LEN bytes; @c us is truncated to 48 bits
+void stamp_record_encode(uint8_t *raw, uint64_t us);
+
+/**
+ * Validate and decode a timestamp record
+ *
+ * @return	@c true if the start characters and checksum are valid,
+ *		@c false otherwise (@c us is left untouched)
+ */
+bool stamp_record_decode(uint64_t *us, const uint8_t *raw);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_STAMP_H_)
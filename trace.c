@@ -0,0 +1,87 @@
+/**
+ * @file  trace.c
+ * @brief Binary event trace, formatted later by the host
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+#include "trace.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+static struct {
+	/// Record storage
+	trace_rec_t rec[TRACE_NR_RECS];
+
+	/// Number of events recorded since the last thaw (free-running)
+	uint32_t head;
+
+	/// Number of events skipped while frozen, since the last dump
+	uint32_t nr_skipped;
+
+	/// Whether the ring is being sent out
+	bool frozen;
+} trace;
+
+void trace_init(void)
+{
+	memset(&trace, 0, sizeof(trace));
+}
+
+void trace_event(uint16_t id, uint16_t arg0, uint32_t arg1)
+{
+	trace_rec_t *r;
+
+	if (trace.frozen) {
+		++trace.nr_skipped;
+		return;
+	}
+	r = &trace.rec[trace.head++ & (TRACE_NR_RECS - 1)];
+	r->ts   = platform_tick_hrraw();
+	r->id   = id;
+	r->arg0 = arg0;
+	r->arg1 = arg1;
+}
+
+void trace_freeze(trace_dump_hdr_t *hdr, const trace_rec_t *frag[2], uint16_t len[2])
+{
+	uint32_t nr = (trace.head < TRACE_NR_RECS) ? trace.head : TRACE_NR_RECS;
+	uint32_t first = (trace.head - nr) & (TRACE_NR_RECS - 1);
+
+	trace.frozen = true;
+
+	memcpy(hdr->magic, TRACE_DUMP_MAGIC, sizeof(hdr->magic));
+	hdr->version       = TRACE_DUMP_VERSION;
+	hdr->rec_size      = sizeof(trace_rec_t);
+	hdr->nr_recs       = (uint16_t)nr;
+	hdr->nr_lost       = (trace.head - nr) + trace.nr_skipped;
+	hdr->counts_per_us = PLATFORM_TICK_HRRAW_PER_US;
+	hdr->reserved      = 0;
+	trace.nr_skipped   = 0;
+
+	// The oldest record is at 'first'; the run wraps around at most once.
+	frag[0] = &trace.rec[first];
+	if (first + nr <= TRACE_NR_RECS) {
+		len[0]  = (uint16_t)(nr * sizeof(trace_rec_t));
+		frag[1] = NULL;
+		len[1]  = 0;
+	} else {
+		len[0]  = (uint16_t)((TRACE_NR_RECS - first) * sizeof(trace_rec_t));
+		frag[1] = &trace.rec[0];
+		len[1]  = (uint16_t)((first + nr - TRACE_NR_RECS) * sizeof(trace_rec_t));
+	}
+}
+
+void trace_thaw(void)
+{
+	trace.head   = 0;
+	trace.frozen = false;
+}
+
+uint16_t trace_ram_size(void)
+{
+	return sizeof(trace);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file  trace.h
+ * @brief Binary event trace, formatted later by the host
+ *
+ * NOTE: The record and dump layouts below are shared with the host-side
+ *       formatter under host/; only the recording routines are specific to
+ *       the firmware.
+ */
+
+/*
+ * Events are recorded as fixed-size binary records into a RAM ring, which
+ * keeps the most recent TRACE_NR_RECS of them; recording one costs a
+ * timestamp read and a few stores, so tracing can stay enabled in
+ * production builds. Nothing is formatted on the board: on request, the
+ * ring is sent as a dump (a header, then the records from oldest to newest)
+ * and pms-trace turns it into text.
+ *
+ * All multi-byte fields are little-endian, as is the firmware's target.
+ */
+
+#if !defined(EEE192_TRACE_H_)
+#define EEE192_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// C linkage should be maintained
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Event IDs, with their name and the meaning of both arguments
+ *
+ * NOTE: New events go at the end, so that older dumps still read right.
+ */
+#define TRACE_EVENTS(X) \
+	X(TRACE_EV_NONE,	"none",		"",		"")		\
+	X(TRACE_EV_PM_RX,	"pm-rx",	"len",		"")		\
+	X(TRACE_EV_FRAME,	"frame",	"pm2_5",	"reported")	\
+	X(TRACE_EV_TX_QUEUE,	"tx-queue",	"entries",	"len")		\
+	X(TRACE_EV_TX_SEND,	"tx-send",	"entries",	"age_ms")	\
+	X(TRACE_EV_TX_DROP,	"tx-drop",	"",		"nr_dropped")	\
+	X(TRACE_EV_CDC_RX,	"cdc-rx",	"len",		"first")	\
+	X(TRACE_EV_DUMP,	"dump",		"nr_recs",	"")		\
+	X(TRACE_EV_CLAMP,	"clamp",	"pm2_5",	"nr_clamped")
+
+#define TRACE_EV_ENUM_(id, name, arg0, arg1)	id,
+enum trace_event_type {
+	TRACE_EVENTS(TRACE_EV_ENUM_)
+	TRACE_NR_EVENTS
+};
+#undef TRACE_EV_ENUM_
+
+/// Number of records kept (a power of two)
+#define TRACE_NR_RECS		256
+
+/// A single trace record
+typedef struct trace_rec_type {
+	/// Timestamp, in @c platform_tick_hrraw() counts
+	uint32_t ts;
+
+	/// Event ID (@code TRACE_EV_* @endcode)
+	uint16_t id;
+
+	/// Event-specific arguments
+	uint16_t arg0;
+	uint32_t arg1;
+} trace_rec_t;
+
+/// First bytes of a dump
+#define TRACE_DUMP_MAGIC	"PMTR"
+
+/// Current dump version
+#define TRACE_DUMP_VERSION	1
+
+/// Header preceding the records of a dump
+typedef struct trace_dump_hdr_type {
+	/// @c TRACE_DUMP_MAGIC, without the terminator
+	char magic[4];
+
+	/// @c TRACE_DUMP_VERSION
+	uint8_t version;
+
+	/// Size of each record, in bytes
+	uint8_t rec_size;
+
+	/// Number of records that follow
+	uint16_t nr_recs;
+
+	/// Number of events overwritten or skipped since the previous dump
+	uint32_t nr_lost;
+
+	/// Number of timestamp counts per microsecond
+	uint16_t counts_per_us;
+
+	uint16_t reserved;
+} trace_dump_hdr_t;
+
+/// Clear the ring
+void trace_init(void);
+
+/**
+ * Record an event
+ *
+ * @note
+ * This must not be called from interrupt handlers; everything that is worth
+ * tracing here runs from the main loop anyway.
+ */
+void trace_event(uint16_t id, uint16_t arg0, uint32_t arg1);
+
+/**
+ * Freeze the ring, and describe its contents for transmission
+ *
+ * Events recorded while the ring is frozen are counted as lost, so that the
+ * dump stays consistent while it is being sent.
+ *
+ * @param[out]	hdr	Dump header
+ * @param[out]	frag	Up to two runs of records, oldest first
+ * @param[out]	len	Length of each run, in bytes (zero if unused)
+ */
+void trace_freeze(trace_dump_hdr_t *hdr, const trace_rec_t *frag[2], uint16_t len[2]);
+
+/// Resume recording after trace_freeze(), starting with an empty ring
+void trace_thaw(void);
+
+/// Static RAM used by the ring, in bytes
+uint16_t trace_ram_size(void);
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+#endif	// !defined(EEE192_TRACE_H_)